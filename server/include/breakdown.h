@@ -0,0 +1,158 @@
+/* Breakdown of the latency of remote operations into their stages.
+ *
+ * If the property `breakdown` is set, the clients of the benchmark servers
+ * read the cycle counter around every stage of an operation, and the servers
+ * return the cycles they spent on a request in a header in front of its
+ * response. Together, they split the latency of every operation into:
+ *
+ *   serialize    client, building the request
+ *   transport    round trip as seen by the client minus the time spent in
+ *                the server, i.e. the IPC or the shared memory handshake
+ *   server       server, (de)serialization and dispatching of the request
+ *   execute      server, the operation of the hosted database
+ *   deserialize  client, parsing the response
+ *
+ * Both sides only compare counter values read on the same CPU, so the
+ * counters of the client and the server CPUs need not be synchronized.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+
+#include "histogram.h"
+#include "tsc.h"
+
+namespace breakdown {
+
+// Report whether the latency breakdown is enabled by the properties of the
+// workload.
+static inline bool enabled(std::map<std::string, std::string> const &props) {
+  auto it = props.find("breakdown");
+  return it != props.end() && (it->second == "1" || it->second == "true");
+}
+
+// Header in front of every response of a server if the breakdown is enabled
+struct Header {
+  // Cycles spent in the database
+  uint64_t execute;
+  // Cycles spent on the request in total, including execute
+  uint64_t server;
+};
+
+static const std::size_t HEADER_SIZE = sizeof(Header);
+
+// Headers are not necessarily aligned in the message buffers.
+static inline void write_header(char *buf, Header const &h) {
+  memcpy(buf, &h, sizeof(h));
+}
+
+static inline Header read_header(char const *buf) {
+  Header h;
+  memcpy(&h, buf, sizeof(h));
+  return h;
+}
+
+enum Stage { SERIALIZE, TRANSPORT, SERVER, EXECUTE, DESERIALIZE, TOTAL };
+static const std::size_t STAGES = TOTAL + 1;
+
+static inline char const *stage_name(Stage s) {
+  static char const *const names[STAGES] = {
+      "serialize", "transport", "server", "execute", "deserialize", "total"};
+  return names[s];
+}
+
+// Histograms of the cycles spent in every stage
+class Stages {
+  ycsbc::Histogram stages[STAGES];
+
+public:
+  ycsbc::Histogram &operator[](Stage s) { return stages[s]; }
+  ycsbc::Histogram const &operator[](Stage s) const { return stages[s]; }
+
+  void Merge(Stages const &other) {
+    for (std::size_t i = 0; i < STAGES; i++)
+      stages[i].Merge(other.stages[i]);
+  }
+
+  void Clear() {
+    for (auto &h : stages)
+      h.Clear();
+  }
+
+  // Print a table with the distribution of every stage.
+  void Print(std::ostream &os) const {
+    os << "stage\tcount\tmean\tp50\tp90\tp99\tp99.9\tmax" << std::endl;
+    for (std::size_t i = 0; i < STAGES; i++) {
+      Stage stage = static_cast<Stage>(i);
+      auto const &h = stages[i];
+      os << stage_name(stage) << '\t' << h.Count() << '\t' << std::fixed
+         << std::setprecision(0) << h.Mean() << '\t' << h.Percentile(50)
+         << '\t' << h.Percentile(90) << '\t' << h.Percentile(99) << '\t'
+         << h.Percentile(99.9) << '\t' << h.Max() << std::endl;
+    }
+  }
+};
+
+// Timestamps of a single operation of a client, which may consist of several
+// round trips (like a scan streamed in chunks). Handling a chunk of the
+// response before requesting the next one counts as deserialization.
+class Probe {
+  uint64_t mark = 0;
+  bool sent = false;
+
+  uint64_t serialize = 0;
+  uint64_t roundtrip = 0;
+  uint64_t deserialize = 0;
+  Header server{};
+
+public:
+  // The client starts building the request.
+  void Begin() {
+    *this = Probe{};
+    mark = ycsbc::rdtsc();
+  }
+
+  // The request is about to be sent.
+  void Send() {
+    uint64_t now = ycsbc::rdtsc();
+    (sent ? deserialize : serialize) += now - mark;
+    sent = true;
+    mark = now;
+  }
+
+  // The response has arrived, starting with the header of the server.
+  void Receive(char const *header) {
+    uint64_t now = ycsbc::rdtsc();
+    roundtrip += now - mark;
+    mark = now;
+
+    Header h = read_header(header);
+    server.execute += h.execute;
+    server.server += h.server;
+  }
+
+  // The client has handled the response. Adds the operation to stages.
+  void End(Stages &stages) {
+    deserialize += ycsbc::rdtsc() - mark;
+
+    // Guard against counters drifting apart between the CPUs.
+    uint64_t in_server = std::min(server.server, roundtrip);
+    uint64_t execute = std::min(server.execute, in_server);
+
+    stages[SERIALIZE].Add(serialize);
+    stages[TRANSPORT].Add(roundtrip - in_server);
+    stages[SERVER].Add(in_server - execute);
+    stages[EXECUTE].Add(execute);
+    stages[DESERIALIZE].Add(deserialize);
+    stages[TOTAL].Add(serialize + roundtrip + deserialize);
+  }
+};
+
+} // namespace breakdown
@@ -10,9 +10,17 @@
 #ifndef YCSB_C_DB_H_
 #define YCSB_C_DB_H_
 
+#include <cstddef>
+#include <functional>
 #include <string>
 #include <vector>
 
+#include "result_view.h"
+
+namespace breakdown {
+class Stages;
+}
+
 namespace ycsbc {
 
 struct Table {
@@ -28,6 +36,34 @@ struct Table {
   }
 };
 
+///
+/// An operation for the asynchronous interface of DB (see DB::Submit()).
+/// The operation is owned by the caller and must stay alive until it has
+/// completed. It can be reused for further operations afterwards.
+///
+struct AsyncOp {
+  enum Type { READ, SCAN, UPDATE, INSERT, DELETE };
+
+  Type type = READ;
+  std::string table{};
+  std::string key{};
+  /// Number of records to scan.
+  int record_count = 0;
+  /// Fields to read or scan, all of them if empty.
+  std::vector<std::string> fields{};
+  /// Field/value pairs to write for updates and inserts.
+  std::vector<std::pair<std::string, std::string>> values{};
+
+  /// Records read by reads and scans. They are valid until the next
+  /// operation is submitted on the same context.
+  ResultView result{};
+  /// Status code of the completed operation (see DB::Read() etc.).
+  int status = 0;
+  /// Invoked on the submitting thread once the operation has completed,
+  /// from within DB::Submit() or DB::Poll().
+  std::function<void(AsyncOp &)> callback{};
+};
+
 class DB {
 public:
   typedef std::pair<std::string, std::string> KVPair;
@@ -64,8 +100,54 @@ public:
   ///
   virtual void Close(void *ctx) { (void)ctx; }
   ///
+  /// Prepares the database for loading the initial records.
+  /// Called once before any client thread starts the load phase. Contexts
+  /// created by Init() between BeginLoad() and EndLoad() are only used for
+  /// inserting records.
+  ///
+  virtual void BeginLoad() {}
+  ///
+  /// Finishes the load phase.
+  /// Called once after all loading client threads have closed their contexts.
+  ///
+  virtual void EndLoad() {}
+  ///
+  /// Writes all records to a snapshot, from which Restore() recreates them
+  /// much faster than inserting them one by one.
+  /// Called after the load phase, while no client thread is running.
+  ///
+  /// @param path The file (or prefix of the files) of the snapshot.
+  /// @param records Description of the workload parameters that determine
+  ///        the records (record count, field count and length, ...), which
+  ///        is stored with the snapshot.
+  /// @return False if the backend does not support snapshots.
+  ///
+  virtual bool Snapshot(const std::string &path, const std::string &records) {
+    (void)path;
+    (void)records;
+    return false;
+  }
+  ///
+  /// Recreates the records of a snapshot written by Snapshot() of the same
+  /// backend, instead of the load phase.
+  /// Called once after CreateSchema(), before any client thread starts.
+  /// Throws std::runtime_error if the snapshot is unusable, e.g., if it was
+  /// written for other records.
+  ///
+  /// @param path The file (or prefix of the files) of the snapshot.
+  /// @param records Description of the records expected, as passed to
+  ///        Snapshot().
+  /// @return False if the backend does not support snapshots.
+  ///
+  virtual bool Restore(const std::string &path, const std::string &records) {
+    (void)path;
+    (void)records;
+    return false;
+  }
+  ///
   /// Reads a record from the database.
-  /// Field/value pairs from the result are stored in a vector.
+  /// Field/value pairs from the result are stored in a vector. Previous
+  /// contents of the vector are replaced, so callers may reuse it.
   ///
   /// @param ctx Pointer to the per-thread context object.
   /// @param table The name of the table.
@@ -79,7 +161,8 @@ public:
                    std::vector<KVPair> &result) = 0;
   ///
   /// Performs a range scan for a set of records in the database.
-  /// Field/value pairs from the result are stored in a vector.
+  /// Field/value pairs from the result are stored in a vector. Previous
+  /// contents of the vector are replaced, so callers may reuse it.
   ///
   /// @param ctx Pointer to the per-thread context object.
   /// @param table The name of the table.
@@ -94,6 +177,45 @@ public:
                    int record_count, const std::vector<std::string> *fields,
                    std::vector<std::vector<KVPair>> &result) = 0;
   ///
+  /// Reads a record from the database without copying the result into
+  /// owning strings (if supported by the backend).
+  /// The record is stored as the first (and only) record of result. The
+  /// slices are valid until the next operation on ctx or result.
+  /// The default implementation adapts Read().
+  ///
+  /// @return Zero on success, or a non-zero error code on error/record-miss.
+  ///
+  virtual int ReadView(void *ctx, const std::string &table,
+                       const std::string &key,
+                       const std::vector<std::string> *fields,
+                       ResultView &result) {
+    auto &rows = result.Owned();
+    rows.resize(1);
+    // Do not expose the previous record if Read() fails without clearing.
+    rows[0].clear();
+    int rc = Read(ctx, table, key, fields, rows[0]);
+    result.Assign(rows);
+    return rc;
+  }
+  ///
+  /// Performs a range scan without copying the result into owning strings
+  /// (if supported by the backend).
+  /// Every record read is stored as a separate record of result. The slices
+  /// are valid until the next operation on ctx or result.
+  /// The default implementation adapts Scan().
+  ///
+  /// @return Zero on success, or a non-zero error code on error.
+  ///
+  virtual int ScanView(void *ctx, const std::string &table,
+                       const std::string &key, int record_count,
+                       const std::vector<std::string> *fields,
+                       ResultView &result) {
+    auto &rows = result.Owned();
+    int rc = Scan(ctx, table, key, record_count, fields, rows);
+    result.Assign(rows);
+    return rc;
+  }
+  ///
   /// Updates a record in the database.
   /// Field/value pairs in the specified vector are written to the record,
   /// overwriting any existing values with the same field names.
@@ -128,6 +250,81 @@ public:
   ///
   virtual int Delete(void *ctx, const std::string &table,
                      const std::string &key) = 0;
+  ///
+  /// Reports how many asynchronous operations may be in flight on a context
+  /// at the same time. Synchronous backends report 1.
+  ///
+  /// @param ctx Pointer to the per-thread context object.
+  ///
+  virtual std::size_t QueueDepth(void *ctx) {
+    (void)ctx;
+    return 1;
+  }
+  ///
+  /// Submits an operation for asynchronous execution. At most QueueDepth()
+  /// operations may be in flight on ctx, callers must Poll() for completions
+  /// before submitting more. Mixing synchronous and asynchronous operations
+  /// on a context is only allowed while no asynchronous one is in flight.
+  /// The default implementation executes the operation synchronously and
+  /// completes it right away.
+  ///
+  /// @param ctx Pointer to the per-thread context object.
+  /// @param op The operation, which must stay alive until it has completed.
+  ///
+  virtual void Submit(void *ctx, AsyncOp &op) {
+    op.status = Execute(ctx, op);
+    if (op.callback)
+      op.callback(op);
+  }
+  ///
+  /// Completes the operations that have finished since the last call and
+  /// invokes their callbacks.
+  ///
+  /// @param ctx Pointer to the per-thread context object.
+  /// @param wait Block until at least one operation has completed (if any
+  ///        is in flight).
+  /// @return The number of operations completed.
+  ///
+  virtual std::size_t Poll(void *ctx, bool wait) {
+    (void)ctx;
+    (void)wait;
+    return 0;
+  }
+  ///
+  /// Executes an asynchronous operation synchronously.
+  ///
+  /// @return The status code of the operation.
+  ///
+  int Execute(void *ctx, AsyncOp &op) {
+    auto fields = op.fields.empty() ? nullptr : &op.fields;
+
+    switch (op.type) {
+    case AsyncOp::READ:
+      return ReadView(ctx, op.table, op.key, fields, op.result);
+    case AsyncOp::SCAN:
+      return ScanView(ctx, op.table, op.key, op.record_count, fields,
+                      op.result);
+    case AsyncOp::UPDATE:
+      return Update(ctx, op.table, op.key, op.values);
+    case AsyncOp::INSERT:
+      return Insert(ctx, op.table, op.key, op.values);
+    case AsyncOp::DELETE:
+      return Delete(ctx, op.table, op.key);
+    }
+    return kErrorNoData;
+  }
+  ///
+  /// Reports the latency breakdown of the operations of all contexts closed
+  /// since the previous call or the end of the load phase (see breakdown.h)
+  /// and starts a new one.
+  ///
+  /// @param stages Receives the histograms of all stages.
+  /// @return False if the database does not record a breakdown.
+  ///
+  virtual bool TakeBreakdown(breakdown::Stages &stages) {
+    (void)stages;
+    return false;
+  }
 
   virtual ~DB() {}
 };
@@ -0,0 +1,171 @@
+/* Hosting of arbitrary YCSB-C databases behind the compact message format.
+ *
+ * The benchmark servers only implement a transport (IPC or shared memory).
+ * Creating the database selected by the client and executing the requests
+ * received over any transport is shared by all of them and by the benchmark
+ * application itself, which creates its in-process databases the same way.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db.h"
+#include "result_view.h"
+#include "serializer.h"
+
+namespace dbhost {
+
+// Configuration of a database, usually all properties of the workload.
+typedef std::map<std::string, std::string> Params;
+
+// Create the database backend `name` running in this process. Returns nullptr
+// if there is no such backend. Throws std::invalid_argument for malformed
+// parameters.
+ycsbc::DB *create_db(std::string const &name, Params const &params);
+
+// Write the name and parameters of the database to host, followed by its
+// tables, into the infopage of a server.
+void write_spec(serializer::Serializer &, std::string const &name,
+                Params const &params, ycsbc::DB::Tables const &tables);
+
+// Report whether the parameters select the run-only mode of the benchmark
+// (property "mode" set to "run"), which runs transactions on the records
+// loaded by an earlier benchmark run with "mode" set to "load".
+bool run_only(Params const &params);
+
+// Database of a server, kept across the connections of benchmark clients, so
+// that the records loaded by one client can be used by the following ones.
+// The database is only replaced while no Session refers to it.
+class Host {
+  std::unique_ptr<ycsbc::DB> db;
+  serializer::Schema schema_{};
+
+  // Number of open sessions on db
+  std::atomic<std::size_t> sessions{0};
+
+  // Backend, tables and the parameters determining the records of db
+  std::string name;
+  ycsbc::DB::Tables tables;
+  Params records;
+
+public:
+  // Set up the database described by an infopage written with write_spec()
+  // and set `params` accordingly. Unless the client is run-only (see
+  // run_only()), a new database replaces the current one. A run-only client
+  // gets the current database, which must have been created for the same
+  // backend, tables and records. Throws std::invalid_argument if the backend
+  // is unknown, if there is no matching database for a run-only client, or if
+  // the database would be replaced while sessions are still open.
+  ycsbc::DB *open(serializer::Deserializer &, Params &params);
+
+  // Table and column ids of the current database
+  serializer::Schema const &schema() const { return schema_; }
+
+  friend class Session;
+};
+
+// Result of a read or scan, kept until it has been sent completely.
+struct Result {
+  // Result buffer, reused across operations to avoid reallocations. The
+  // results are serialized from the view without building strings first.
+  ycsbc::ResultView view;
+
+  // Table of the records in view
+  std::size_t table = 0;
+
+  // First record not yet sent of a scan result that is streamed in several
+  // chunks, only valid while streaming is set
+  std::size_t next_record = 0;
+  bool streaming = false;
+};
+
+// Connection of a server thread to the hosted database. Executes the
+// requests of the compact message format. All operations return the status
+// code of the database (DB::kOK on success), or MALFORMED if the request
+// could not be deserialized.
+//
+// If timed is set, the session measures the cycles spent on every request
+// for the latency breakdown (see breakdown.h). The transport brackets the
+// handling of a request with begin() and end(), which writes the header in
+// front of the response.
+class Session {
+  Host &host;
+  ycsbc::DB &db;
+  serializer::Schema const &schema;
+
+  // Context object returned from the database, nullptr once closed
+  void *ctx;
+
+  // Cycle counter values of the current request, only used if timed
+  bool timed;
+  uint64_t start = 0;
+  uint64_t execute = 0;
+
+  // Read the cycle counter before calling the database, and add the cycles
+  // since to execute afterwards.
+  uint64_t stamp() const;
+  void executed(uint64_t since);
+
+  // Request parameters, deserialized into the same strings for every
+  // operation to avoid reallocations
+  std::string key;
+  std::vector<std::string> fields;
+  std::vector<ycsbc::DB::KVPair> values;
+
+  // Report the fields to pass to a read or scan. The message format does not
+  // distinguish all fields (NULL) from an empty selection.
+  std::vector<std::string> const *selected() const;
+
+public:
+  // Status of a request that is truncated, refers to an unknown table or
+  // column, or exceeds the length of a scan supported by the databases
+  static const int MALFORMED = -1;
+
+  // Open a session on the current database of host. Throws
+  // std::invalid_argument if there is none.
+  Session(Host &host, bool timed = false);
+  ~Session();
+
+  Session(Session const &) = delete;
+  Session &operator=(Session const &) = delete;
+
+  // Close the connection to the database, which allows the host to replace
+  // it. Called by the destructor unless done before. No requests may be
+  // executed afterwards.
+  void close();
+
+  // Report the number of bytes reserved for the header in front of every
+  // response (zero if the session is not timed).
+  std::size_t header_size() const;
+
+  // Start handling a request.
+  void begin();
+  // Finish handling a request. Writes the header to `header` if the session
+  // is timed.
+  void end(char *header);
+
+  // Execute a request, whose parameters are deserialized from `d`. Reads and
+  // scans leave their records in `r`.
+  int read(serializer::Deserializer &d, Result &r);
+  int scan(serializer::Deserializer &d, Result &r);
+  int insert(serializer::Deserializer &d);
+  int update(serializer::Deserializer &d);
+  int del(serializer::Deserializer &d);
+
+  // Serialize the record of a read.
+  void record(serializer::Serializer &s, Result const &r) const;
+  // Report the number of bytes used by record().
+  std::size_t record_size(Result const &r) const;
+
+  // Serialize the next chunk of a scan. Returns false if there is no scan
+  // result left to send.
+  bool chunk(serializer::Serializer &s, Result &r) const;
+};
+
+} // namespace dbhost
@@ -14,7 +14,7 @@
 
 #include <string>
 #include <vector>
-#include "lib/string_hashtable.h"
+#include "vmp/string_hashtable.h"
 
 namespace ycsbc {
 
@@ -36,6 +36,12 @@ class HashtableDB : public DB {
   int Delete(void *ctx, const std::string &table,
              const std::string &key) override;
 
+  // The snapshot is an image of the hashtables: the description of the
+  // records followed by the records with their fields, in a length-prefixed
+  // binary format of this machine.
+  bool Snapshot(const std::string &path, const std::string &records) override;
+  bool Restore(const std::string &path, const std::string &records) override;
+
  protected:
   HashtableDB(KeyHashtable *table) : key_table_(table) { }
 
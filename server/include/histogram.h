@@ -0,0 +1,94 @@
+/* Histograms of latencies with a bounded relative error.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace ycsbc {
+
+// Log-linear histogram of unsigned 64 bit values (cycles or nanoseconds).
+//
+// Values below 2 * SUB_BUCKETS are counted exactly. Every larger power of two
+// is split into SUB_BUCKETS buckets of equal width, so percentiles are off
+// by at most 1 / SUB_BUCKETS (6.25%). Adding a value is a few arithmetic
+// instructions and never allocates, so a histogram may be updated on the
+// measured path. Histograms of several threads are combined with Merge().
+class Histogram {
+public:
+  static const unsigned SUB_BITS = 4;
+  static const uint64_t SUB_BUCKETS = 1 << SUB_BITS;
+  static const std::size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+  Histogram() : counts(BUCKETS) {}
+
+  void Add(uint64_t v) {
+    counts[index(v)]++;
+    count++;
+    sum += v;
+    min = std::min(min, v);
+    max = std::max(max, v);
+  }
+
+  void Merge(Histogram const &other) {
+    for (std::size_t i = 0; i < BUCKETS; i++)
+      counts[i] += other.counts[i];
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+  }
+
+  void Clear() { *this = Histogram{}; }
+
+  uint64_t Count() const { return count; }
+  uint64_t Sum() const { return sum; }
+  uint64_t Min() const { return count ? min : 0; }
+  uint64_t Max() const { return max; }
+  double Mean() const { return count ? static_cast<double>(sum) / count : 0; }
+
+  // Report the smallest value of the bucket of the p-th percentile (p in
+  // [0, 100]), clamped to the observed range.
+  uint64_t Percentile(double p) const {
+    if (!count)
+      return 0;
+
+    // Rank of the percentile, counted from 1
+    uint64_t rank = static_cast<uint64_t>(p / 100 * count + 0.5);
+    rank = std::max<uint64_t>(1, std::min(rank, count));
+
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; i++) {
+      seen += counts[i];
+      if (seen >= rank)
+        return std::max(min, std::min(max, lower_bound(i)));
+    }
+    return max;
+  }
+
+private:
+  std::vector<uint64_t> counts;
+  uint64_t count = 0;
+  uint64_t sum = 0;
+  uint64_t min = UINT64_MAX;
+  uint64_t max = 0;
+
+  static std::size_t index(uint64_t v) {
+    if (v < 2 * SUB_BUCKETS)
+      return v;
+    // Keep the SUB_BITS bits following the most significant one.
+    unsigned shift = 63 - __builtin_clzll(v) - SUB_BITS;
+    return shift * SUB_BUCKETS + (v >> shift);
+  }
+
+  static uint64_t lower_bound(std::size_t i) {
+    if (i < 2 * SUB_BUCKETS)
+      return i;
+    unsigned shift = i / SUB_BUCKETS - 1;
+    return (i % SUB_BUCKETS + SUB_BUCKETS) << shift;
+  }
+};
+
+} // namespace ycsbc
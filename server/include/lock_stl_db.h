@@ -9,12 +9,12 @@
 #ifndef YCSB_C_LOCK_STL_DB_H_
 #define YCSB_C_LOCK_STL_DB_H_
 
-#include "db/hashtable_db.h"
+#include "hashtable_db.h"
 
 #include <string>
 #include <vector>
 #include <mutex>
-#include "lib/stl_hashtable.h"
+#include "vmp/stl_hashtable.h"
 
 namespace ycsbc {
 
@@ -0,0 +1,122 @@
+/******************************************************************************
+ *                                                                            *
+ * lsm_db.h - A write-optimized database backend based on a log-structured    *
+ *            merge tree.                                                     *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef YCSB_C_LSM_DB_H
+#define YCSB_C_LSM_DB_H
+
+#include "db.h"                     // YCSBC interface for databases
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ycsbc {
+
+namespace lsm {
+class BlockStore;
+}
+
+/*
+ * Tuning knobs for the LSM backend.
+ */
+struct LsmOptions {
+    // Directory and file name prefix for the sorted runs. If empty, the runs
+    // are kept in memory.
+    std::string path;
+
+    // Size of the memtable in bytes before it is turned into a run
+    std::size_t memtable_size = 4 << 20;
+
+    // Number of full memtables waiting to be written before writers stall
+    std::size_t max_immutable = 4;
+
+    // Size of the blocks of a run in bytes
+    std::size_t block_size = 4 << 10;
+
+    // Number of runs that triggers the compaction of the newest runs of
+    // similar size into one
+    std::size_t max_runs = 4;
+
+    // Bits per key of the bloom filter of every run
+    std::size_t bloom_bits = 10;
+};
+
+/*
+ * Writes go into an in-memory skiplist (memtable). Full memtables are written
+ * as immutable sorted runs by a background thread, which also merges the
+ * newest runs of similar size into one once there are too many of them
+ * (size-tiered compaction). Every run has a bloom filter, so that reads
+ * usually touch only a single block of the run holding the key.
+ *
+ * All tables share one tree, keys are prefixed by their table name.
+ */
+class LsmDB : public DB {
+    public:
+        LsmDB(const LsmOptions &options = LsmOptions{});
+        ~LsmDB() override;
+
+        int Read(void *ctx, const std::string &table, const std::string &key,
+                 const std::vector<std::string> *fields,
+                 std::vector<KVPair> &result) override;
+
+        int Scan(void *ctx, const std::string &table, const std::string &key,
+                 int len, const std::vector<std::string> *fields,
+                 std::vector<std::vector<KVPair>> &result) override;
+
+        int Update(void *ctx, const std::string &table, const std::string &key,
+                   std::vector<KVPair> &values) override;
+
+        int Insert(void *ctx, const std::string &table, const std::string &key,
+                   std::vector<KVPair> &values) override;
+
+        int Delete(void *ctx, const std::string &table,
+                   const std::string &key) override;
+
+    private:
+        struct Version;
+
+        std::shared_ptr<const Version> Current() const;
+
+        // Look up the newest value of key, false if absent or deleted.
+        bool Get(const std::string &key, std::string &value) const;
+
+        // Add an entry to the memtable. Requires write_mutex.
+        void Write(const std::string &key, const std::string &value,
+                   bool tombstone);
+
+        // Main loop of the background thread writing and merging runs.
+        void Compact();
+
+        std::unique_ptr<lsm::BlockStore> NewStore();
+
+        const LsmOptions options;
+
+        // Serializes all writers
+        std::mutex write_mutex;
+        // Sequence number of the last write
+        uint64_t seq = 0;
+
+        // Protects current and stop. cv signals new immutable memtables to
+        // the background thread and finished runs to stalled writers.
+        mutable std::mutex version_mutex;
+        std::condition_variable cv;
+        std::shared_ptr<const Version> current;
+        bool stop = false;
+
+        // Number of runs created so far, used for naming run files
+        uint64_t next_run = 0;
+
+        std::thread compactor;
+};
+
+} // ycsbc
+
+#endif /* YCSB_C_LSM_DB_H */
@@ -0,0 +1,65 @@
+//
+//  null_db.h
+//  YCSB-C
+//
+//  Database that stores nothing and answers with synthetic records.
+//
+
+#ifndef YCSB_C_NULL_DB_H_
+#define YCSB_C_NULL_DB_H_
+
+#include "db.h"
+
+#include <string>
+#include <vector>
+
+namespace ycsbc {
+
+// Accepts all writes without storing anything and returns the same synthetic
+// record for every read and scan, without any I/O or locking. The records
+// have field_count fields (named like those of the core workload) with values
+// of field_length bytes. A read of selected fields returns these fields
+// only, each with the synthetic value.
+//
+// Hosted behind a transport, the latency of this backend is the cost of the
+// transport and the serialization alone.
+class NullDB : public DB {
+ public:
+  NullDB(std::size_t field_count, std::size_t field_length);
+
+  int Read(void *ctx, const std::string &table, const std::string &key,
+           const std::vector<std::string> *fields,
+           std::vector<KVPair> &result) override;
+  // Returns len records.
+  int Scan(void *ctx, const std::string &table, const std::string &key,
+           int len, const std::vector<std::string> *fields,
+           std::vector<std::vector<KVPair>> &result) override;
+
+  // The views reference the synthetic record of this object.
+  int ReadView(void *ctx, const std::string &table, const std::string &key,
+               const std::vector<std::string> *fields,
+               ResultView &result) override;
+  int ScanView(void *ctx, const std::string &table, const std::string &key,
+               int len, const std::vector<std::string> *fields,
+               ResultView &result) override;
+
+  int Update(void *ctx, const std::string &table, const std::string &key,
+             std::vector<KVPair> &values) override;
+  int Insert(void *ctx, const std::string &table, const std::string &key,
+             std::vector<KVPair> &values) override;
+  int Delete(void *ctx, const std::string &table,
+             const std::string &key) override;
+
+ private:
+  void FillRecord(const std::vector<std::string> *fields,
+                  std::vector<KVPair> &record) const;
+  void AddRecord(const std::vector<std::string> *fields,
+                 ResultView &result) const;
+
+  std::vector<std::string> field_names_;
+  std::string value_;
+};
+
+} // ycsbc
+
+#endif // YCSB_C_NULL_DB_H_
@@ -0,0 +1,65 @@
+//
+//  partitioned_db.h
+//  YCSB-C
+//
+//  In-memory database that hash-partitions the keys over per-core shards.
+//
+
+#ifndef YCSB_C_PARTITIONED_DB_H_
+#define YCSB_C_PARTITIONED_DB_H_
+
+#include "db.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ycsbc {
+
+// Every shard holds the records of its part of the key space in ordered maps
+// and is owned by a thread of its own.
+//
+// With delegation, only the owner thread accesses the shard: benchmark
+// threads send their operations to it through lock-free single-producer
+// single-consumer queues and spin for the completion. The owner threads are
+// placed on the last online CPUs with ycsbc::migrate().
+// Without delegation, benchmark threads access the shards directly under a
+// per-shard lock, which makes the cost of sharing cache lines comparable on
+// the very same data structures.
+class PartitionedDB : public DB {
+ public:
+  PartitionedDB(std::size_t num_shards, bool delegate);
+  ~PartitionedDB();
+
+  void *Init() override;
+  void Close(void *ctx) override;
+
+  int Read(void *ctx, const std::string &table, const std::string &key,
+           const std::vector<std::string> *fields,
+           std::vector<KVPair> &result) override;
+  // Executed on all shards concurrently, the results are merged by key.
+  int Scan(void *ctx, const std::string &table, const std::string &key,
+           int len, const std::vector<std::string> *fields,
+           std::vector<std::vector<KVPair>> &result) override;
+  int Update(void *ctx, const std::string &table, const std::string &key,
+             std::vector<KVPair> &values) override;
+  int Insert(void *ctx, const std::string &table, const std::string &key,
+             std::vector<KVPair> &values) override;
+  int Delete(void *ctx, const std::string &table,
+             const std::string &key) override;
+
+  struct Shard;
+  struct Request;
+
+ private:
+  std::size_t ShardOf(const std::string &key) const;
+  // Execute req on shard and wait for its completion.
+  void Call(void *ctx, std::size_t shard, Request &req);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  bool delegate_;
+};
+
+} // ycsbc
+
+#endif // YCSB_C_PARTITIONED_DB_H_
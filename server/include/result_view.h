@@ -0,0 +1,131 @@
+/* Non-owning views on the results of read and scan operations. */
+
+#pragma once
+
+#include <cstring>   // For memcpy and size_t.
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ycsbc {
+
+// A non-owning reference to a sequence of bytes (like C++17's string_view).
+struct Slice {
+  char const *data = nullptr;
+  std::size_t size = 0;
+
+  Slice() = default;
+  Slice(char const *data, std::size_t size) : data{data}, size{size} {}
+  Slice(std::string const &s) : data{s.data()}, size{s.size()} {}
+
+  std::string str() const { return std::string(data, size); }
+};
+
+// Field/value slices of the records returned by a read or scan.
+//
+// The slices either point into memory owned by the backend (e.g., a response
+// buffer) or into the arena of this object. In both cases, they are only
+// valid until the next operation using this view or the same DB context.
+// A view is meant to be reused across operations, so that the memory of its
+// arena and bookkeeping vectors is allocated only once.
+class ResultView {
+public:
+  typedef std::pair<Slice, Slice> Field;
+  typedef std::pair<std::string, std::string> KVPair;
+
+  ResultView() = default;
+  ResultView(ResultView const &) = delete;
+  ResultView &operator=(ResultView const &) = delete;
+
+  // Drop all records. Keeps the memory for reuse.
+  void Clear() {
+    fields.clear();
+    records.clear();
+    block = 0;
+    used = 0;
+  }
+
+  // Start a new record. Following calls to Add() append to this record.
+  void AddRecord() { records.push_back(fields.size()); }
+  // Append a field/value pair to the current record.
+  void Add(Slice field, Slice value) { fields.emplace_back(field, value); }
+
+  // Copy bytes into the arena and return a slice referencing the copy.
+  Slice Copy(char const *data, std::size_t size) {
+    // Skip blocks that cannot hold the copy anymore.
+    while (block < blocks.size() && used + size > blocks[block].size) {
+      block++;
+      used = 0;
+    }
+    if (block == blocks.size()) {
+      std::size_t block_size = BLOCK_SIZE;
+      blocks.emplace_back(size > block_size ? size : block_size);
+    }
+
+    char *dst = blocks[block].data.get() + used;
+    if (size)
+      std::memcpy(dst, data, size);
+    used += size;
+    return {dst, size};
+  }
+
+  // Number of records.
+  std::size_t Records() const { return records.size(); }
+  // Number of fields of the record with index `record`.
+  std::size_t Fields(std::size_t record) const {
+    return end(record) - begin(record);
+  }
+  // Iterators over the fields of the record with index `record`.
+  Field const *begin(std::size_t record) const {
+    return fields.data() + records.at(record);
+  }
+  Field const *end(std::size_t record) const {
+    return fields.data() + (record + 1 < records.size() ? records[record + 1]
+                                                         : fields.size());
+  }
+
+  // Copy the record with index `record` into a vector of owning strings.
+  void ToVector(std::size_t record, std::vector<KVPair> &out) const {
+    out.clear();
+    for (auto f = begin(record); f != end(record); ++f)
+      out.emplace_back(f->first.str(), f->second.str());
+  }
+
+  // Storage for backends which only implement the vector interface.
+  // Assign() makes the view reference these vectors.
+  std::vector<std::vector<KVPair>> &Owned() { return owned; }
+  void Assign(std::vector<std::vector<KVPair>> const &rows) {
+    Clear();
+    for (auto &row : rows) {
+      AddRecord();
+      for (auto &kv : row)
+        Add(kv.first, kv.second);
+    }
+  }
+
+private:
+  // Default size of arena blocks, larger copies get a block of their own.
+  static constexpr std::size_t BLOCK_SIZE = 64 << 10;
+
+  struct Block {
+    std::unique_ptr<char[]> data;
+    std::size_t size;
+
+    explicit Block(std::size_t size) : data{new char[size]}, size{size} {}
+  };
+
+  // Fields of all records, records are consecutive.
+  std::vector<Field> fields{};
+  // Index of the first field of every record.
+  std::vector<std::size_t> records{};
+
+  // Arena for copied bytes. Blocks are never freed, only reused.
+  std::vector<Block> blocks{};
+  std::size_t block = 0;
+  std::size_t used = 0;
+
+  std::vector<std::vector<KVPair>> owned{};
+};
+
+} // namespace ycsbc
@@ -7,12 +7,38 @@
 #pragma once
 
 #include <cstring> // For memcpy and size_t.
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "db.h"
 
 namespace serializer {
 
+// Table and column ids for the compact encoding of benchmark operations.
+// Both sides build the same Schema from the tables exchanged at CreateSchema
+// time, so that table and field names need not be sent with every request or
+// response. Column ids start at 1. Id 0 marks a field which is not part of the
+// schema (e.g., the key column), its name is sent as string instead.
+class Schema {
+  ycsbc::DB::Tables tables;
+  std::unordered_map<std::string, std::size_t> table_ids;
+  std::vector<std::unordered_map<std::string, std::size_t>> column_ids;
+
+public:
+  Schema() = default;
+  explicit Schema(ycsbc::DB::Tables tables);
+
+  // Report the id of the table `name`. Throws if the table is unknown.
+  std::size_t table_id(std::string const &name) const;
+  // Report the name of the table with id `table`.
+  std::string const &table(std::size_t table) const;
+  // Report the id of column `name` of a table, or 0 if it is unknown.
+  std::size_t column_id(std::size_t table, std::string const &name) const;
+  // Report the name of the column with id `column` (> 0) of a table.
+  std::string const &column(std::size_t table, std::size_t column) const;
+};
+
 class Serializer {
   // Store original start so we can later report the length.
   char const *const orig_buf;
@@ -36,6 +62,8 @@ public:
   Serializer &operator<<(std::string const &);
   // Serialize a Table.
   Serializer &operator<<(ycsbc::Table const &);
+  // Serialize a Slice. Same format as for a string.
+  Serializer &operator<<(ycsbc::Slice const &);
   // Serialize an std::vector if the value type is also serializable.
   template <class T> inline Serializer &operator<<(std::vector<T> const &v) {
     *this << v.size();
@@ -53,20 +81,72 @@ public:
     return *this;
   }
 
+
+  // Compact encoding using the ids of a Schema and variable-length integers.
+  // Field names and values are always encoded relative to the table with id
+  // `table`.
+
+  // Serialize an unsigned integer as LEB128 varint.
+  Serializer &varint(std::size_t);
+  // Serialize bytes prefixed with their varint length.
+  Serializer &bytes(ycsbc::Slice const &);
+  // Serialize a field name as column id.
+  Serializer &field(Schema const &, std::size_t table, ycsbc::Slice const &);
+  // Serialize a list of field names (NULL is sent like an empty list).
+  Serializer &fields(Schema const &, std::size_t table,
+                     std::vector<std::string> const *);
+  // Serialize field/value pairs.
+  Serializer &values(Schema const &, std::size_t table,
+                     std::vector<ycsbc::DB::KVPair> const &);
+  // Serialize the record with index `i` of a ResultView. Serializes an empty
+  // record if `i` is out of range.
+  Serializer &record(Schema const &, std::size_t table,
+                     ycsbc::ResultView const &, std::size_t i);
+  // Serialize all records of a ResultView.
+  Serializer &records(Schema const &, std::size_t table,
+                      ycsbc::ResultView const &);
+  // Serialize the records of a ResultView starting at index `first` as one
+  // chunk of a streamed response. Takes as many records as fit into the
+  // buffer (at least one) and returns the index of the first record left
+  // over. The chunk tells the receiver whether more chunks follow.
+  std::size_t chunk(Schema const &, std::size_t table,
+                    ycsbc::ResultView const &, std::size_t first);
+
+  // Report the number of bytes used by varint().
+  static std::size_t varint_size(std::size_t);
+  // Report the number of bytes used by record().
+  static std::size_t record_size(Schema const &, std::size_t table,
+                                 ycsbc::ResultView const &, std::size_t i);
+
   // Report the start of the buffer (as given in the constructor).
   inline char const *start() const { return orig_buf; }
   // Report the current amount of bytes used in the buffer for serialized data.
   inline std::size_t length() const { return buf - orig_buf; }
+  // Report the number of bytes left in the buffer.
+  inline std::size_t remaining() const { return end - buf; }
 };
 
 class Deserializer {
   char const *buf;
+  char const *const end;
+
+  // Assert that the internal buffer has at least `n` bytes remaining.
+  void assert_remaining(std::size_t n) const;
+  // Deserialize a number of bytes.
+  void deserialize(void *, std::size_t);
+  // Skip a number of bytes and return their start.
+  char const *skip(std::size_t);
+
+  // Append a single record (compact encoding) to a ResultView. With `copy`,
+  // everything referencing the buffer is copied into the view.
+  Deserializer &append_record(Schema const &, std::size_t table,
+                              ycsbc::ResultView &, bool copy = false);
 
 public:
-  // Create a new deserializer from the buffer `buf`.
-  // It is assumed that the data is valid and complete. Then, the buffer
-  // accesses should never overflow.
-  Deserializer(char const *buf);
+  // Create a new deserializer for the buffer `buf` with length `len`.
+  // Every read is checked against the end of the buffer. Reading beyond it
+  // (i.e., from truncated or corrupt data) throws an std::runtime_error.
+  Deserializer(char const *buf, std::size_t len);
 
   // Deserialize an int.
   Deserializer &operator>>(int &);
@@ -76,18 +156,57 @@ public:
   Deserializer &operator>>(std::string &);
   // Deserialize a Table.
   Deserializer &operator>>(ycsbc::Table &);
+  // Deserialize a Slice. The slice points into the buffer, nothing is copied.
+  Deserializer &operator>>(ycsbc::Slice &);
+
+  // Compact encoding, see Serializer. Deserializing into existing vectors
+  // reuses the memory of their elements.
+
+  // Deserialize an unsigned LEB128 varint.
+  Deserializer &varint(std::size_t &);
+  // Deserialize bytes prefixed with their varint length.
+  Deserializer &bytes(std::string &);
+  // Deserialize bytes without copying. The slice points into the buffer.
+  Deserializer &bytes(ycsbc::Slice &);
+  // Deserialize a field name. The slice points into the schema or the buffer.
+  Deserializer &field(Schema const &, std::size_t table, ycsbc::Slice &);
+  // Deserialize a list of field names.
+  Deserializer &fields(Schema const &, std::size_t table,
+                       std::vector<std::string> &);
+  // Deserialize field/value pairs (also used for a single record).
+  Deserializer &values(Schema const &, std::size_t table,
+                       std::vector<ycsbc::DB::KVPair> &);
+  // Deserialize records.
+  Deserializer &records(Schema const &, std::size_t table,
+                        std::vector<std::vector<ycsbc::DB::KVPair>> &);
+  // Deserialize a single record into a ResultView. The view references the
+  // schema and the buffer, so it is only valid as long as both are.
+  Deserializer &record(Schema const &, std::size_t table, ycsbc::ResultView &);
+  // Deserialize records into a ResultView (see record()).
+  Deserializer &records(Schema const &, std::size_t table,
+                        ycsbc::ResultView &);
+  // Deserialize a chunk of a streamed response (see Serializer) into the
+  // records of `r` starting at index `first`. Returns whether more chunks
+  // follow.
+  bool chunk(Schema const &, std::size_t table,
+             std::vector<std::vector<ycsbc::DB::KVPair>> &r, std::size_t first);
+  // Deserialize a chunk of a streamed response into a ResultView. The view is
+  // cleared with `first`, otherwise the records are appended. If more chunks
+  // follow, the records are copied into the view because the buffer will be
+  // overwritten by the next chunk. Returns whether more chunks follow.
+  bool chunk(Schema const &, std::size_t table, ycsbc::ResultView &,
+             bool first);
   // Deserialize an std::vector if the value type is also deserializable.
+  // The elements are deserialized in place, so the memory of elements already
+  // present in `v` is reused.
   template <class T> inline Deserializer &operator>>(std::vector<T> &v) {
-    v.clear();
-
     std::size_t size{};
     *this >> size;
-    v.reserve(size);
-    for (std::size_t i = 0; i < size; i++) {
-      T e{};
+    // Every element takes at least one byte, do not trust larger sizes.
+    assert_remaining(size);
+    v.resize(size);
+    for (auto &e : v)
       *this >> e;
-      v.push_back(e);
-    }
     return *this;
   }
   // Deserialize a std::pair if both components are deserializable as well
@@ -99,6 +218,9 @@ public:
 
     return *this;
   }
+
+  // Report the number of bytes not yet deserialized.
+  inline std::size_t remaining() const { return end - buf; }
 };
 
 } // namespace ycsbc
@@ -0,0 +1,60 @@
+/* Helpers of the backends that hash-partition the keys over shards. */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>  // For std::function
+#include <queue>       // For std::priority_queue
+#include <string>
+#include <vector>
+
+namespace ycsbc {
+
+// 64 bit FNV-1a hash over the bytes of a key.
+inline uint64_t fnv_hash(std::string const &key) {
+  uint64_t hash = 0xCBF29CE484222325;
+  for (unsigned char c : key) {
+    hash ^= c;
+    hash *= 1099511628211;
+  }
+  return hash;
+}
+
+// Merge the scan results of several shards into the first len rows of result.
+// keys[i] and rows[i] are the keys and rows of shard i, sorted by key. The
+// rows are swapped into result, so that both keep their buffers. Returns the
+// number of rows in result.
+template <typename Row>
+std::size_t merge_sorted_rows(std::vector<std::vector<std::string>> const &keys,
+                              std::vector<std::vector<Row>> &rows,
+                              std::size_t len, std::vector<Row> &result) {
+  // k-way merge: the heap holds the shards with remaining rows, ordered by
+  // the key of their next row.
+  std::vector<std::size_t> pos(keys.size(), 0);
+  auto greater = [&](std::size_t a, std::size_t b) {
+    return keys[b][pos[b]] < keys[a][pos[a]];
+  };
+  std::priority_queue<std::size_t, std::vector<std::size_t>,
+                      std::function<bool(std::size_t, std::size_t)>>
+      heap{greater};
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    if (!keys[i].empty())
+      heap.push(i);
+  }
+
+  std::size_t n = 0;
+  while (!heap.empty() && n < len) {
+    std::size_t shard = heap.top();
+    heap.pop();
+
+    if (n == result.size())
+      result.emplace_back();
+    result[n++].swap(rows[shard][pos[shard]]);
+    if (++pos[shard] < keys[shard].size())
+      heap.push(shard);
+  }
+  result.resize(n);
+  return n;
+}
+
+} // namespace ycsbc
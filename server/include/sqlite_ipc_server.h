@@ -14,6 +14,18 @@
 namespace sqlite {
 namespace ipc {
 
+// Maximum size of the request and the response passed in the message registers
+// by BenchI::exec(). Leaves some registers for the opcode, the lengths of the
+// arrays and the return value.
+static const size_t UTCB_PAYLOAD_SIZE =
+    (L4_UTCB_GENERIC_DATA_SIZE - 8) * sizeof(l4_umword_t);
+
+// Return value of the operations of BenchI if the database failed the
+// operation (e.g., the record does not exist or the request was malformed).
+// The response carries no data then, except the header of the latency
+// breakdown. Negative values are errors of the transport.
+static const long RESULT_FAILED = 1;
+
 // IPC interface to a single benchmark thread, which performs the Read(),
 // Scan(), etc. operations.
 struct BenchI : L4::Kobject_t<BenchI, L4::Kobject, 0x42> {
@@ -24,6 +36,10 @@ struct BenchI : L4::Kobject_t<BenchI, L4::Kobject, 0x42> {
   // Performs a scan operation by collecting parameters from the input dataspace
   // handed over previously during the spawn procedure
   L4_INLINE_RPC(long, scan, ());
+
+  // Fetches the next chunk of the result of the previous scan operation into
+  // the output dataspace, if the result did not fit into a single one.
+  L4_INLINE_RPC(long, scan_next, ());
   
   // Performs an insert operation. Parameters are collected from the input
   // Dataspace
@@ -37,6 +53,14 @@ struct BenchI : L4::Kobject_t<BenchI, L4::Kobject, 0x42> {
   // Dataspace
   L4_INLINE_RPC(long, del, ());
  
+  // Performs a read ('r'), insert ('i'), update ('u') or delete ('d')
+  // operation with parameters passed in the message registers instead of the
+  // input dataspace. The response of reads starts with a flag telling whether
+  // the record follows in the message registers as well or has been written to
+  // the output dataspace because it is too large.
+  L4_INLINE_RPC(long, exec, (char opcode, L4::Ipc::Array<char const> req,
+                             L4::Ipc::Array<char> &resp));
+
   // Unmaps client-provided dataspace resources.
   L4_INLINE_RPC(long, close, ());
 
@@ -47,8 +71,8 @@ struct BenchI : L4::Kobject_t<BenchI, L4::Kobject, 0x42> {
   // something.
   L4_INLINE_RPC(long, terminate, (), L4::Ipc::Send_only);
 
-  typedef L4::Typeid::Rpcs<read_t, scan_t, insert_t, update_t, del_t,
-                           close_t, terminate_t> Rpcs;
+  typedef L4::Typeid::Rpcs<read_t, scan_t, scan_next_t, insert_t, update_t,
+                           del_t, exec_t, close_t, terminate_t> Rpcs;
 };
 
 // Interface for the database management and the factory for new benchmark
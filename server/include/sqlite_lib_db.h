@@ -14,13 +14,33 @@
 #include "db.h"                     // YCSBC interface for databases
 #include <sqlite3.h>                // Definitions for Sqlite
 
+#include <atomic>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace ycsbc {
 
 struct Ctx;
 
+/*
+ * Tuning knobs for the sqlite backend. The defaults resemble a plain sqlite
+ * setup where every statement runs in its own (autocommit) transaction.
+ */
+struct SqliteLibOptions {
+    // Number of inserts grouped into one explicit transaction during the
+    // load phase. Values below 2 keep the autocommit behavior.
+    std::size_t load_batch = 0;
+
+    // Create the tables without a key index and build it only after all
+    // records have been loaded. Not supported for BLOB rows.
+    bool defer_index = false;
+
+    // Store all fields of a record packed into a single BLOB column of a
+    // WITHOUT ROWID table instead of using one TEXT column per field.
+    bool blob_rows = false;
+};
+
 class SqliteLibDB : public DB {
     public:
         /*
@@ -28,13 +48,28 @@ class SqliteLibDB : public DB {
          * benchmark database. By default, the in-memory implementation of
          * sqlite is used.
          */
-        SqliteLibDB(const std::string &filename = std::string(":memory:"));
+        SqliteLibDB(const std::string &filename = std::string(":memory:"),
+                    const SqliteLibOptions &options = SqliteLibOptions{});
         ~SqliteLibDB() override;
 
         void CreateSchema(DB::Tables tables) override;
         void *Init() override;
         void Close(void *ctx) override;
 
+        void BeginLoad() override;
+        void EndLoad() override;
+
+        /*
+         * The snapshot is a sqlite database file, copied from and to the
+         * benchmark database with the backup API. It includes the indexes,
+         * so it must be restored with the same options. The description of
+         * the records is kept in the additional table YCSBC_SNAPSHOT.
+         */
+        bool Snapshot(const std::string &path,
+                      const std::string &records) override;
+        bool Restore(const std::string &path,
+                     const std::string &records) override;
+
         int Read(void *ctx, const std::string &table, const std::string &key,
                  const std::vector<std::string> *fields,
                  std::vector<KVPair> &result) override;
@@ -43,6 +78,24 @@ class SqliteLibDB : public DB {
                  int len, const std::vector<std::string> *fields,
                  std::vector<std::vector<KVPair>> &result) override;
 
+        int ReadView(void *ctx, const std::string &table,
+                     const std::string &key,
+                     const std::vector<std::string> *fields,
+                     ResultView &result) override;
+
+        int ScanView(void *ctx, const std::string &table,
+                     const std::string &key, int len,
+                     const std::vector<std::string> *fields,
+                     ResultView &result) override;
+
+        // Like Scan(), but additionally appends the key of every result row
+        // to keys (if not NULL).
+        int ScanWithKeys(void *ctx, const std::string &table,
+                         const std::string &key, int len,
+                         const std::vector<std::string> *fields,
+                         std::vector<std::vector<KVPair>> &result,
+                         std::vector<std::string> *keys);
+
         int Update(void *ctx, const std::string &table, const std::string &key,
                    std::vector<KVPair> &values) override;
 
@@ -56,12 +109,45 @@ class SqliteLibDB : public DB {
         // Filename of the DB
         const std::string filename;
 
+        // Tuning options handed over at construction time
+        const SqliteLibOptions options;
+
+        // Tables created by CreateSchema(), needed for (re)building indexes
+        DB::Tables schema_tables;
+
+        // Set between BeginLoad() and EndLoad(). Contexts created while
+        // loading batch their inserts into larger transactions.
+        std::atomic<bool> loading{false};
+
         // Database connection used for creating the schema.
         // It must be kept alive to keep in-memory databases alive.
         sqlite3 *schema_database = nullptr;
 
         // Open a new database connection.
         sqlite3* OpenDB() const;
+
+        // Columns of every table in schema order, i.e., the order of the
+        // fields inside packed BLOB rows.
+        std::unordered_map<std::string, std::vector<std::string>> columns;
+
+        // Index of field in the packed rows of table (or -1 if unknown).
+        int ColumnIndex(const std::string &table,
+                        const std::string &field) const;
+
+        // Implementations of the benchmark operations for BLOB rows.
+        int ReadBlob(void *ctx, const std::string &table,
+                     const std::string &key,
+                     const std::vector<std::string> *fields,
+                     std::vector<KVPair> &result);
+        int ScanBlob(void *ctx, const std::string &table,
+                     const std::string &key, int len,
+                     const std::vector<std::string> *fields,
+                     std::vector<std::vector<KVPair>> &result,
+                     std::vector<std::string> *keys);
+        int UpdateBlob(void *ctx, const std::string &table,
+                       const std::string &key, std::vector<KVPair> &values);
+        int InsertBlob(void *ctx, const std::string &table,
+                       const std::string &key, std::vector<KVPair> &values);
 };  
 
 } // ycsbc
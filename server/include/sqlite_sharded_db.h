@@ -0,0 +1,79 @@
+/******************************************************************************
+ *                                                                            *
+ * sqlite_sharded_db.h - A database backend that hash-partitions the records  *
+ *                       over several independent sqlite databases.           *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef YCSB_C_SQLITE_SHARDED_H
+#define YCSB_C_SQLITE_SHARDED_H
+
+#include "db.h"                     // YCSBC interface for databases
+#include "sqlite_lib_db.h"          // Backend driving a single shard
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ycsbc {
+
+class SqliteShardedDB : public DB {
+    public:
+        /*
+         * Create a database consisting of nshards independent sqlite
+         * databases. For the in-memory implementation of sqlite, every shard
+         * gets its own named in-memory database, otherwise the shard number
+         * is appended to filename.
+         */
+        SqliteShardedDB(std::size_t nshards,
+                        const std::string &filename = std::string(":memory:"),
+                        const SqliteLibOptions &options = SqliteLibOptions{});
+
+        void CreateSchema(DB::Tables tables) override;
+        void *Init() override;
+        void Close(void *ctx) override;
+
+        void BeginLoad() override;
+        void EndLoad() override;
+
+        // Every shard is written to its own snapshot, path followed by a dot
+        // and the number of the shard. The file path itself is a manifest
+        // holding the number of shards and the description of the records.
+        bool Snapshot(const std::string &path,
+                      const std::string &records) override;
+        bool Restore(const std::string &path,
+                     const std::string &records) override;
+
+        int Read(void *ctx, const std::string &table, const std::string &key,
+                 const std::vector<std::string> *fields,
+                 std::vector<KVPair> &result) override;
+
+        int Scan(void *ctx, const std::string &table, const std::string &key,
+                 int len, const std::vector<std::string> *fields,
+                 std::vector<std::vector<KVPair>> &result) override;
+
+        int ReadView(void *ctx, const std::string &table,
+                     const std::string &key,
+                     const std::vector<std::string> *fields,
+                     ResultView &result) override;
+
+        int Update(void *ctx, const std::string &table, const std::string &key,
+                   std::vector<KVPair> &values) override;
+
+        int Insert(void *ctx, const std::string &table, const std::string &key,
+                  std::vector<KVPair> &values) override;
+
+        int Delete(void *ctx, const std::string &table,
+                   const std::string &key) override;
+
+    private:
+        // One independent database per partition of the key space
+        std::vector<std::unique_ptr<SqliteLibDB>> shards;
+
+        // Index of the shard responsible for key.
+        std::size_t ShardOf(const std::string &key) const;
+};
+
+} // ycsbc
+
+#endif /* YCSB_C_SQLITE_SHARDED_H */
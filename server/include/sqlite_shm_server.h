@@ -11,9 +11,27 @@
 #include <l4/sys/kobject>
 #include <l4/re/dataspace>
 
+#include "utils.h"
+
 namespace sqlite {
 namespace shm {
 
+// Maximum number of operations a client thread may have in flight.
+static const size_t MAX_QUEUE_DEPTH = 64;
+
+// The dataspaces of a benchmark thread are divided into depth slots, one per
+// operation in flight. The first byte of every slot is used for notification.
+// Slots are aligned to cache lines to avoid false sharing.
+static inline size_t slot_size(size_t depth) {
+  return (YCSBC_DS_SIZE / depth) & ~static_cast<size_t>(63);
+}
+
+// Values of the notification byte of a response: the operation succeeded, or
+// it failed (e.g., the record does not exist or the request was malformed).
+// The response to a failed operation carries no data.
+static const char RESPONSE_OK = 1;
+static const char RESPONSE_FAILED = 2;
+
 // Interface for the database management and the factory for new benchmark
 // threads. Make sure to reserve two capability slots in this IF.
 struct DbI : L4::Kobject_t<DbI, L4::Kobject, 0x43, L4::Type_info::Demand_t<2>> {
@@ -23,9 +41,11 @@ struct DbI : L4::Kobject_t<DbI, L4::Kobject, 0x43, L4::Type_info::Demand_t<2>> {
   // client-provided capability.
   L4_INLINE_RPC(long, schema, (L4::Ipc::Cap<L4Re::Dataspace>));
   
-  // Spawn a new thread on cpu with its own database connection.
+  // Spawn a new thread on cpu with its own database connection, serving up
+  // to depth operations at the same time (see slot_size()).
   L4_INLINE_RPC(long, spawn, (L4::Ipc::Cap<L4Re::Dataspace>, 
-                              L4::Ipc::Cap<L4Re::Dataspace>, l4_umword_t cpu));
+                              L4::Ipc::Cap<L4Re::Dataspace>, l4_umword_t cpu,
+                              l4_umword_t depth));
 
   typedef L4::Typeid::Rpcs<schema_t, spawn_t> Rpcs;
 };
@@ -0,0 +1,295 @@
+/* CPU topology and placement of benchmark threads.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "utils.h"
+
+namespace ycsbc {
+
+// Position of a CPU in the topology of the machine. Cores, L3 domains and
+// packages are numbered by the APIC ids of their CPUs, so the numbers are
+// unique machine-wide but not dense.
+struct CpuInfo {
+  l4_umword_t cpu;   // L4 CPU number
+  unsigned apic;     // (x2)APIC id
+  unsigned core;     // Physical core, shared by SMT siblings
+  unsigned l3;       // Domain sharing the last-level cache
+  unsigned package;  // Socket, also taken as the NUMA node
+};
+
+namespace topology {
+
+// Number of bits needed for n distinct ids
+static inline unsigned id_bits(unsigned n) {
+  unsigned bits = 0;
+  while ((1u << bits) < n)
+    bits++;
+  return bits;
+}
+
+// Describe the CPU the calling thread runs on.
+static inline CpuInfo describe(l4_umword_t cpu) {
+  CpuInfo info{cpu, 0, 0, 0, 0};
+#if defined(__i386__) || defined(__x86_64__)
+  unsigned eax, ebx, ecx, edx;
+  unsigned max = __get_cpuid_max(0, nullptr);
+  unsigned smt_shift = 0, package_shift = 0, l3_shift = 0;
+
+  if (max >= 0xb) {
+    // Extended topology: the x2APIC id and the id bits of every level.
+    for (unsigned sub = 0;; sub++) {
+      __cpuid_count(0xb, sub, eax, ebx, ecx, edx);
+      unsigned type = (ecx >> 8) & 0xff;
+      if (type == 0)
+        break;
+      if (type == 1)
+        smt_shift = eax & 0x1f;
+      package_shift = eax & 0x1f;
+      info.apic = edx;
+    }
+  } else {
+    // Legacy: only the number of logical CPUs per package is known.
+    __cpuid(1, eax, ebx, ecx, edx);
+    info.apic = ebx >> 24;
+    if (edx & (1 << 28))
+      package_shift = id_bits((ebx >> 16) & 0xff);
+  }
+
+  // Deterministic cache parameters (leaf 0x8000001d on AMD): the number of
+  // ids sharing the last-level cache
+  unsigned leaf = 4;
+  __cpuid(0, eax, ebx, ecx, edx);
+  if (ebx == 0x68747541 /* "Auth"enticAMD */) {
+    __cpuid(0x80000000, eax, ebx, ecx, edx);
+    leaf = eax >= 0x8000001d ? 0x8000001d : 0;
+  } else if (max < 4) {
+    leaf = 0;
+  }
+  for (unsigned sub = 0; leaf; sub++) {
+    __cpuid_count(leaf, sub, eax, ebx, ecx, edx);
+    if ((eax & 0x1f) == 0)
+      break;
+    if (((eax >> 5) & 0x7) == 3)
+      l3_shift = id_bits(((eax >> 14) & 0xfff) + 1);
+  }
+  // Without an L3, the whole package shares the last-level cache.
+  if (!l3_shift || l3_shift > package_shift)
+    l3_shift = package_shift;
+
+  info.core = info.apic >> smt_shift;
+  info.l3 = info.apic >> l3_shift;
+  info.package = info.apic >> package_shift;
+#else
+  // Elsewhere, every CPU is a core of its own in a single package.
+  info.apic = info.core = cpu;
+#endif
+  return info;
+}
+
+} // namespace topology
+
+// Discover the topology of the given CPUs by running CPUID on each of them.
+// The result is ordered by package, L3 domain, core and SMT sibling.
+static inline std::vector<CpuInfo>
+discover_topology(std::vector<l4_umword_t> const &cpus) {
+  std::vector<CpuInfo> infos;
+  // Migrate a helper thread instead of the caller, which stays where it is.
+  std::thread probe([&] {
+    for (auto cpu : cpus) {
+      migrate(cpu);
+      infos.push_back(topology::describe(cpu));
+    }
+  });
+  probe.join();
+
+  std::sort(infos.begin(), infos.end(), [](CpuInfo const &a, CpuInfo const &b) {
+    return std::make_tuple(a.package, a.l3, a.core, a.apic) <
+           std::make_tuple(b.package, b.l3, b.core, b.apic);
+  });
+  return infos;
+}
+
+// Relation between two CPUs, from the closest to the most distant
+static inline char const *cpu_relation(CpuInfo const &a, CpuInfo const &b) {
+  if (a.cpu == b.cpu)
+    return "same CPU";
+  if (a.core == b.core)
+    return "SMT siblings";
+  if (a.l3 == b.l3)
+    return "same L3";
+  if (a.package == b.package)
+    return "same package";
+  return "different packages";
+}
+
+// Select the CPUs of the client thread and of its database thread for
+// num_threads client threads according to a placement policy:
+//
+// - compact: fill SMT siblings, then cores, then L3 domains and packages
+// - scatter: spread all threads as far as possible over packages, L3
+//   domains and cores before using SMT siblings
+// - same: client and database thread on the same CPU, every pair on its own
+//   core if possible
+// - smt: client and database thread on SMT siblings of one core
+// - l3: client and database thread on different cores sharing an L3
+// - remote: client and database thread in different packages
+//
+// Pairs are assigned round-robin once all suitable CPUs are in use. Throws
+// std::runtime_error for unknown policies and for policies that the topology
+// cannot satisfy.
+static inline std::vector<std::pair<l4_umword_t, l4_umword_t>>
+place_threads(std::vector<CpuInfo> const &topo, std::string const &policy,
+              int num_threads) {
+  if (topo.empty())
+    throw std::runtime_error{"cpu list empty"};
+
+  // CPUs grouped by core, in topology order
+  typedef std::vector<CpuInfo> Core;
+  std::vector<Core> cores;
+  for (auto const &c : topo) {
+    if (cores.empty() || cores.back().back().core != c.core)
+      cores.emplace_back();
+    cores.back().push_back(c);
+  }
+
+  // Scatter order: the first SMT sibling of every core before the second,
+  // and consecutive CPUs in different packages, then in different L3 domains.
+  // The key of a CPU is the index of its sibling in the core, of its core in
+  // the L3 domain, of the domain in the package and of the package.
+  typedef std::pair<std::tuple<size_t, size_t, size_t, size_t>, CpuInfo> Keyed;
+  std::vector<Keyed> keyed;
+  size_t n_package = 0, n_l3 = 0, n_core = 0, n_sibling = 0;
+  for (size_t i = 0; i < topo.size(); i++) {
+    CpuInfo const &c = topo[i];
+    if (i > 0) {
+      CpuInfo const &prev = topo[i - 1];
+      if (c.package != prev.package) {
+        n_package++;
+        n_l3 = n_core = n_sibling = 0;
+      } else if (c.l3 != prev.l3) {
+        n_l3++;
+        n_core = n_sibling = 0;
+      } else if (c.core != prev.core) {
+        n_core++;
+        n_sibling = 0;
+      } else {
+        n_sibling++;
+      }
+    }
+    keyed.emplace_back(std::make_tuple(n_sibling, n_core, n_l3, n_package), c);
+  }
+  std::stable_sort(keyed.begin(), keyed.end(),
+                   [](Keyed const &a, Keyed const &b) {
+                     return a.first < b.first;
+                   });
+  std::vector<CpuInfo> spread;
+  for (auto const &k : keyed)
+    spread.push_back(k.second);
+
+  std::vector<std::pair<CpuInfo, CpuInfo>> pairs;
+  if (policy == "compact") {
+    for (size_t i = 0; i + 1 < topo.size(); i += 2)
+      pairs.emplace_back(topo[i], topo[i + 1]);
+    if (topo.size() == 1)
+      pairs.emplace_back(topo[0], topo[0]);
+  } else if (policy == "scatter") {
+    for (size_t i = 0; i + 1 < spread.size(); i += 2)
+      pairs.emplace_back(spread[i], spread[i + 1]);
+    if (spread.size() == 1)
+      pairs.emplace_back(spread[0], spread[0]);
+  } else if (policy == "same") {
+    for (auto const &c : spread)
+      pairs.emplace_back(c, c);
+  } else if (policy == "smt") {
+    for (auto const &core : cores)
+      for (size_t s = 0; s + 1 < core.size(); s += 2)
+        pairs.emplace_back(core[s], core[s + 1]);
+  } else if (policy == "l3") {
+    // Pair up the cores of every L3 domain, using SMT siblings only once the
+    // first siblings of all domains are in use.
+    std::vector<std::pair<size_t, size_t>> domains;
+    for (size_t c = 0; c < cores.size(); c++) {
+      if (domains.empty() || cores[c][0].l3 != cores[c - 1][0].l3)
+        domains.emplace_back(c, c);
+      domains.back().second = c + 1;
+    }
+    for (size_t s = 0;; s++) {
+      bool any = false;
+      for (auto const &d : domains)
+        for (size_t c = d.first; c + 1 < d.second; c += 2)
+          if (s < cores[c].size() && s < cores[c + 1].size()) {
+            pairs.emplace_back(cores[c][s], cores[c + 1][s]);
+            any = true;
+          }
+      if (!any)
+        break;
+    }
+  } else if (policy == "remote") {
+    // Pair the CPUs of package 2k with those of package 2k + 1 in scatter
+    // order.
+    std::map<unsigned, std::vector<CpuInfo>> packages;
+    for (auto const &c : spread)
+      packages[c.package].push_back(c);
+    std::vector<std::vector<CpuInfo>> list;
+    for (auto &p : packages)
+      list.push_back(p.second);
+    for (size_t p = 0; p + 1 < list.size(); p += 2)
+      for (size_t i = 0; i < std::min(list[p].size(), list[p + 1].size()); i++)
+        pairs.emplace_back(list[p][i], list[p + 1][i]);
+  } else {
+    throw std::runtime_error{"unknown placement policy '" + policy + "'"};
+  }
+  if (pairs.empty())
+    throw std::runtime_error{"placement policy '" + policy +
+                             "' not possible with this topology"};
+
+  std::vector<std::pair<l4_umword_t, l4_umword_t>> placement;
+  for (int i = 0; i < num_threads; i++) {
+    auto const &p = pairs[i % pairs.size()];
+    placement.emplace_back(p.first.cpu, p.second.cpu);
+  }
+  return placement;
+}
+
+// Print the position of a CPU in the topology.
+static inline std::ostream &operator<<(std::ostream &os, CpuInfo const &c) {
+  return os << "CPU " << c.cpu << " (package " << c.package << ", L3 " << c.l3
+            << ", core " << c.core << ", APIC " << c.apic << ")";
+}
+
+// Print the CPUs of every client thread and its database thread and how
+// close they are.
+static inline void
+print_placement(std::ostream &os, std::vector<CpuInfo> const &topo,
+                std::vector<std::pair<l4_umword_t, l4_umword_t>> const &placement) {
+  auto find = [&](l4_umword_t cpu) {
+    for (auto const &c : topo)
+      if (c.cpu == cpu)
+        return c;
+    unsigned id = static_cast<unsigned>(cpu);
+    return CpuInfo{cpu, id, id, 0, 0};
+  };
+
+  for (size_t i = 0; i < placement.size(); i++) {
+    CpuInfo client = find(placement[i].first), db = find(placement[i].second);
+    os << "  thread " << i << ": client " << client << ", database " << db
+       << ", " << cpu_relation(client, db) << std::endl;
+  }
+}
+
+} // namespace ycsbc
@@ -0,0 +1,135 @@
+/* Cycle counter for timing individual operations.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include <l4/re/env.h>   // l4re_kip()
+#include <l4/sys/kip.h>  // l4_kip_clock()
+#include <l4/util/cpu.h> // l4util_cpu_cpuid()
+#include <l4/util/util.h> // l4_sleep()
+
+namespace ycsbc {
+
+// Read the time stamp counter (the virtual counter on ARM). Costs a few dozen
+// cycles and does not wait for preceding instructions, so it is only suited
+// for durations much longer than that. Differences between two reads are only
+// meaningful on the same CPU or with an invariant, synchronized counter.
+static inline uint64_t rdtsc() {
+#if defined(__aarch64__)
+  uint64_t v;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+  return v;
+#else
+  return __builtin_ia32_rdtsc();
+#endif
+}
+
+// Like rdtsc(), but only read the counter after all preceding instructions
+// have completed.
+static inline uint64_t rdtscp() {
+#if defined(__aarch64__)
+  uint64_t v;
+  asm volatile("isb; mrs %0, cntvct_el0" : "=r"(v) : : "memory");
+  return v;
+#else
+  unsigned int aux;
+  return __builtin_ia32_rdtscp(&aux);
+#endif
+}
+
+// Clock with a resolution of nanoseconds based on the cycle counter.
+//
+// The frequency of the counter is calibrated once against the clock of the
+// kernel (the KIP clock), which takes CALIBRATION_MS. On ARM, the frequency
+// of the virtual counter is architecturally defined instead. If the counter
+// does not tick at a constant rate (no invariant TSC, e.g., on many QEMU
+// configurations) or the calibration fails, the clock falls back to
+// std::chrono::steady_clock.
+class TscClock {
+public:
+  static const int CALIBRATION_MS = 50;
+
+  // Report the clock, calibrating it on the first call.
+  static TscClock const &Get() {
+    static TscClock clock;
+    return clock;
+  }
+
+  // Report whether the clock uses std::chrono::steady_clock.
+  bool Fallback() const { return hz == 0; }
+
+  // Report the frequency of the counter in Hz (0 for the fallback).
+  uint64_t Frequency() const { return hz; }
+
+  // Report nanoseconds since an arbitrary point in time.
+  uint64_t Now() const {
+    if (Fallback())
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+    return Nanoseconds(rdtscp());
+  }
+
+  // Convert a number of counter ticks to nanoseconds.
+  uint64_t Nanoseconds(uint64_t ticks) const {
+#if defined(__SIZEOF_INT128__)
+    return static_cast<unsigned __int128>(ticks) * mult >> 32;
+#else
+    return ticks / hz * 1000000000 + ticks % hz * 1000000000 / hz;
+#endif
+  }
+
+private:
+  // Counter frequency and the factor converting ticks into nanoseconds as a
+  // 32.32 fixed point number
+  uint64_t hz;
+  uint64_t mult = 0;
+
+  TscClock() : hz{calibrate()} {
+    if (hz)
+      mult = (static_cast<uint64_t>(1000000000) << 32) / hz;
+  }
+
+  static uint64_t calibrate() {
+#if defined(__aarch64__)
+    uint64_t freq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    return freq;
+#else
+    // Only an invariant TSC ticks at the same rate in all power states.
+    unsigned long eax, ebx, ecx, edx;
+    l4util_cpu_cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    if (eax < 0x80000007)
+      return 0;
+    l4util_cpu_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    if (!(edx & (1 << 8)))
+      return 0;
+
+    // Start at the beginning of a tick of the KIP clock (microseconds).
+    l4_kernel_info_t *kip = l4re_kip();
+    l4_cpu_time_t k0 = l4_kip_clock(kip);
+    for (int i = 0; i < 1000000; i++) {
+      l4_cpu_time_t k = l4_kip_clock(kip);
+      if (k != k0) {
+        k0 = k;
+        break;
+      }
+    }
+    uint64_t t0 = rdtscp();
+
+    l4_sleep(CALIBRATION_MS);
+    uint64_t t1 = rdtscp();
+    l4_cpu_time_t k1 = l4_kip_clock(kip);
+
+    // The KIP clock does not advance in some configurations.
+    if (k1 <= k0)
+      return 0;
+    return (t1 - t0) * 1000000 / (k1 - k0);
+#endif
+  }
+};
+
+} // namespace ycsbc
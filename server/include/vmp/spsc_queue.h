@@ -0,0 +1,74 @@
+//
+//  spsc_queue.h
+//  YCSB-C
+//
+//  Bounded lock-free queue for exactly one producer and one consumer thread.
+//
+
+#ifndef YCSB_C_LIB_SPSC_QUEUE_H_
+#define YCSB_C_LIB_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+
+namespace vmp {
+
+// Capacity N must be a power of two. The indices of both sides are kept a
+// cache line apart, each together with a cached copy of the other side's
+// index, so that the sides only share a line when the queue looks empty or
+// full.
+template <class T, std::size_t N>
+class SpscQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0,
+                "capacity must be a power of two");
+
+ public:
+  SpscQueue() = default;
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // Called by the producer. Returns false if the queue is full.
+  bool Push(const T &value) {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == N) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == N)
+        return false;
+    }
+    buffer_[tail & (N - 1)] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Called by the consumer. Returns false if the queue is empty.
+  bool Pop(T &value) {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_)
+        return false;
+    }
+    value = buffer_[head & (N - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  static const std::size_t CACHE_LINE = 64;
+
+  // Consumer side
+  std::atomic<std::size_t> head_{0};
+  std::size_t tail_cache_ = 0;
+  char consumer_pad_[CACHE_LINE - 2 * sizeof(std::size_t)];
+
+  // Producer side
+  std::atomic<std::size_t> tail_{0};
+  std::size_t head_cache_ = 0;
+  char producer_pad_[CACHE_LINE - 2 * sizeof(std::size_t)];
+
+  T buffer_[N];
+};
+
+} // vmp
+
+#endif // YCSB_C_LIB_SPSC_QUEUE_H_
@@ -13,7 +13,7 @@
 #include <cassert>
 #include <cstdint>
 
-#include "lib/mem_alloc.h"
+#include "vmp/mem_alloc.h"
 
 namespace vmp {
 
@@ -0,0 +1,343 @@
+/* Hosting of arbitrary YCSB-C databases behind the compact message format.
+ */
+
+#include "db_host.h"
+#include "breakdown.h"
+#include "core/utils.h"
+
+#include <climits>
+#include <stdexcept>
+#include <utility>
+
+#include "lock_stl_db.h"
+#include "lsm_db.h"
+#include "null_db.h"
+#include "partitioned_db.h"
+#include "sqlite_lib_db.h"
+#include "sqlite_sharded_db.h"
+
+using serializer::Deserializer;
+using serializer::Schema;
+using serializer::Serializer;
+using ycsbc::DB;
+
+namespace dbhost {
+
+// Report the parameter `key`, or `def` if it is not set.
+static std::string get(Params const &params, std::string const &key,
+                       std::string const &def) {
+  auto it = params.find(key);
+  return it == params.end() ? def : it->second;
+}
+
+static std::size_t get_size(Params const &params, std::string const &key,
+                            std::size_t def) {
+  return std::stoul(get(params, key, std::to_string(def)));
+}
+
+static bool get_bool(Params const &params, std::string const &key, bool def) {
+  try {
+    return utils::StrToBool(get(params, key, def ? "true" : "false"));
+  } catch (utils::Exception const &e) {
+    throw std::invalid_argument{e.what()};
+  }
+}
+
+// Collect the tuning options of the sqlite backends from the parameters.
+static ycsbc::SqliteLibOptions sqlite_options(Params const &params) {
+  ycsbc::SqliteLibOptions options;
+  options.load_batch = get_size(params, "sqlite.batchsize", 0);
+  options.defer_index = get_bool(params, "sqlite.deferindex", false);
+
+  std::string row_format = get(params, "sqlite.rowformat", "columns");
+  if (row_format == "blob")
+    options.blob_rows = true;
+  else if (row_format != "columns")
+    throw std::invalid_argument{"Unknown sqlite row format: " + row_format};
+  return options;
+}
+
+DB *create_db(std::string const &name, Params const &params) {
+  // By default, the sharded backends use one shard per benchmark thread.
+  std::size_t threads = get_size(params, "threadcount", 1);
+
+  if (name == "null") {
+    // By default, the synthetic records look like those of the workload.
+    return new ycsbc::NullDB(
+        get_size(params, "null.fieldcount",
+                 get_size(params, "fieldcount", 10)),
+        get_size(params, "null.fieldlength",
+                 get_size(params, "fieldlength", 100)));
+  } else if (name == "lock_stl") {
+    return new ycsbc::LockStlDB;
+  } else if (name == "partitioned") {
+    return new ycsbc::PartitionedDB(
+        get_size(params, "partitioned.shards", threads),
+        get_bool(params, "partitioned.delegate", true));
+  } else if (name == "lsm") {
+    ycsbc::LsmOptions options;
+    options.path = get(params, "lsm.path", "");
+    options.memtable_size =
+        get_size(params, "lsm.memtablesize", options.memtable_size);
+    options.block_size = get_size(params, "lsm.blocksize", options.block_size);
+    options.max_runs = get_size(params, "lsm.maxruns", options.max_runs);
+    options.bloom_bits = get_size(params, "lsm.bloombits", options.bloom_bits);
+    return new ycsbc::LsmDB(options);
+  } else if (name == "sqlite_lib") {
+    return new ycsbc::SqliteLibDB(":memory:", sqlite_options(params));
+  } else if (name == "sqlite_sharded") {
+    return new ycsbc::SqliteShardedDB(get_size(params, "sqlite.shards", threads),
+                                      ":memory:", sqlite_options(params));
+  }
+
+  return nullptr;
+}
+
+void write_spec(Serializer &s, std::string const &name, Params const &params,
+                DB::Tables const &tables) {
+  s << name;
+  s << std::vector<std::pair<std::string, std::string>>(params.begin(),
+                                                        params.end());
+  s << tables;
+}
+
+bool run_only(Params const &params) { return get(params, "mode", "") == "run"; }
+
+// Parameters of the workload that determine the keys and values of the
+// records loaded
+static Params record_params(Params const &params) {
+  static char const *const keys[] = {"recordcount", "fieldcount",
+                                     "fieldlength", "insertstart",
+                                     "insertorder", "zeropadding"};
+  Params records;
+  for (auto key : keys)
+    records[key] = get(params, key, "");
+  return records;
+}
+
+static bool same_tables(DB::Tables const &a, DB::Tables const &b) {
+  if (a.size() != b.size())
+    return false;
+  for (std::size_t i = 0; i < a.size(); i++)
+    if (a[i].name != b[i].name || a[i].columns != b[i].columns)
+      return false;
+  return true;
+}
+
+DB *Host::open(Deserializer &d, Params &params) {
+  std::string client_name;
+  std::vector<std::pair<std::string, std::string>> pairs;
+  DB::Tables client_tables;
+
+  d >> client_name;
+  d >> pairs;
+  d >> client_tables;
+  params = Params(pairs.begin(), pairs.end());
+
+  if (run_only(params)) {
+    if (!db)
+      throw std::invalid_argument{"No database loaded to run on"};
+    if (client_name != name || !same_tables(client_tables, tables) ||
+        record_params(params) != records)
+      throw std::invalid_argument{
+          "Loaded database does not match the workload of the client"};
+    return db.get();
+  }
+
+  // The sessions refer to the database and the schema.
+  if (sessions > 0)
+    throw std::invalid_argument{"Database still in use by other clients"};
+
+  // Delete the current database first. Named in-memory databases would be
+  // shared with a new database of the same backend otherwise.
+  db.reset();
+  std::unique_ptr<DB> created{create_db(client_name, params)};
+  if (!created)
+    throw std::invalid_argument{"Unknown database " + client_name};
+  created->CreateSchema(client_tables);
+
+  db = std::move(created);
+  schema_ = Schema{client_tables};
+  name = client_name;
+  tables = client_tables;
+  records = record_params(params);
+  return db.get();
+}
+
+// Report the database of host, which must exist.
+static DB &current_db(std::unique_ptr<DB> const &db) {
+  if (!db)
+    throw std::invalid_argument{"No database created"};
+  return *db;
+}
+
+Session::Session(Host &host, bool timed)
+    : host{host}, db{current_db(host.db)}, schema{host.schema_},
+      ctx{db.Init()}, timed{timed} {
+  host.sessions++;
+}
+
+Session::~Session() { close(); }
+
+void Session::close() {
+  if (!ctx)
+    return;
+  db.Close(ctx);
+  ctx = nullptr;
+  host.sessions--;
+}
+
+uint64_t Session::stamp() const { return timed ? ycsbc::rdtsc() : 0; }
+
+void Session::executed(uint64_t since) {
+  if (timed)
+    execute += ycsbc::rdtsc() - since;
+}
+
+std::size_t Session::header_size() const {
+  return timed ? breakdown::HEADER_SIZE : 0;
+}
+
+void Session::begin() {
+  if (!timed)
+    return;
+  start = ycsbc::rdtsc();
+  execute = 0;
+}
+
+void Session::end(char *header) {
+  if (!timed)
+    return;
+  breakdown::write_header(header, {execute, ycsbc::rdtsc() - start});
+}
+
+std::vector<std::string> const *Session::selected() const {
+  return fields.empty() ? nullptr : &fields;
+}
+
+// Deserialize the parameters of a request with `decode`. Returns false if the
+// request is malformed, i.e., the deserializer or the schema reject it.
+template <typename F> static bool decode(F f) {
+  try {
+    f();
+    return true;
+  } catch (std::exception const &) {
+    return false;
+  }
+}
+
+int Session::read(Deserializer &d, Result &r) {
+  std::string const *table = nullptr;
+
+  // A read replaces the result of a streamed scan.
+  r.streaming = false;
+  if (!decode([&] {
+        d.varint(r.table);
+        d.bytes(key);
+        d.fields(schema, r.table, fields);
+        table = &schema.table(r.table);
+      }))
+    return MALFORMED;
+
+  uint64_t since = stamp();
+  int rc = db.ReadView(ctx, *table, key, selected(), r.view);
+  executed(since);
+  return rc;
+}
+
+int Session::scan(Deserializer &d, Result &r) {
+  std::string const *table = nullptr;
+  std::size_t len = 0;
+
+  r.streaming = false;
+  if (!decode([&] {
+        d.varint(r.table);
+        d.bytes(key);
+        d.varint(len);
+        d.fields(schema, r.table, fields);
+        table = &schema.table(r.table);
+      }))
+    return MALFORMED;
+  // The databases take the length of a scan as int.
+  if (len > INT_MAX)
+    return MALFORMED;
+
+  uint64_t since = stamp();
+  int rc = db.ScanView(ctx, *table, key, len, selected(), r.view);
+  executed(since);
+  r.next_record = 0;
+  r.streaming = rc == DB::kOK;
+  return rc;
+}
+
+int Session::insert(Deserializer &d) {
+  std::string const *table = nullptr;
+
+  if (!decode([&] {
+        std::size_t id = 0;
+        d.varint(id);
+        d.bytes(key);
+        d.values(schema, id, values);
+        table = &schema.table(id);
+      }))
+    return MALFORMED;
+
+  uint64_t since = stamp();
+  int rc = db.Insert(ctx, *table, key, values);
+  executed(since);
+  return rc;
+}
+
+int Session::update(Deserializer &d) {
+  std::string const *table = nullptr;
+
+  if (!decode([&] {
+        std::size_t id = 0;
+        d.varint(id);
+        d.bytes(key);
+        d.values(schema, id, values);
+        table = &schema.table(id);
+      }))
+    return MALFORMED;
+
+  uint64_t since = stamp();
+  int rc = db.Update(ctx, *table, key, values);
+  executed(since);
+  return rc;
+}
+
+int Session::del(Deserializer &d) {
+  std::string const *table = nullptr;
+
+  if (!decode([&] {
+        std::size_t id = 0;
+        d.varint(id);
+        d.bytes(key);
+        table = &schema.table(id);
+      }))
+    return MALFORMED;
+
+  uint64_t since = stamp();
+  int rc = db.Delete(ctx, *table, key);
+  executed(since);
+  return rc;
+}
+
+void Session::record(Serializer &s, Result const &r) const {
+  s.record(schema, r.table, r.view, 0);
+}
+
+std::size_t Session::record_size(Result const &r) const {
+  return Serializer::record_size(schema, r.table, r.view, 0);
+}
+
+bool Session::chunk(Serializer &s, Result &r) const {
+  if (!r.streaming)
+    return false;
+
+  r.next_record = s.chunk(schema, r.table, r.view, r.next_record);
+  r.streaming = r.next_record < r.view.Records();
+  return true;
+}
+
+} // namespace dbhost
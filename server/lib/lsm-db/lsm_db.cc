@@ -0,0 +1,359 @@
+/******************************************************************************
+ *                                                                            *
+ * lsm_db.cc - A write-optimized database backend based on a log-structured   *
+ *             merge tree.                                                    *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "lsm_db.h"                 // Class definitions for lsm_db
+#include "lsm_memtable.h"
+#include "lsm_run.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using std::string;
+using std::vector;
+
+namespace ycsbc {
+
+using lsm::MemTable;
+using lsm::Run;
+
+/*
+ * Size ratio of the tiers: a compaction merges the newest runs as long as the
+ * next older run holds at most this many times the entries of the runs
+ * selected so far.
+ */
+static const std::size_t TIER_RATIO = 2;
+
+/*
+ * State of the tree at some point in time. Versions are immutable (apart from
+ * writes into the memtable), readers keep the memtables and runs of the
+ * version they use alive.
+ */
+struct LsmDB::Version {
+    std::shared_ptr<MemTable> mem;
+    // Full memtables not yet written as runs, newest first
+    vector<std::shared_ptr<MemTable>> imm;
+    // Newest first
+    vector<std::shared_ptr<Run>> runs;
+};
+
+/*
+ * Records are stored with all of their fields packed into a single value:
+ *
+ *      [name length][name][value length][value] ...
+ *
+ * with all lengths being 32 bit integers in host byte order.
+ */
+static void pack_record(const vector<DB::KVPair> &values, string &out) {
+    out.clear();
+    for (auto &kv : values) {
+        uint32_t len = kv.first.size();
+        out.append(reinterpret_cast<const char *>(&len), sizeof(len));
+        out.append(kv.first);
+        len = kv.second.size();
+        out.append(reinterpret_cast<const char *>(&len), sizeof(len));
+        out.append(kv.second);
+    }
+}
+
+static void unpack_record(const string &packed, vector<DB::KVPair> &out) {
+    const char *pos = packed.data();
+    const char *end = pos + packed.size();
+
+    out.clear();
+    while (pos < end) {
+        string *parts[2];
+        out.emplace_back();
+        parts[0] = &out.back().first;
+        parts[1] = &out.back().second;
+
+        for (string *part : parts) {
+            uint32_t len;
+            if (end - pos < static_cast<long>(sizeof(len)))
+                throw std::runtime_error("Corrupt LSM record");
+            memcpy(&len, pos, sizeof(len));
+            pos += sizeof(len);
+            if (static_cast<uint32_t>(end - pos) < len)
+                throw std::runtime_error("Corrupt LSM record");
+            part->assign(pos, len);
+            pos += len;
+        }
+    }
+}
+
+/* Keep only the requested fields of a record (all if fields is NULL). */
+static void project(vector<DB::KVPair> &record, const vector<string> *fields) {
+    if (!fields)
+        return;
+
+    vector<DB::KVPair> selected;
+    for (auto &field : *fields) {
+        for (auto &kv : record) {
+            if (kv.first == field) {
+                selected.push_back(std::move(kv));
+                break;
+            }
+        }
+    }
+    record.swap(selected);
+}
+
+/* Key of a record in the tree. */
+static string tree_key(const string &table, const string &key) {
+    string k;
+    k.reserve(table.size() + 1 + key.size());
+    k.append(table);
+    k.push_back('\0');
+    k.append(key);
+    return k;
+}
+
+LsmDB::LsmDB(const LsmOptions &options) : options(options) {
+    if (options.max_runs < 1 || options.max_immutable < 1)
+        throw std::invalid_argument("Invalid LSM options");
+
+    std::shared_ptr<Version> v{new Version};
+    v->mem = std::make_shared<MemTable>();
+    current = v;
+
+    compactor = std::thread(&LsmDB::Compact, this);
+}
+
+LsmDB::~LsmDB() {
+    {
+        std::lock_guard<std::mutex> lock(version_mutex);
+        stop = true;
+    }
+    cv.notify_all();
+    compactor.join();
+}
+
+std::shared_ptr<const LsmDB::Version> LsmDB::Current() const {
+    std::lock_guard<std::mutex> lock(version_mutex);
+    return current;
+}
+
+bool LsmDB::Get(const string &key, string &value) const {
+    auto v = Current();
+    bool tombstone = false;
+
+    // The newest entry of key wins.
+    bool found = v->mem->Get(key, value, tombstone);
+    for (std::size_t i = 0; !found && i < v->imm.size(); i++)
+        found = v->imm[i]->Get(key, value, tombstone);
+    for (std::size_t i = 0; !found && i < v->runs.size(); i++)
+        found = v->runs[i]->Get(key, value, tombstone);
+
+    return found && !tombstone;
+}
+
+void LsmDB::Write(const string &key, const string &value, bool tombstone) {
+    auto v = Current();
+
+    // Only writers replace the memtable, so it cannot change under our feet.
+    v->mem->Add(key, value, ++seq, tombstone);
+    if (v->mem->Size() < options.memtable_size)
+        return;
+
+    // Hand the memtable over to the background thread. Stall while it is
+    // behind, so that the immutable memtables do not pile up.
+    std::unique_lock<std::mutex> lock(version_mutex);
+    cv.wait(lock, [this] {
+        return current->imm.size() < options.max_immutable || stop;
+    });
+
+    std::shared_ptr<Version> next{new Version(*current)};
+    next->imm.insert(next->imm.begin(), next->mem);
+    next->mem = std::make_shared<MemTable>();
+    current = next;
+    cv.notify_all();
+}
+
+std::unique_ptr<lsm::BlockStore> LsmDB::NewStore() {
+    if (options.path.empty())
+        return std::unique_ptr<lsm::BlockStore>(new lsm::MemoryBlockStore);
+
+    string path = options.path + "-" + std::to_string(next_run++) + ".run";
+    return std::unique_ptr<lsm::BlockStore>(new lsm::FileBlockStore(path));
+}
+
+/*
+ * Number of the newest runs (newest first) to merge into one: the longest
+ * sequence of runs of similar size, at least two. Merging only those keeps
+ * the large, old runs untouched until enough newer data has accumulated, so
+ * that every entry is rewritten a logarithmic number of times.
+ */
+static std::size_t runs_to_merge(const vector<std::shared_ptr<Run>> &runs) {
+    std::size_t n = 1;
+    std::size_t entries = runs[0]->Entries();
+
+    while (n < runs.size() && runs[n]->Entries() <= entries * TIER_RATIO)
+        entries += runs[n++]->Entries();
+    return std::max<std::size_t>(n, 2);
+}
+
+/*
+ * Write the oldest immutable memtable as a new run. If there are too many
+ * runs afterwards, merge the newest runs of similar size (see
+ * runs_to_merge()). Only this thread changes the runs, so they can be read
+ * without holding version_mutex.
+ */
+void LsmDB::Compact() {
+    std::unique_lock<std::mutex> lock(version_mutex);
+
+    for (;;) {
+        cv.wait(lock, [this] { return stop || !current->imm.empty(); });
+        if (stop)
+            return;
+
+        std::shared_ptr<MemTable> imm = current->imm.back();
+        bool oldest = current->runs.empty();
+        lock.unlock();
+
+        // Without older runs, deleted keys can be forgotten right away.
+        auto it = imm->NewIterator();
+        auto run = Run::Build(*it, NewStore(), options.block_size,
+                              options.bloom_bits, oldest);
+
+        lock.lock();
+        std::shared_ptr<Version> next{new Version(*current)};
+        // Writers only add memtables at the front.
+        next->imm.pop_back();
+        next->runs.insert(next->runs.begin(), run);
+        current = next;
+        cv.notify_all();
+
+        if (next->runs.size() <= options.max_runs)
+            continue;
+
+        std::size_t n = runs_to_merge(next->runs);
+        vector<std::unique_ptr<lsm::Iterator>> children;
+        for (std::size_t i = 0; i < n; i++)
+            children.push_back(next->runs[i]->NewIterator());
+        // Deleted keys can only be forgotten if no older run is left.
+        bool all = n == next->runs.size();
+        lock.unlock();
+
+        lsm::MergingIterator merging(std::move(children));
+        auto merged = Run::Build(merging, NewStore(), options.block_size,
+                                 options.bloom_bits, all);
+
+        lock.lock();
+        next.reset(new Version(*current));
+        next->runs.erase(next->runs.begin(), next->runs.begin() + n);
+        next->runs.insert(next->runs.begin(), merged);
+        current = next;
+        // The old runs are freed with the last version referencing them.
+    }
+}
+
+int LsmDB::Read(void *ctx, const string &table, const string &key,
+                const vector<string> *fields, vector<KVPair> &result) {
+    (void)ctx;
+    string packed;
+
+    if (!Get(tree_key(table, key), packed)) {
+        result.clear();
+        return kErrorNoData;
+    }
+
+    unpack_record(packed, result);
+    project(result, fields);
+    return kOK;
+}
+
+int LsmDB::Scan(void *ctx, const string &table, const string &key, int len,
+                const vector<string> *fields,
+                vector<vector<KVPair>> &result) {
+    (void)ctx;
+    auto v = Current();
+
+    // The iterators reference the memtables and runs kept alive by v.
+    vector<std::unique_ptr<lsm::Iterator>> children;
+    children.push_back(v->mem->NewIterator());
+    for (auto &imm : v->imm)
+        children.push_back(imm->NewIterator());
+    for (auto &run : v->runs)
+        children.push_back(run->NewIterator());
+    lsm::MergingIterator it(std::move(children));
+
+    string prefix = tree_key(table, string());
+    std::size_t n = 0;
+    for (it.Seek(tree_key(table, key));
+         it.Valid() && n < static_cast<std::size_t>(len); it.Next()) {
+        if (it.Key().compare(0, prefix.size(), prefix) != 0)
+            break;
+        if (it.Tombstone())
+            continue;
+
+        if (n == result.size())
+            result.emplace_back();
+        unpack_record(it.Value(), result[n]);
+        project(result[n], fields);
+        n++;
+    }
+    result.resize(n);
+
+    return n == 0 ? kErrorNoData : kOK;
+}
+
+int LsmDB::Update(void *ctx, const string &table, const string &key,
+                  vector<KVPair> &values) {
+    (void)ctx;
+    string k = tree_key(table, key);
+    string packed;
+    vector<KVPair> record;
+
+    // Read-modify-write of the whole record, atomic with respect to other
+    // writers.
+    std::lock_guard<std::mutex> lock(write_mutex);
+    if (!Get(k, packed))
+        return kErrorNoData;
+
+    unpack_record(packed, record);
+    for (auto &value : values) {
+        bool found = false;
+        for (auto &kv : record) {
+            if (kv.first == value.first) {
+                kv.second = value.second;
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            record.push_back(value);
+    }
+    pack_record(record, packed);
+    Write(k, packed, false);
+
+    return kOK;
+}
+
+int LsmDB::Insert(void *ctx, const string &table, const string &key,
+                  vector<KVPair> &values) {
+    (void)ctx;
+    string k = tree_key(table, key);
+    string packed;
+
+    pack_record(values, packed);
+    std::lock_guard<std::mutex> lock(write_mutex);
+    Write(k, packed, false);
+
+    return kOK;
+}
+
+int LsmDB::Delete(void *ctx, const string &table, const string &key) {
+    (void)ctx;
+    string k = tree_key(table, key);
+
+    std::lock_guard<std::mutex> lock(write_mutex);
+    Write(k, string(), true);
+
+    return kOK;
+}
+
+} // ycsbc
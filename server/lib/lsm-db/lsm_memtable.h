@@ -0,0 +1,232 @@
+/******************************************************************************
+ *                                                                            *
+ * lsm_memtable.h - Iterators and the skiplist memtable of the LSM backend.   *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef YCSB_C_LSM_MEMTABLE_H
+#define YCSB_C_LSM_MEMTABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ycsbc {
+namespace lsm {
+
+/*
+ * Iterator over the entries of a memtable or run in ascending key order.
+ * Every key is visited once with its newest value. Deleted keys are visited
+ * as well, their entries are tombstones.
+ */
+class Iterator {
+    public:
+        virtual ~Iterator() {}
+
+        virtual bool Valid() const = 0;
+        // Position at the first entry with a key not less than key.
+        virtual void Seek(const std::string &key) = 0;
+        virtual void SeekToFirst() = 0;
+        virtual void Next() = 0;
+
+        virtual const std::string &Key() const = 0;
+        virtual const std::string &Value() const = 0;
+        virtual bool Tombstone() const = 0;
+};
+
+/*
+ * Skiplist holding the most recent writes in memory.
+ *
+ * Writes must be serialized by the caller, but reads and iterations may run
+ * concurrently with a write: nodes are never modified after they have been
+ * linked into the list. Overwriting a key inserts a new node with a higher
+ * sequence number in front of the older versions.
+ */
+class MemTable {
+    public:
+        MemTable() : head(new Node(std::string(), std::string(), 0, false,
+                                   MAX_HEIGHT)) {}
+
+        ~MemTable() {
+            Node *node = head;
+            while (node) {
+                Node *next = node->next[0].load(std::memory_order_relaxed);
+                delete node;
+                node = next;
+            }
+        }
+
+        MemTable(const MemTable &) = delete;
+        MemTable &operator=(const MemTable &) = delete;
+
+        void Add(const std::string &key, const std::string &value,
+                 uint64_t seq, bool tombstone) {
+            Node *prev[MAX_HEIGHT];
+            FindGreaterOrEqual(key, seq, prev);
+
+            int h = RandomHeight();
+            if (h > height.load(std::memory_order_relaxed)) {
+                for (int i = height.load(std::memory_order_relaxed); i < h;
+                     i++)
+                    prev[i] = head;
+                // Readers seeing the new height before the node find null
+                // pointers in head, which is fine.
+                height.store(h, std::memory_order_relaxed);
+            }
+
+            Node *node = new Node(key, value, seq, tombstone, h);
+            for (int i = 0; i < h; i++) {
+                node->next[i].store(
+                    prev[i]->next[i].load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+                // Publish the node with its contents.
+                prev[i]->next[i].store(node, std::memory_order_release);
+            }
+
+            size.fetch_add(key.size() + value.size() + sizeof(Node) +
+                               h * sizeof(std::atomic<Node *>),
+                           std::memory_order_relaxed);
+        }
+
+        /*
+         * Look up the newest version of key. Returns false if the memtable
+         * does not know the key at all.
+         */
+        bool Get(const std::string &key, std::string &value,
+                 bool &tombstone) const {
+            Node *node = FindGreaterOrEqual(key, UINT64_MAX, nullptr);
+            if (!node || node->key != key)
+                return false;
+
+            value = node->value;
+            tombstone = node->tombstone;
+            return true;
+        }
+
+        // Approximate memory usage in bytes.
+        std::size_t Size() const {
+            return size.load(std::memory_order_relaxed);
+        }
+
+        bool Empty() const {
+            return !head->next[0].load(std::memory_order_acquire);
+        }
+
+        // The memtable must outlive the iterator.
+        std::unique_ptr<Iterator> NewIterator() const {
+            return std::unique_ptr<Iterator>(new MemIterator(this));
+        }
+
+    private:
+        static const int MAX_HEIGHT = 12;
+
+        struct Node {
+            const std::string key;
+            const std::string value;
+            const uint64_t seq;
+            const bool tombstone;
+            std::unique_ptr<std::atomic<Node *>[]> next;
+
+            Node(const std::string &key, const std::string &value,
+                 uint64_t seq, bool tombstone, int height)
+                : key(key), value(value), seq(seq), tombstone(tombstone),
+                  next(new std::atomic<Node *>[height]) {
+                for (int i = 0; i < height; i++)
+                    next[i].store(nullptr, std::memory_order_relaxed);
+            }
+        };
+
+        class MemIterator : public Iterator {
+            public:
+                explicit MemIterator(const MemTable *table)
+                    : table(table) {}
+
+                bool Valid() const override { return node != nullptr; }
+
+                void Seek(const std::string &key) override {
+                    node = table->FindGreaterOrEqual(key, UINT64_MAX,
+                                                     nullptr);
+                }
+
+                void SeekToFirst() override {
+                    node = table->head->next[0].load(
+                        std::memory_order_acquire);
+                }
+
+                // Skip the older versions of the current key.
+                void Next() override {
+                    Node *next = node->next[0].load(std::memory_order_acquire);
+                    while (next && next->key == node->key)
+                        next = next->next[0].load(std::memory_order_acquire);
+                    node = next;
+                }
+
+                const std::string &Key() const override { return node->key; }
+                const std::string &Value() const override {
+                    return node->value;
+                }
+                bool Tombstone() const override { return node->tombstone; }
+
+            private:
+                const MemTable *table;
+                Node *node = nullptr;
+        };
+
+        // Ordered by key, newer versions (higher seq) of a key first.
+        static bool Before(const Node *node, const std::string &key,
+                           uint64_t seq) {
+            int c = node->key.compare(key);
+            return c < 0 || (c == 0 && node->seq > seq);
+        }
+
+        /*
+         * Return the first node not before (key, seq). If prev is given, it
+         * receives the last node before (key, seq) on every level.
+         */
+        Node *FindGreaterOrEqual(const std::string &key, uint64_t seq,
+                                 Node **prev) const {
+            Node *node = head;
+            int level = height.load(std::memory_order_relaxed) - 1;
+
+            for (;;) {
+                Node *next = node->next[level].load(std::memory_order_acquire);
+                if (next && Before(next, key, seq)) {
+                    node = next;
+                } else {
+                    if (prev)
+                        prev[level] = node;
+                    if (level == 0)
+                        return next;
+                    level--;
+                }
+            }
+        }
+
+        // Height of a new node, each level with probability 1/4.
+        int RandomHeight() {
+            int h = 1;
+            while (h < MAX_HEIGHT && (NextRandom() & 3) == 0)
+                h++;
+            return h;
+        }
+
+        // xorshift64, only used by the (single) writer.
+        uint64_t NextRandom() {
+            rnd ^= rnd << 13;
+            rnd ^= rnd >> 7;
+            rnd ^= rnd << 17;
+            return rnd;
+        }
+
+        Node *const head;
+        std::atomic<int> height{1};
+        std::atomic<std::size_t> size{0};
+        uint64_t rnd = 0x9E3779B97F4A7C15;
+};
+
+} // lsm
+} // ycsbc
+
+#endif /* YCSB_C_LSM_MEMTABLE_H */
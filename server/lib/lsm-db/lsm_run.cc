@@ -0,0 +1,384 @@
+/******************************************************************************
+ *                                                                            *
+ * lsm_run.cc - Immutable sorted runs of the LSM backend.                     *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "lsm_run.h"
+#include "sharding.h"               // For fnv_hash
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+
+namespace ycsbc {
+namespace lsm {
+
+/*
+ * Blocks consist of entries of the following format, with all lengths being
+ * 32 bit integers in host byte order:
+ *
+ *      [key length][key][tombstone (1 byte)][value length][value]
+ *
+ * followed by a trailer with the offsets of all entries, which allows a binary
+ * search for a key in the block:
+ *
+ *      [offset of entry 0] ... [offset of entry n - 1][n]
+ */
+
+static void put_u32(string &out, uint32_t v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+static uint32_t get_u32(const char *&pos, const char *end) {
+    uint32_t v;
+    if (end - pos < static_cast<long>(sizeof(v)))
+        throw std::runtime_error("Corrupt LSM block");
+    memcpy(&v, pos, sizeof(v));
+    pos += sizeof(v);
+    return v;
+}
+
+static void get_bytes(const char *&pos, const char *end, uint32_t len,
+                      string &out) {
+    if (static_cast<uint32_t>(end - pos) < len)
+        throw std::runtime_error("Corrupt LSM block");
+    out.assign(pos, len);
+    pos += len;
+}
+
+/* Append the trailer with the given entry offsets to a block. */
+static void finish_block(string &block, vector<uint32_t> &offsets) {
+    for (uint32_t offset : offsets)
+        put_u32(block, offset);
+    put_u32(block, offsets.size());
+    offsets.clear();
+}
+
+/*
+ * Locate the trailer of a block. Returns the start of the offsets, which is
+ * also the end of the entries, and sets count to the number of entries.
+ */
+static const char *block_offsets(const string &block, uint32_t &count) {
+    const char *end = block.data() + block.size();
+    const char *pos = end - std::min(block.size(), sizeof(count));
+    count = get_u32(pos, end);
+    if ((block.size() - sizeof(count)) / sizeof(count) < count)
+        throw std::runtime_error("Corrupt LSM block");
+    return end - sizeof(count) * (count + 1);
+}
+
+/* Start of entry i of a block with the given trailer. */
+static const char *block_entry(const string &block, const char *offsets,
+                               uint32_t i) {
+    const char *pos = offsets + i * sizeof(uint32_t);
+    uint32_t offset = get_u32(pos, pos + sizeof(uint32_t));
+    if (offset >= static_cast<std::size_t>(offsets - block.data()))
+        throw std::runtime_error("Corrupt LSM block");
+    return block.data() + offset;
+}
+
+/*
+ * Compare the key of the entry at pos with key like std::string::compare, and
+ * advance pos past the key.
+ */
+static int compare_key(const char *&pos, const char *end, const string &key) {
+    uint32_t len = get_u32(pos, end);
+    if (static_cast<uint32_t>(end - pos) < len)
+        throw std::runtime_error("Corrupt LSM block");
+    int c = memcmp(pos, key.data(), std::min<std::size_t>(len, key.size()));
+    pos += len;
+    if (c != 0)
+        return c;
+    return len < key.size() ? -1 : len > key.size();
+}
+
+/* MemoryBlockStore */
+
+BlockHandle MemoryBlockStore::Write(const string &block) {
+    blocks.push_back(block);
+    return BlockHandle{blocks.size() - 1, block.size()};
+}
+
+void MemoryBlockStore::Read(const BlockHandle &handle, string &block) const {
+    block = blocks.at(handle.offset);
+}
+
+/* FileBlockStore */
+
+FileBlockStore::FileBlockStore(const string &path) : path(path) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Failed to create LSM run file " + path);
+}
+
+FileBlockStore::~FileBlockStore() {
+    close(fd);
+    unlink(path.c_str());
+}
+
+BlockHandle FileBlockStore::Write(const string &block) {
+    BlockHandle handle{end, block.size()};
+    std::size_t done = 0;
+
+    while (done < block.size()) {
+        ssize_t n = pwrite(fd, block.data() + done, block.size() - done,
+                           end + done);
+        if (n <= 0)
+            throw std::runtime_error("Failed to write LSM run file " + path);
+        done += n;
+    }
+    end += block.size();
+    return handle;
+}
+
+void FileBlockStore::Read(const BlockHandle &handle, string &block) const {
+    std::size_t done = 0;
+
+    block.resize(handle.size);
+    while (done < handle.size) {
+        ssize_t n = pread(fd, &block[done], handle.size - done,
+                          handle.offset + done);
+        if (n <= 0)
+            throw std::runtime_error("Failed to read LSM run file " + path);
+        done += n;
+    }
+}
+
+/* BloomFilter */
+
+BloomFilter::BloomFilter(const vector<uint64_t> &hashes,
+                         std::size_t bits_per_key) {
+    // ln(2) * bits per key probes minimize the false positive rate.
+    nprobes = std::max<std::size_t>(1, bits_per_key * 69 / 100);
+    nprobes = std::min(nprobes, 30u);
+    nbits = std::max<std::size_t>(64, hashes.size() * bits_per_key);
+    bits.assign((nbits + 63) / 64, 0);
+
+    for (uint64_t hash : hashes) {
+        uint64_t h = hash;
+        uint64_t delta = (hash >> 33) | (hash << 31);
+        for (unsigned i = 0; i < nprobes; i++) {
+            std::size_t bit = h % nbits;
+            bits[bit / 64] |= uint64_t{1} << (bit % 64);
+            h += delta;
+        }
+    }
+}
+
+bool BloomFilter::MayContain(uint64_t hash) const {
+    uint64_t h = hash;
+    uint64_t delta = (hash >> 33) | (hash << 31);
+
+    for (unsigned i = 0; i < nprobes; i++) {
+        std::size_t bit = h % nbits;
+        if (!(bits[bit / 64] & (uint64_t{1} << (bit % 64))))
+            return false;
+        h += delta;
+    }
+    return true;
+}
+
+/* 64 bit FNV-1a hash over the bytes of a key. */
+uint64_t BloomFilter::Hash(const string &key) {
+    return fnv_hash(key);
+}
+
+/* Run */
+
+std::shared_ptr<Run> Run::Build(Iterator &it, std::unique_ptr<BlockStore> store,
+                                std::size_t block_size,
+                                std::size_t bits_per_key,
+                                bool drop_tombstones) {
+    vector<uint64_t> hashes;
+    vector<string> first_keys;
+    vector<BlockHandle> handles;
+    string block;
+    string first_key;
+    vector<uint32_t> offsets;
+
+    for (it.SeekToFirst(); it.Valid(); it.Next()) {
+        if (drop_tombstones && it.Tombstone())
+            continue;
+
+        if (block.empty())
+            first_key = it.Key();
+        offsets.push_back(block.size());
+        put_u32(block, it.Key().size());
+        block.append(it.Key());
+        block.push_back(it.Tombstone() ? 1 : 0);
+        put_u32(block, it.Value().size());
+        block.append(it.Value());
+        hashes.push_back(BloomFilter::Hash(it.Key()));
+
+        if (block.size() >= block_size) {
+            finish_block(block, offsets);
+            handles.push_back(store->Write(block));
+            first_keys.push_back(first_key);
+            block.clear();
+        }
+    }
+    if (!block.empty()) {
+        finish_block(block, offsets);
+        handles.push_back(store->Write(block));
+        first_keys.push_back(first_key);
+    }
+
+    std::shared_ptr<Run> run{new Run(std::move(store),
+                                     BloomFilter(hashes, bits_per_key))};
+    run->first_keys.swap(first_keys);
+    run->handles.swap(handles);
+    run->entries = hashes.size();
+    return run;
+}
+
+long Run::FindBlock(const string &key) const {
+    // Last block whose first key is not greater than key
+    auto it = std::upper_bound(first_keys.begin(), first_keys.end(), key);
+    return static_cast<long>(it - first_keys.begin()) - 1;
+}
+
+void Run::ReadBlock(std::size_t index, vector<Entry> &out) const {
+    string block;
+    store->Read(handles[index], block);
+
+    uint32_t count;
+    const char *pos = block.data();
+    const char *end = block_offsets(block, count);
+    out.clear();
+    while (pos < end) {
+        out.emplace_back();
+        Entry &e = out.back();
+        get_bytes(pos, end, get_u32(pos, end), e.key);
+        if (pos == end)
+            throw std::runtime_error("Corrupt LSM block");
+        e.tombstone = *pos++ != 0;
+        get_bytes(pos, end, get_u32(pos, end), e.value);
+    }
+}
+
+bool Run::Get(const string &key, string &value, bool &tombstone) const {
+    if (!bloom.MayContain(BloomFilter::Hash(key)))
+        return false;
+
+    long index = FindBlock(key);
+    if (index < 0)
+        return false;
+
+    string block;
+    store->Read(handles[index], block);
+    uint32_t count;
+    const char *offsets = block_offsets(block, count);
+
+    // Binary search for the first entry whose key is not less than key,
+    // comparing the keys in place.
+    uint32_t lo = 0;
+    uint32_t hi = count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const char *pos = block_entry(block, offsets, mid);
+        if (compare_key(pos, offsets, key) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == count)
+        return false;
+
+    const char *pos = block_entry(block, offsets, lo);
+    if (compare_key(pos, offsets, key) != 0)
+        return false;
+    if (pos == offsets)
+        throw std::runtime_error("Corrupt LSM block");
+    tombstone = *pos++ != 0;
+    get_bytes(pos, offsets, get_u32(pos, offsets), value);
+    return true;
+}
+
+class Run::RunIterator : public Iterator {
+    public:
+        explicit RunIterator(const Run *run) : run(run) {}
+
+        bool Valid() const override { return pos < block.size(); }
+
+        void Seek(const string &key) override {
+            long index = run->FindBlock(key);
+            Load(index < 0 ? 0 : index);
+            while (Valid() && block[pos].key < key)
+                Next();
+        }
+
+        void SeekToFirst() override { Load(0); }
+
+        void Next() override {
+            if (++pos == block.size())
+                Load(index + 1);
+        }
+
+        const string &Key() const override { return block[pos].key; }
+        const string &Value() const override { return block[pos].value; }
+        bool Tombstone() const override { return block[pos].tombstone; }
+
+    private:
+        // Load the block with the given index (an empty one past the end).
+        void Load(std::size_t i) {
+            index = i;
+            pos = 0;
+            if (i < run->handles.size())
+                run->ReadBlock(i, block);
+            else
+                block.clear();
+        }
+
+        const Run *run;
+        vector<Entry> block;
+        std::size_t index = 0;
+        std::size_t pos = 0;
+};
+
+std::unique_ptr<Iterator> Run::NewIterator() const {
+    return std::unique_ptr<Iterator>(new RunIterator(this));
+}
+
+/* MergingIterator */
+
+void MergingIterator::Seek(const string &key) {
+    for (auto &child : children)
+        child->Seek(key);
+    FindSmallest();
+}
+
+void MergingIterator::SeekToFirst() {
+    for (auto &child : children)
+        child->SeekToFirst();
+    FindSmallest();
+}
+
+void MergingIterator::Next() {
+    // Skip the older entries of the current key in all other children.
+    string key = current->Key();
+    for (auto &child : children) {
+        if (child->Valid() && child->Key() == key)
+            child->Next();
+    }
+    FindSmallest();
+}
+
+void MergingIterator::FindSmallest() {
+    current = nullptr;
+    for (auto &child : children) {
+        if (!child->Valid())
+            continue;
+        // Strictly smaller only, so that the newest child wins ties.
+        if (!current || child->Key() < current->Key())
+            current = child.get();
+    }
+}
+
+} // lsm
+} // ycsbc
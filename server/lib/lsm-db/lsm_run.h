@@ -0,0 +1,173 @@
+/******************************************************************************
+ *                                                                            *
+ * lsm_run.h - Immutable sorted runs of the LSM backend.                      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef YCSB_C_LSM_RUN_H
+#define YCSB_C_LSM_RUN_H
+
+#include "lsm_memtable.h"           // Iterator interface
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ycsbc {
+namespace lsm {
+
+// Location of a block inside a block store
+struct BlockHandle {
+    uint64_t offset;
+    uint64_t size;
+};
+
+/*
+ * Storage for the blocks of a single run. Blocks are written once while the
+ * run is built and may be read concurrently afterwards.
+ */
+class BlockStore {
+    public:
+        virtual ~BlockStore() {}
+
+        virtual BlockHandle Write(const std::string &block) = 0;
+        virtual void Read(const BlockHandle &handle,
+                          std::string &block) const = 0;
+};
+
+// Keeps the blocks in memory.
+class MemoryBlockStore : public BlockStore {
+    public:
+        BlockHandle Write(const std::string &block) override;
+        void Read(const BlockHandle &handle,
+                  std::string &block) const override;
+
+    private:
+        std::vector<std::string> blocks;
+};
+
+// Keeps the blocks in a file, which is removed together with the store.
+class FileBlockStore : public BlockStore {
+    public:
+        explicit FileBlockStore(const std::string &path);
+        ~FileBlockStore() override;
+
+        BlockHandle Write(const std::string &block) override;
+        void Read(const BlockHandle &handle,
+                  std::string &block) const override;
+
+    private:
+        const std::string path;
+        int fd;
+        uint64_t end = 0;
+};
+
+/*
+ * Bloom filter over the keys of a run, using double hashing to derive the
+ * probes from a single 64 bit hash.
+ */
+class BloomFilter {
+    public:
+        BloomFilter(const std::vector<uint64_t> &hashes,
+                    std::size_t bits_per_key);
+
+        bool MayContain(uint64_t hash) const;
+
+        static uint64_t Hash(const std::string &key);
+
+    private:
+        std::vector<uint64_t> bits;
+        std::size_t nbits;
+        unsigned nprobes;
+};
+
+/*
+ * Sorted, immutable run of entries, divided into blocks. The first key of
+ * every block is kept in memory for locating the block of a key.
+ */
+class Run {
+    public:
+        /*
+         * Write the entries visited by it into a new run on store. With
+         * drop_tombstones, deleted keys are left out, which is only correct
+         * if there are no older runs.
+         */
+        static std::shared_ptr<Run> Build(Iterator &it,
+                                          std::unique_ptr<BlockStore> store,
+                                          std::size_t block_size,
+                                          std::size_t bits_per_key,
+                                          bool drop_tombstones);
+
+        /*
+         * Look up key. Returns false if the run does not contain the key,
+         * usually without reading any block. Otherwise, the key is searched
+         * for in place in the one block that may contain it.
+         */
+        bool Get(const std::string &key, std::string &value,
+                 bool &tombstone) const;
+
+        // The run must outlive the iterator.
+        std::unique_ptr<Iterator> NewIterator() const;
+
+        std::size_t Entries() const { return entries; }
+
+    private:
+        class RunIterator;
+
+        // Decoded entry of a block
+        struct Entry {
+            std::string key;
+            std::string value;
+            bool tombstone;
+        };
+
+        Run(std::unique_ptr<BlockStore> store, BloomFilter bloom)
+            : store(std::move(store)), bloom(std::move(bloom)) {}
+
+        // Index of the block that may contain key, or -1.
+        long FindBlock(const std::string &key) const;
+        void ReadBlock(std::size_t index, std::vector<Entry> &out) const;
+
+        std::unique_ptr<BlockStore> store;
+        BloomFilter bloom;
+
+        std::vector<std::string> first_keys;
+        std::vector<BlockHandle> handles;
+        std::size_t entries = 0;
+};
+
+/*
+ * Merges several iterators, which are ordered from the newest to the oldest.
+ * For keys present in several of them, the newest entry wins.
+ */
+class MergingIterator : public Iterator {
+    public:
+        explicit MergingIterator(
+            std::vector<std::unique_ptr<Iterator>> children)
+            : children(std::move(children)) {}
+
+        bool Valid() const override { return current != nullptr; }
+        void Seek(const std::string &key) override;
+        void SeekToFirst() override;
+        void Next() override;
+
+        const std::string &Key() const override { return current->Key(); }
+        const std::string &Value() const override {
+            return current->Value();
+        }
+        bool Tombstone() const override { return current->Tombstone(); }
+
+    private:
+        // Select the newest child with the smallest key.
+        void FindSmallest();
+
+        std::vector<std::unique_ptr<Iterator>> children;
+        Iterator *current = nullptr;
+};
+
+} // lsm
+} // ycsbc
+
+#endif /* YCSB_C_LSM_RUN_H */
@@ -7,11 +7,15 @@
 //  Copyright (c) 2022 Viktor Reusch.
 //
 
-#include "db/hashtable_db.h"
+#include "hashtable_db.h"
 
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
-#include "lib/string_hashtable.h"
+#include "vmp/string_hashtable.h"
 
 using std::string;
 using std::vector;
@@ -23,9 +27,9 @@ int HashtableDB::Read(void *, const string &table, const string &key,
     const vector<string> *fields, vector<KVPair> &result) {
   string key_index(table + key);
   FieldHashtable *field_table = key_table_->Get(key_index.c_str());
+  result.clear();
   if (!field_table) return DB::kErrorNoData;
 
-  result.clear();
   if (!fields) {
     vector<FieldHashtable::KVPair> field_pairs = field_table->Entries();
     for (auto &field_pair : field_pairs) {
@@ -116,6 +120,98 @@ int HashtableDB::Insert(void *, const string &table, const string &key,
   return DB::kOK;
 }
 
+namespace {
+
+const char kSnapshotMagic[8] = {'Y', 'C', 'S', 'B', 'H', 'T', '\0', '\2'};
+
+void WriteString(std::ostream &out, const char *str) {
+  uint32_t len = strlen(str);
+  out.write(reinterpret_cast<const char *>(&len), sizeof(len));
+  out.write(str, len);
+}
+
+uint32_t ReadLength(std::istream &in) {
+  uint32_t len;
+  if (!in.read(reinterpret_cast<char *>(&len), sizeof(len))) {
+    throw std::runtime_error("Truncated snapshot");
+  }
+  return len;
+}
+
+void ReadString(std::istream &in, string &str) {
+  str.resize(ReadLength(in));
+  if (!in.read(&str[0], str.size())) {
+    throw std::runtime_error("Truncated snapshot");
+  }
+}
+
+} // namespace
+
+bool HashtableDB::Snapshot(const string &path, const string &records) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw std::runtime_error("Cannot create snapshot " + path);
+
+  vector<KeyHashtable::KVPair> key_pairs = key_table_->Entries();
+  uint64_t count = key_pairs.size();
+  out.write(kSnapshotMagic, sizeof(kSnapshotMagic));
+  WriteString(out, records.c_str());
+  out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+
+  for (auto &key_pair : key_pairs) {
+    vector<FieldHashtable::KVPair> field_pairs = key_pair.second->Entries();
+    uint32_t num_fields = field_pairs.size();
+    WriteString(out, key_pair.first);
+    out.write(reinterpret_cast<const char *>(&num_fields), sizeof(num_fields));
+    for (auto &field_pair : field_pairs) {
+      WriteString(out, field_pair.first);
+      WriteString(out, field_pair.second);
+    }
+  }
+
+  if (!out.flush()) throw std::runtime_error("Cannot write snapshot " + path);
+  return true;
+}
+
+bool HashtableDB::Restore(const string &path, const string &records) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw std::runtime_error("Cannot open snapshot " + path);
+
+  char magic[sizeof(kSnapshotMagic)];
+  if (!in.read(magic, sizeof(magic)) ||
+      memcmp(magic, kSnapshotMagic, sizeof(magic)) != 0) {
+    throw std::runtime_error("Not a hashtable snapshot: " + path);
+  }
+
+  // The records go straight into the hashtables, reusing the buffers for
+  // the strings read.
+  string key, field, value;
+  ReadString(in, value);
+  if (value != records) {
+    throw std::runtime_error("Snapshot " + path + " holds other records: " +
+                             value);
+  }
+  uint64_t count;
+  if (!in.read(reinterpret_cast<char *>(&count), sizeof(count))) {
+    throw std::runtime_error("Truncated snapshot");
+  }
+
+  for (uint64_t i = 0; i < count; ++i) {
+    ReadString(in, key);
+    FieldHashtable *field_table = NewFieldHashtable();
+    if (!key_table_->Insert(key.c_str(), field_table)) {
+      DeleteFieldHashtable(field_table);
+      throw std::runtime_error("Duplicate key in snapshot: " + key);
+    }
+    uint32_t num_fields = ReadLength(in);
+    for (uint32_t f = 0; f < num_fields; ++f) {
+      ReadString(in, field);
+      ReadString(in, value);
+      field_table->Insert(field.c_str(), CopyString(value));
+    }
+  }
+  return true;
+}
+
 int HashtableDB::Delete(void *, const string &table, const string &key) {
   string key_index(table + key);
   FieldHashtable *field_table = key_table_->Remove(key_index.c_str());
@@ -0,0 +1,101 @@
+//
+//  null_db.cc
+//  YCSB-C
+//
+//  Database that stores nothing and answers with synthetic records.
+//
+
+#include "null_db.h"
+
+using std::string;
+using std::vector;
+
+namespace ycsbc {
+
+NullDB::NullDB(std::size_t field_count, std::size_t field_length)
+    : value_(field_length, 'x') {
+  for (std::size_t i = 0; i < field_count; i++) {
+    field_names_.push_back("field" + std::to_string(i));
+  }
+}
+
+void NullDB::FillRecord(const vector<string> *fields,
+                        vector<KVPair> &record) const {
+  const vector<string> &names = fields ? *fields : field_names_;
+  record.resize(names.size());
+  for (std::size_t i = 0; i < names.size(); i++) {
+    record[i].first = names[i];
+    record[i].second = value_;
+  }
+}
+
+void NullDB::AddRecord(const vector<string> *fields,
+                       ResultView &result) const {
+  result.AddRecord();
+  if (!fields) {
+    for (auto &name : field_names_) {
+      result.Add(Slice(name), Slice(value_));
+    }
+    return;
+  }
+  // The names of selected fields must not reference the caller's strings.
+  for (auto &name : *fields) {
+    result.Add(result.Copy(name.data(), name.size()), Slice(value_));
+  }
+}
+
+int NullDB::Read(void *ctx, const string &table, const string &key,
+                 const vector<string> *fields, vector<KVPair> &result) {
+  (void)ctx, (void)table, (void)key;
+  FillRecord(fields, result);
+  return kOK;
+}
+
+int NullDB::Scan(void *ctx, const string &table, const string &key, int len,
+                 const vector<string> *fields,
+                 vector<vector<KVPair>> &result) {
+  (void)ctx, (void)table, (void)key;
+  result.resize(len > 0 ? len : 0);
+  for (auto &record : result) {
+    FillRecord(fields, record);
+  }
+  return kOK;
+}
+
+int NullDB::ReadView(void *ctx, const string &table, const string &key,
+                     const vector<string> *fields, ResultView &result) {
+  (void)ctx, (void)table, (void)key;
+  result.Clear();
+  AddRecord(fields, result);
+  return kOK;
+}
+
+int NullDB::ScanView(void *ctx, const string &table, const string &key,
+                     int len, const vector<string> *fields,
+                     ResultView &result) {
+  (void)ctx, (void)table, (void)key;
+  result.Clear();
+  for (int i = 0; i < len; i++) {
+    AddRecord(fields, result);
+  }
+  return kOK;
+}
+
+int NullDB::Update(void *ctx, const string &table, const string &key,
+                   vector<KVPair> &values) {
+  (void)ctx, (void)table, (void)key, (void)values;
+  return kOK;
+}
+
+int NullDB::Insert(void *ctx, const string &table, const string &key,
+                   vector<KVPair> &values) {
+  (void)ctx, (void)table, (void)key, (void)values;
+  return kOK;
+}
+
+int NullDB::Delete(void *ctx, const string &table, const string &key) {
+  (void)ctx, (void)table, (void)key;
+  return kOK;
+}
+
+} // ycsbc
@@ -0,0 +1,435 @@
+//
+//  partitioned_db.cc
+//  YCSB-C
+//
+//  In-memory database that hash-partitions the keys over per-core shards.
+//
+
+#include "partitioned_db.h"
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include "vmp/spsc_queue.h"
+#include "sharding.h"
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+namespace ycsbc {
+
+namespace {
+
+typedef vector<DB::KVPair> Record;
+// Records of a table, ordered by key for scans
+typedef std::map<string, Record> RecordMap;
+
+// Number of connection slots a shard allocates at once. A shard grows its
+// slots by another block when more benchmark threads connect.
+const std::size_t SLOTS_PER_BLOCK = 64;
+
+// Queue capacity per benchmark thread and shard. A benchmark thread has at
+// most one request in flight on a shard.
+const std::size_t QUEUE_SIZE = 4;
+
+// Copy the fields of rec selected by fields (all if NULL) into out.
+void Project(const Record &rec, const vector<string> *fields, Record &out) {
+  out.clear();
+  if (!fields) {
+    out = rec;
+    return;
+  }
+  for (auto &field : *fields) {
+    for (auto &kv : rec) {
+      if (kv.first == field) {
+        out.push_back(kv);
+        break;
+      }
+    }
+  }
+}
+
+} // namespace
+
+struct PartitionedDB::Request {
+  enum Type { READ, SCAN, UPDATE, INSERT, DELETE, CLOSE };
+
+  Type type = READ;
+  const string *table = nullptr;
+  const string *key = nullptr;
+  int len = 0;
+  const vector<string> *fields = nullptr;
+  // Values to write or the result of a read
+  Record *values = nullptr;
+  // Result of a scan
+  vector<Record> *rows = nullptr;
+  vector<string> *keys = nullptr;
+
+  int status = kOK;
+};
+
+namespace {
+
+// Connection of a benchmark thread to a shard
+struct Channel {
+  vmp::SpscQueue<PartitionedDB::Request *, QUEUE_SIZE> requests;
+  vmp::SpscQueue<PartitionedDB::Request *, QUEUE_SIZE> completions;
+};
+
+// Connection slots of a shard. Blocks are appended when all slots are taken,
+// but only freed with the shard, so that the owner can walk them without locks.
+struct SlotBlock {
+  std::array<std::atomic<Channel *>, SLOTS_PER_BLOCK> channels;
+  std::atomic<SlotBlock *> next{nullptr};
+
+  SlotBlock() {
+    for (auto &c : channels)
+      c.store(nullptr, std::memory_order_relaxed);
+  }
+};
+
+// Per-thread context
+struct PartitionedCtx {
+  vector<std::unique_ptr<Channel>> channels{};
+  // One request and scan result per shard, reused across operations.
+  vector<PartitionedDB::Request> requests{};
+  vector<vector<Record>> rows{};
+  vector<vector<string>> keys{};
+
+  static PartitionedCtx &cast(void *ctx) {
+    return *reinterpret_cast<PartitionedCtx *>(ctx);
+  }
+};
+
+} // namespace
+
+struct PartitionedDB::Shard {
+  std::unordered_map<string, RecordMap> tables;
+
+  // Protects tables if the shard is accessed without delegation
+  std::mutex lock;
+
+  // Connections of the benchmark threads, numbered across the blocks. Slots
+  // below num_channels may be NULL if the thread has disconnected.
+  SlotBlock slots;
+  std::atomic<std::size_t> num_channels{0};
+
+  std::atomic<bool> stop{false};
+  std::thread owner;
+
+  ~Shard() {
+    SlotBlock *block = slots.next.load(std::memory_order_relaxed);
+    while (block) {
+      SlotBlock *next = block->next.load(std::memory_order_relaxed);
+      delete block;
+      block = next;
+    }
+  }
+
+  void Connect(Channel *channel);
+  void Serve(l4_umword_t cpu);
+  void Perform(Request &req);
+};
+
+void PartitionedDB::Shard::Connect(Channel *channel) {
+  SlotBlock *block = &slots;
+  for (std::size_t base = 0;; base += SLOTS_PER_BLOCK) {
+    for (std::size_t j = 0; j < SLOTS_PER_BLOCK; j++) {
+      Channel *expected = nullptr;
+      if (!block->channels[j].compare_exchange_strong(
+              expected, channel, std::memory_order_acq_rel))
+        continue;
+
+      // Make the slot visible to the owner.
+      std::size_t i = base + j;
+      std::size_t n = num_channels.load(std::memory_order_relaxed);
+      while (n < i + 1 &&
+             !num_channels.compare_exchange_weak(n, i + 1,
+                                                 std::memory_order_release)) {
+      }
+      return;
+    }
+
+    // All slots of the block are taken, continue with the next one, which
+    // this or another thread appends.
+    SlotBlock *next = block->next.load(std::memory_order_acquire);
+    if (!next) {
+      std::unique_ptr<SlotBlock> fresh{new SlotBlock};
+      if (block->next.compare_exchange_strong(next, fresh.get(),
+                                              std::memory_order_acq_rel))
+        next = fresh.release();
+    }
+    block = next;
+  }
+}
+
+// Main loop of the owner thread: poll the request queues of all connected
+// benchmark threads.
+void PartitionedDB::Shard::Serve(l4_umword_t cpu) {
+  ycsbc::migrate(cpu);
+
+  while (!stop.load(std::memory_order_relaxed)) {
+    bool idle = true;
+    std::size_t n = num_channels.load(std::memory_order_acquire);
+    SlotBlock *block = &slots;
+
+    for (std::size_t i = 0; i < n; i++) {
+      // The block of a slot below num_channels has been appended before.
+      if (i > 0 && i % SLOTS_PER_BLOCK == 0)
+        block = block->next.load(std::memory_order_acquire);
+      std::atomic<Channel *> &slot = block->channels[i % SLOTS_PER_BLOCK];
+      Channel *channel = slot.load(std::memory_order_acquire);
+      Request *req;
+      if (!channel || !channel->requests.Pop(req))
+        continue;
+      idle = false;
+
+      if (req->type == Request::CLOSE)
+        // The benchmark thread frees the channel after the completion.
+        slot.store(nullptr, std::memory_order_release);
+      else
+        Perform(*req);
+
+      while (!channel->completions.Push(req))
+        __builtin_ia32_pause();
+    }
+
+    if (idle) {
+      // Use PAUSE to hint a spin-wait loop. This should use YIELD on ARM.
+      __builtin_ia32_pause();
+    }
+  }
+}
+
+void PartitionedDB::Shard::Perform(Request &req) {
+  RecordMap &table = tables[*req.table];
+  req.status = kOK;
+
+  switch (req.type) {
+  case Request::READ: {
+    auto it = table.find(*req.key);
+    if (it == table.end()) {
+      req.values->clear();
+      req.status = kErrorNoData;
+      break;
+    }
+    Project(it->second, req.fields, *req.values);
+    break;
+  }
+  case Request::SCAN: {
+    std::size_t n = 0;
+    req.keys->clear();
+    for (auto it = table.lower_bound(*req.key);
+         it != table.end() && n < static_cast<std::size_t>(req.len); ++it) {
+      if (n == req.rows->size())
+        req.rows->emplace_back();
+      Project(it->second, req.fields, (*req.rows)[n++]);
+      req.keys->push_back(it->first);
+    }
+    req.rows->resize(n);
+    if (n == 0)
+      req.status = kErrorNoData;
+    break;
+  }
+  case Request::UPDATE: {
+    auto it = table.find(*req.key);
+    if (it == table.end()) {
+      req.status = kErrorNoData;
+      break;
+    }
+    for (auto &value : *req.values) {
+      bool found = false;
+      for (auto &kv : it->second) {
+        if (kv.first == value.first) {
+          kv.second = value.second;
+          found = true;
+          break;
+        }
+      }
+      if (!found)
+        it->second.push_back(value);
+    }
+    break;
+  }
+  case Request::INSERT:
+    table[*req.key] = *req.values;
+    break;
+  case Request::DELETE:
+    if (table.erase(*req.key) == 0)
+      req.status = kErrorNoData;
+    break;
+  case Request::CLOSE:
+    break;
+  }
+}
+
+PartitionedDB::PartitionedDB(std::size_t num_shards, bool delegate)
+    : delegate_(delegate) {
+  if (num_shards == 0)
+    throw std::invalid_argument("Need at least one shard");
+
+  std::vector<l4_umword_t> cpus;
+  if (delegate_) {
+    cpus = ycsbc::online_cpus();
+    if (cpus.empty())
+      throw std::runtime_error{"cpu list empty"};
+  }
+
+  for (std::size_t i = 0; i < num_shards; i++) {
+    shards_.emplace_back(new Shard);
+    if (delegate_) {
+      // Benchmark threads are placed on the first CPUs, keep the owners
+      // away from them as far as possible.
+      l4_umword_t cpu = cpus[cpus.size() - 1 - i % cpus.size()];
+      shards_.back()->owner = std::thread(&Shard::Serve, shards_.back().get(),
+                                          cpu);
+    }
+  }
+}
+
+PartitionedDB::~PartitionedDB() {
+  for (auto &shard : shards_) {
+    shard->stop.store(true, std::memory_order_relaxed);
+    if (shard->owner.joinable())
+      shard->owner.join();
+  }
+}
+
+std::size_t PartitionedDB::ShardOf(const string &key) const {
+  return fnv_hash(key) % shards_.size();
+}
+
+void *PartitionedDB::Init() {
+  std::unique_ptr<PartitionedCtx> ctx{new PartitionedCtx};
+
+  ctx->requests.resize(shards_.size());
+  ctx->rows.resize(shards_.size());
+  ctx->keys.resize(shards_.size());
+  if (delegate_) {
+    for (auto &shard : shards_) {
+      ctx->channels.emplace_back(new Channel);
+      shard->Connect(ctx->channels.back().get());
+    }
+  }
+  return ctx.release();
+}
+
+void PartitionedDB::Close(void *ctx_) {
+  auto &ctx = PartitionedCtx::cast(ctx_);
+
+  if (delegate_) {
+    for (std::size_t i = 0; i < shards_.size(); i++) {
+      Request &req = ctx.requests[i];
+      req.type = Request::CLOSE;
+      Call(ctx_, i, req);
+    }
+  }
+  delete &ctx;
+}
+
+void PartitionedDB::Call(void *ctx_, std::size_t shard, Request &req) {
+  auto &ctx = PartitionedCtx::cast(ctx_);
+
+  if (!delegate_) {
+    std::lock_guard<std::mutex> lock(shards_[shard]->lock);
+    shards_[shard]->Perform(req);
+    return;
+  }
+
+  Channel &channel = *ctx.channels[shard];
+  Request *done;
+  while (!channel.requests.Push(&req))
+    __builtin_ia32_pause();
+  while (!channel.completions.Pop(done))
+    __builtin_ia32_pause();
+}
+
+int PartitionedDB::Read(void *ctx, const string &table, const string &key,
+                        const vector<string> *fields, vector<KVPair> &result) {
+  Request req;
+  req.type = Request::READ;
+  req.table = &table;
+  req.key = &key;
+  req.fields = fields;
+  req.values = &result;
+  Call(ctx, ShardOf(key), req);
+  return req.status;
+}
+
+int PartitionedDB::Scan(void *ctx_, const string &table, const string &key,
+                        int len, const vector<string> *fields,
+                        vector<vector<KVPair>> &result) {
+  auto &ctx = PartitionedCtx::cast(ctx_);
+  auto &rows = ctx.rows;
+  auto &keys = ctx.keys;
+
+  // Each shard may hold all of the len records following key.
+  for (std::size_t i = 0; i < shards_.size(); i++) {
+    Request &req = ctx.requests[i];
+    req.type = Request::SCAN;
+    req.table = &table;
+    req.key = &key;
+    req.len = len;
+    req.fields = fields;
+    req.rows = &rows[i];
+    req.keys = &keys[i];
+  }
+
+  if (delegate_) {
+    // Let all owners scan at the same time.
+    for (std::size_t i = 0; i < shards_.size(); i++) {
+      while (!ctx.channels[i]->requests.Push(&ctx.requests[i]))
+        __builtin_ia32_pause();
+    }
+    for (std::size_t i = 0; i < shards_.size(); i++) {
+      Request *done;
+      while (!ctx.channels[i]->completions.Pop(done))
+        __builtin_ia32_pause();
+    }
+  } else {
+    for (std::size_t i = 0; i < shards_.size(); i++)
+      Call(ctx_, i, ctx.requests[i]);
+  }
+
+  std::size_t n = merge_sorted_rows(keys, rows, len, result);
+  return n == 0 ? kErrorNoData : kOK;
+}
+
+int PartitionedDB::Update(void *ctx, const string &table, const string &key,
+                          vector<KVPair> &values) {
+  Request req;
+  req.type = Request::UPDATE;
+  req.table = &table;
+  req.key = &key;
+  req.values = &values;
+  Call(ctx, ShardOf(key), req);
+  return req.status;
+}
+
+int PartitionedDB::Insert(void *ctx, const string &table, const string &key,
+                          vector<KVPair> &values) {
+  Request req;
+  req.type = Request::INSERT;
+  req.table = &table;
+  req.key = &key;
+  req.values = &values;
+  Call(ctx, ShardOf(key), req);
+  return req.status;
+}
+
+int PartitionedDB::Delete(void *ctx, const string &table, const string &key) {
+  Request req;
+  req.type = Request::DELETE;
+  req.table = &table;
+  req.key = &key;
+  Call(ctx, ShardOf(key), req);
+  return req.status;
+}
+
+} // ycsbc
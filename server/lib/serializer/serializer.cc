@@ -10,8 +10,45 @@
 #include "serializer.h"
 
 using namespace serializer;
+using ycsbc::DB;
+using ycsbc::ResultView;
+using ycsbc::Slice;
 using ycsbc::Table;
 
+Schema::Schema(DB::Tables tables) : tables{std::move(tables)} {
+  for (std::size_t t = 0; t < this->tables.size(); t++) {
+    table_ids[this->tables[t].name] = t;
+
+    column_ids.emplace_back();
+    auto &columns = this->tables[t].columns;
+    for (std::size_t c = 0; c < columns.size(); c++)
+      column_ids.back()[columns[c]] = c + 1;
+  }
+}
+
+std::size_t Schema::table_id(std::string const &name) const {
+  auto it = table_ids.find(name);
+  if (it == table_ids.end())
+    throw std::runtime_error{"Unknown table " + name};
+  return it->second;
+}
+
+std::string const &Schema::table(std::size_t table) const {
+  return tables.at(table).name;
+}
+
+std::size_t Schema::column_id(std::size_t table,
+                              std::string const &name) const {
+  auto &ids = column_ids.at(table);
+  auto it = ids.find(name);
+  return it == ids.end() ? 0 : it->second;
+}
+
+std::string const &Schema::column(std::size_t table,
+                                  std::size_t column) const {
+  return tables.at(table).columns.at(column - 1);
+}
+
 // Even with overflow for `end`, this program works correctly.
 Serializer::Serializer(char *buf, std::size_t len)
     : orig_buf{buf}, buf{buf}, end{buf + len} {}
@@ -36,6 +73,133 @@ Serializer &Serializer::operator<<(Table const &t) {
   return *this << t.name << t.columns;
 }
 
+Serializer &Serializer::operator<<(Slice const &s) {
+  *this << s.size;
+  serialize(s.data, s.size);
+  return *this;
+}
+
+Serializer &Serializer::varint(std::size_t n) {
+  // At most 10 bytes for a 64 bit integer.
+  char bytes[10];
+  std::size_t len = 0;
+
+  do {
+    bytes[len] = n & 0x7f;
+    n >>= 7;
+    if (n)
+      bytes[len] |= 0x80;
+    len++;
+  } while (n);
+
+  serialize(bytes, len);
+  return *this;
+}
+
+Serializer &Serializer::bytes(Slice const &s) {
+  varint(s.size);
+  serialize(s.data, s.size);
+  return *this;
+}
+
+Serializer &Serializer::field(Schema const &schema, std::size_t table,
+                              Slice const &name) {
+  // Column names are short, so the temporary string does not allocate.
+  std::size_t id = schema.column_id(table, name.str());
+
+  varint(id);
+  if (id == 0)
+    bytes(name);
+  return *this;
+}
+
+Serializer &Serializer::fields(Schema const &schema, std::size_t table,
+                               std::vector<std::string> const *fields) {
+  if (fields == nullptr)
+    return varint(0);
+
+  varint(fields->size());
+  for (auto &f : *fields)
+    field(schema, table, f);
+  return *this;
+}
+
+Serializer &Serializer::values(Schema const &schema, std::size_t table,
+                               std::vector<DB::KVPair> const &values) {
+  varint(values.size());
+  for (auto &v : values) {
+    field(schema, table, v.first);
+    bytes(v.second);
+  }
+  return *this;
+}
+
+Serializer &Serializer::record(Schema const &schema, std::size_t table,
+                               ResultView const &v, std::size_t i) {
+  if (i >= v.Records())
+    return varint(0);
+
+  varint(v.Fields(i));
+  for (auto f = v.begin(i); f != v.end(i); ++f) {
+    field(schema, table, f->first);
+    bytes(f->second);
+  }
+  return *this;
+}
+
+Serializer &Serializer::records(Schema const &schema, std::size_t table,
+                                ResultView const &v) {
+  varint(v.Records());
+  for (std::size_t i = 0; i < v.Records(); i++)
+    record(schema, table, v, i);
+  return *this;
+}
+
+std::size_t Serializer::chunk(Schema const &schema, std::size_t table,
+                              ResultView const &v, std::size_t first) {
+  // Leave space for the number of records and the continuation flag.
+  std::size_t header = varint_size(v.Records()) + varint_size(1);
+  std::size_t space = remaining() > header ? remaining() - header : 0;
+
+  std::size_t last = first;
+  for (; last < v.Records(); last++) {
+    std::size_t size = record_size(schema, table, v, last);
+    if (size > space)
+      break;
+    space -= size;
+  }
+  // A record larger than the whole buffer cannot be split, let record()
+  // report the overflow.
+  if (last == first && last < v.Records())
+    last++;
+
+  varint(last - first);
+  varint(last < v.Records() ? 1 : 0);
+  for (std::size_t i = first; i < last; i++)
+    record(schema, table, v, i);
+  return last;
+}
+
+std::size_t Serializer::varint_size(std::size_t n) {
+  std::size_t len = 1;
+  while (n >>= 7)
+    len++;
+  return len;
+}
+
+std::size_t Serializer::record_size(Schema const &schema, std::size_t table,
+                                    ResultView const &v, std::size_t i) {
+  std::size_t size = varint_size(v.Fields(i));
+  for (auto f = v.begin(i); f != v.end(i); ++f) {
+    std::size_t id = schema.column_id(table, f->first.str());
+    size += varint_size(id);
+    if (id == 0)
+      size += varint_size(f->first.size) + f->first.size;
+    size += varint_size(f->second.size) + f->second.size;
+  }
+  return size;
+}
+
 void Serializer::assert_remaining(std::size_t n) {
   if (reinterpret_cast<std::size_t>(end) - reinterpret_cast<std::size_t>(buf) <
       n)
@@ -48,30 +212,203 @@ void Serializer::serialize(char const *bytes, std::size_t n) {
   buf += n;
 }
 
-Deserializer::Deserializer(char const *buf) : buf{buf} {}
+Deserializer::Deserializer(char const *buf, std::size_t len)
+    : buf{buf}, end{buf + len} {}
 
 Deserializer &Deserializer::operator>>(int &i) {
-  std::memcpy(&i, buf, sizeof(i));
-  buf += sizeof(i);
+  deserialize(&i, sizeof(i));
   return *this;
 }
 
 Deserializer &Deserializer::operator>>(std::size_t &n) {
-  std::memcpy(&n, buf, sizeof(n));
-  buf += sizeof(n);
+  deserialize(&n, sizeof(n));
   return *this;
 }
 
 Deserializer &Deserializer::operator>>(std::string &s) {
   std::size_t size{};
   *this >> size;
-  s.clear();
-  s.reserve(size);
-  s.append(buf, size);
-  buf += size;
+  s.assign(skip(size), size);
   return *this;
 }
 
 Deserializer &Deserializer::operator>>(Table &t) {
   return *this >> t.name >> t.columns;
 }
+
+Deserializer &Deserializer::operator>>(Slice &s) {
+  *this >> s.size;
+  s.data = skip(s.size);
+  return *this;
+}
+
+Deserializer &Deserializer::varint(std::size_t &n) {
+  unsigned char byte;
+  unsigned shift = 0;
+
+  n = 0;
+  do {
+    if (shift >= 8 * sizeof(n))
+      throw std::runtime_error{"Deserializer found malformed varint"};
+    byte = static_cast<unsigned char>(*skip(1));
+    n |= static_cast<std::size_t>(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return *this;
+}
+
+Deserializer &Deserializer::bytes(std::string &s) {
+  std::size_t size{};
+  varint(size);
+  s.assign(skip(size), size);
+  return *this;
+}
+
+Deserializer &Deserializer::bytes(Slice &s) {
+  varint(s.size);
+  s.data = skip(s.size);
+  return *this;
+}
+
+Deserializer &Deserializer::field(Schema const &schema, std::size_t table,
+                                  Slice &name) {
+  std::size_t id{};
+  varint(id);
+  if (id == 0)
+    return bytes(name);
+
+  name = schema.column(table, id);
+  return *this;
+}
+
+Deserializer &Deserializer::fields(Schema const &schema, std::size_t table,
+                                   std::vector<std::string> &fields) {
+  std::size_t size{};
+  varint(size);
+  assert_remaining(size);
+
+  fields.resize(size);
+  for (auto &f : fields) {
+    Slice name;
+    field(schema, table, name);
+    f.assign(name.data, name.size);
+  }
+  return *this;
+}
+
+Deserializer &Deserializer::values(Schema const &schema, std::size_t table,
+                                   std::vector<DB::KVPair> &values) {
+  std::size_t size{};
+  varint(size);
+  assert_remaining(size);
+
+  values.resize(size);
+  for (auto &v : values) {
+    Slice name;
+    field(schema, table, name);
+    v.first.assign(name.data, name.size);
+    bytes(v.second);
+  }
+  return *this;
+}
+
+Deserializer &Deserializer::records(Schema const &schema, std::size_t table,
+                                    std::vector<std::vector<DB::KVPair>> &r) {
+  std::size_t size{};
+  varint(size);
+  assert_remaining(size);
+
+  r.resize(size);
+  for (auto &record : r)
+    values(schema, table, record);
+  return *this;
+}
+
+Deserializer &Deserializer::record(Schema const &schema, std::size_t table,
+                                   ResultView &v) {
+  v.Clear();
+  return append_record(schema, table, v);
+}
+
+Deserializer &Deserializer::records(Schema const &schema, std::size_t table,
+                                    ResultView &v) {
+  v.Clear();
+
+  std::size_t size{};
+  varint(size);
+  for (std::size_t i = 0; i < size; i++)
+    append_record(schema, table, v);
+  return *this;
+}
+
+bool Deserializer::chunk(Schema const &schema, std::size_t table,
+                         std::vector<std::vector<DB::KVPair>> &r,
+                         std::size_t first) {
+  std::size_t size{}, more{};
+  varint(size);
+  varint(more);
+  assert_remaining(size);
+
+  r.resize(first + size);
+  for (std::size_t i = first; i < r.size(); i++)
+    values(schema, table, r[i]);
+  return more;
+}
+
+bool Deserializer::chunk(Schema const &schema, std::size_t table,
+                         ResultView &v, bool first) {
+  if (first)
+    v.Clear();
+
+  std::size_t size{}, more{};
+  varint(size);
+  varint(more);
+  for (std::size_t i = 0; i < size; i++)
+    append_record(schema, table, v, more);
+  return more;
+}
+
+Deserializer &Deserializer::append_record(Schema const &schema,
+                                          std::size_t table, ResultView &v,
+                                          bool copy) {
+  std::size_t size{};
+  varint(size);
+
+  v.AddRecord();
+  for (std::size_t i = 0; i < size; i++) {
+    Slice name, value;
+    std::size_t id{};
+
+    // Like field(), but names sent as string must be copied as well.
+    varint(id);
+    if (id == 0) {
+      bytes(name);
+      if (copy)
+        name = v.Copy(name.data, name.size);
+    } else {
+      name = schema.column(table, id);
+    }
+
+    bytes(value);
+    if (copy)
+      value = v.Copy(value.data, value.size);
+    v.Add(name, value);
+  }
+  return *this;
+}
+
+void Deserializer::assert_remaining(std::size_t n) const {
+  if (remaining() < n)
+    throw std::runtime_error{"Deserializer overflowed"};
+}
+
+void Deserializer::deserialize(void *dst, std::size_t n) {
+  std::memcpy(dst, skip(n), n);
+}
+
+char const *Deserializer::skip(std::size_t n) {
+  assert_remaining(n);
+  char const *start = buf;
+  buf += n;
+  return start;
+}
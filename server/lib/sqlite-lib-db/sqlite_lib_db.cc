@@ -16,6 +16,8 @@
 #include <memory>                   // For unique_ptr
 #include <algorithm>                // For std::sort
 #include <unordered_map>            // For std::unordered_map
+#include <cstdint>
+#include <cstring>                  // For memcpy
 
 using std::string;
 using std::vector;
@@ -33,6 +35,14 @@ struct Ctx {
     sqlite3 *database = nullptr;
     // Use a map as a statement cache like in the original YCSB.
     std::unordered_map<std::string, sqlite3_stmt *> stmts{};
+    // Number of inserts per explicit transaction (0 for autocommit)
+    std::size_t batch = 0;
+    // Inserts performed in the currently open batch transaction
+    std::size_t pending = 0;
+    // Result column names of the cached statements, looked up only once
+    std::unordered_map<sqlite3_stmt *, std::vector<std::string>> col_names{};
+    // Scratch list of the result columns selected by the current operation
+    std::vector<int> selected{};
 
     Ctx() = default;
     ~Ctx() {
@@ -53,6 +63,80 @@ struct Ctx {
     static Ctx &cast(void *ctx) {
         return *reinterpret_cast<Ctx *>(ctx);
     }
+
+    // Look up stmt in the statement cache, prepare it if it is not cached.
+    sqlite3_stmt *prepare(string stmt) {
+        auto it = stmts.find(stmt);
+        if (it != stmts.end())
+            return it->second;
+
+        sqlite3_stmt *pStmt = nullptr;
+        int rc = sqlite3_prepare_v2(database, stmt.c_str(), stmt.length(),
+                                    &pStmt, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "SQL error: " << sqlite3_errmsg(database) << std::endl;
+            throw std::runtime_error("Failed to prepare statement");
+        }
+
+        stmts.insert({std::move(stmt), pStmt});
+        return pStmt;
+    }
+
+    // Determine which result columns of pStmt to return for fields (all of
+    // them if fields is NULL or empty). Fills and returns selected.
+    const std::vector<int> &select(sqlite3_stmt *pStmt,
+                                   const std::vector<std::string> *fields) {
+        auto it = col_names.find(pStmt);
+        if (it == col_names.end()) {
+            std::vector<std::string> names;
+            for (int i = 0; i < sqlite3_column_count(pStmt); i++)
+                names.emplace_back(sqlite3_column_name(pStmt, i));
+            it = col_names.emplace(pStmt, std::move(names)).first;
+        }
+
+        auto &names = it->second;
+        selected.clear();
+        for (std::size_t i = 0; i < names.size(); i++) {
+            if (fields == nullptr || fields->size() == 0 ||
+                std::find(fields->begin(), fields->end(), names[i]) !=
+                fields->end())
+                selected.push_back(i);
+        }
+        return selected;
+    }
+
+    // Copy the selected columns of the current result row of pStmt into row.
+    // Strings already present in row are overwritten to reuse their memory.
+    void fill_row(sqlite3_stmt *pStmt, std::vector<DB::KVPair> &row) const {
+        auto &names = col_names.at(pStmt);
+
+        row.resize(selected.size());
+        for (std::size_t i = 0; i < selected.size(); i++) {
+            int col = selected[i];
+            // sqlite3_column_bytes() must be called after
+            // sqlite3_column_text() for getting the length of the text.
+            auto text = reinterpret_cast<const char *>(
+                sqlite3_column_text(pStmt, col));
+            row[i].first.assign(names[col]);
+            row[i].second.assign(text ? text : "",
+                                 sqlite3_column_bytes(pStmt, col));
+        }
+    }
+
+    // Append the selected columns of the current result row of pStmt to
+    // view as a new record. Only the values are copied (into the arena of
+    // view), the field names reference the cached column names.
+    void fill_view(sqlite3_stmt *pStmt, ResultView &view) const {
+        auto &names = col_names.at(pStmt);
+
+        view.AddRecord();
+        for (int col : selected) {
+            auto text = reinterpret_cast<const char *>(
+                sqlite3_column_text(pStmt, col));
+            view.Add(names[col],
+                     view.Copy(text, sqlite3_column_bytes(pStmt, col)));
+        }
+    }
 };
 
 /* Create an escaped string.
@@ -63,6 +147,35 @@ static std::unique_ptr<char, decltype(&sqlite3_free)> escape_sql(const char *str
     return {sqlite3_mprintf("%Q", str), sqlite3_free};
 }
 
+/* Execute an SQL statement that does not return any rows.
+ *
+ * Retries as long as other connections to the shared cache hold conflicting
+ * locks, just like the stepping loops of the benchmark operations.
+ */
+static void exec_sql(sqlite3 *database, const string &stmt) {
+    int rc = -1;                    // Return code for DB operations
+
+    char *err_msg = NULL;           // Error message returned from sqlite
+
+    do {
+        sqlite3_free(err_msg);
+        err_msg = NULL;
+        rc = sqlite3_exec(database, stmt.c_str(), NULL, NULL, &err_msg);
+    } while (rc == SQLITE_LOCKED || rc == SQLITE_BUSY);
+    if (rc != SQLITE_OK) {
+        std::cerr << "SQL error: " << err_msg << std::endl;
+
+        sqlite3_free(err_msg);
+
+        throw std::runtime_error("Failed to execute statement");
+    }
+}
+
+/* Name of the index on the key column that is built after the load phase. */
+static string key_index_name(const string &table) {
+    return escape_sql((table + "_YCSBC_KEY").c_str()).get();
+}
+
 /* Bind a string to an SQLite statement. */
 static void bind_string(sqlite3_stmt *stmt, int pos, const std::string &str) {
     int rc = -1;
@@ -94,7 +207,13 @@ static void bind_int(sqlite3_stmt *stmt, int pos, int val) {
  * filename is copied because default arguments do not outlive the constructor
  * expression.
  */
-SqliteLibDB::SqliteLibDB(const string &filename): filename{filename} {}
+SqliteLibDB::SqliteLibDB(const string &filename,
+                         const SqliteLibOptions &options)
+    : filename{filename}, options{options} {
+    // WITHOUT ROWID tables always need their primary key.
+    if (options.blob_rows && options.defer_index)
+        throw std::invalid_argument("Cannot defer key index for BLOB rows");
+}
 
 sqlite3* SqliteLibDB::OpenDB() const {
     int rc = -1;                    // Return code for DB operations
@@ -108,6 +227,9 @@ sqlite3* SqliteLibDB::OpenDB() const {
         filename_cstr = "file::memory:?cache=shared";
         flags |= SQLITE_OPEN_URI;
     }
+    // Named in-memory DBs (e.g., for shards) are given as URI.
+    else if (filename.compare(0, 5, "file:") == 0)
+        flags |= SQLITE_OPEN_URI;
 
     sqlite3 *database;
     // Open a new database
@@ -128,9 +250,19 @@ sqlite3* SqliteLibDB::OpenDB() const {
  * The schema of newly created tables is as follows:
  *      - one column named YCSBC_KEY (VARCHAR, primary key of table)
  *      - multiple columns with type TEXT
+ *
+ * If the key index is deferred, YCSBC_KEY is not declared as primary key.
+ * Instead, a unique index on it is built at the end of the load phase.
+ *
+ * For BLOB rows, the table is a WITHOUT ROWID table with only two columns:
+ *      - YCSBC_KEY (VARCHAR, primary key of table)
+ *      - YCSBC_VALUE (BLOB, all fields packed in the order of the schema)
  */
 void SqliteLibDB::CreateSchema(DB::Tables tables) {
     schema_database = OpenDB();
+    schema_tables = tables;
+    for (auto &table : tables)
+        columns[table.name] = table.columns;
 
     for (auto &table : tables) {
         int rc = -1;                    // Return code for DB operations
@@ -140,13 +272,20 @@ void SqliteLibDB::CreateSchema(DB::Tables tables) {
         // Assemble an SQL table creation statement
         string stmt{"CREATE TABLE IF NOT EXISTS "};
         stmt += escape_sql(table.name.c_str()).get();
-        stmt += " (YCSBC_KEY VARCHAR PRIMARY KEY";
-        for (auto &col : table.columns) {
-            stmt += ", ";
-            stmt += escape_sql(col.c_str()).get();
-            stmt += " TEXT";
+        stmt += " (YCSBC_KEY VARCHAR";
+        if (!options.defer_index)
+            stmt += " PRIMARY KEY";
+        if (options.blob_rows) {
+            stmt += ", YCSBC_VALUE BLOB) WITHOUT ROWID;";
+        }
+        else {
+            for (auto &col : table.columns) {
+                stmt += ", ";
+                stmt += escape_sql(col.c_str()).get();
+                stmt += " TEXT";
+            }
+            stmt += ");";
         }
-        stmt += ");";
 
         // We only expect one result row to be returned, hence no separate
         // callback function is needed.
@@ -166,13 +305,145 @@ void *SqliteLibDB::Init() {
     std::unique_ptr<Ctx> ctx{new Ctx{}};
     ctx->database = OpenDB();
 
+    // Connections opened for the load phase group their inserts.
+    if (loading && options.load_batch > 1)
+        ctx->batch = options.load_batch;
+
     // TODO: Configure journaling (memory vs. off)
 
     return ctx.release();
 }
 
-void SqliteLibDB::Close(void *ctx) {
-    delete &Ctx::cast(ctx);
+void SqliteLibDB::Close(void *ctx_) {
+    auto &ctx = Ctx::cast(ctx_);
+
+    // Commit the last, partially filled batch.
+    if (ctx.pending)
+        exec_sql(ctx.database, "COMMIT;");
+
+    delete &ctx;
+}
+
+/* Drop the key indexes so that loading does not have to maintain them. */
+void SqliteLibDB::BeginLoad() {
+    if (options.defer_index) {
+        for (auto &table : schema_tables)
+            exec_sql(schema_database,
+                     "DROP INDEX IF EXISTS " + key_index_name(table.name) +
+                     ";");
+    }
+
+    loading = true;
+}
+
+/* (Re)build the key indexes once all records are present. */
+void SqliteLibDB::EndLoad() {
+    loading = false;
+
+    if (options.defer_index) {
+        for (auto &table : schema_tables) {
+            string stmt{"CREATE UNIQUE INDEX IF NOT EXISTS "};
+            stmt += key_index_name(table.name);
+            stmt += " ON ";
+            stmt += escape_sql(table.name.c_str()).get();
+            stmt += " (YCSBC_KEY);";
+            exec_sql(schema_database, stmt);
+        }
+    }
+}
+
+// Open the database file of a snapshot.
+static sqlite3 *open_snapshot(const string &path, int flags) {
+    sqlite3 *file;
+    if (sqlite3_open_v2(path.c_str(), &file, flags, nullptr) != SQLITE_OK) {
+        string msg = sqlite3_errmsg(file);
+        sqlite3_close(file);
+        throw std::runtime_error("Cannot open snapshot " + path + ": " + msg);
+    }
+    return file;
+}
+
+// Copy all pages of the main database of src to dest in a single step.
+static void copy_database(sqlite3 *dest, sqlite3 *src) {
+    sqlite3_backup *backup = sqlite3_backup_init(dest, "main", src, "main");
+    if (!backup)
+        throw std::runtime_error(string{"Failed to start backup: "} +
+                                 sqlite3_errmsg(dest));
+    sqlite3_backup_step(backup, -1);
+    if (sqlite3_backup_finish(backup) != SQLITE_OK)
+        throw std::runtime_error(string{"Failed to copy database: "} +
+                                 sqlite3_errmsg(dest));
+}
+
+// Store the description of the records in a table of the snapshot.
+static void write_records(sqlite3 *file, const string &records) {
+    exec_sql(file, "CREATE TABLE YCSBC_SNAPSHOT (RECORDS TEXT);");
+
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(file, "INSERT INTO YCSBC_SNAPSHOT VALUES (?);", -1,
+                           &stmt, NULL) != SQLITE_OK)
+        throw std::runtime_error(string{"Failed to prepare statement: "} +
+                                 sqlite3_errmsg(file));
+    sqlite3_bind_text(stmt, 1, records.c_str(), records.size(),
+                      SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE)
+        throw std::runtime_error(string{"Failed to describe snapshot: "} +
+                                 sqlite3_errmsg(file));
+}
+
+// Report the description of the records stored by write_records().
+static string read_records(sqlite3 *file, const string &path) {
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(file, "SELECT RECORDS FROM YCSBC_SNAPSHOT;", -1,
+                           &stmt, NULL) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        throw std::runtime_error("Not a snapshot: " + path);
+    }
+
+    string records;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *text =
+            reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+        int bytes = sqlite3_column_bytes(stmt, 0);
+        records.assign(text ? text : "", bytes);
+    }
+    sqlite3_finalize(stmt);
+    return records;
+}
+
+bool SqliteLibDB::Snapshot(const string &path, const string &records) {
+    sqlite3 *file = open_snapshot(path,
+                                  SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    try {
+        copy_database(file, schema_database);
+        write_records(file, records);
+    } catch (...) {
+        sqlite3_close(file);
+        throw;
+    }
+    sqlite3_close(file);
+    return true;
+}
+
+bool SqliteLibDB::Restore(const string &path, const string &records) {
+    sqlite3 *file = open_snapshot(path, SQLITE_OPEN_READONLY);
+    try {
+        string stored = read_records(file, path);
+        if (stored != records)
+            throw std::runtime_error("Snapshot " + path +
+                                     " holds other records: " + stored);
+        copy_database(schema_database, file);
+    } catch (...) {
+        sqlite3_close(file);
+        throw;
+    }
+    sqlite3_close(file);
+
+    // The description is not part of the benchmark database.
+    exec_sql(schema_database, "DROP TABLE YCSBC_SNAPSHOT;");
+    return true;
 }
 
 int SqliteLibDB::Read(void *ctx_, const string &table, const string &key,
@@ -181,6 +452,9 @@ int SqliteLibDB::Read(void *ctx_, const string &table, const string &key,
     int retval = -1;                    // Return code of this function
     int db_rc  = -1;                    // Return code for DB operations
     
+    if (options.blob_rows)
+        return ReadBlob(ctx_, table, key, fields, result);
+
     auto &ctx = Ctx::cast(ctx_);
 
     // Assemble an SQL selection statement. We always select everything from
@@ -219,31 +493,14 @@ int SqliteLibDB::Read(void *ctx_, const string &table, const string &key,
     switch (db_rc) {
     case SQLITE_DONE:
         // Nothing was found
+        result.clear();
         retval = kErrorNoData;
         break;
     case SQLITE_ROW:
         // Fill the result into the result vector, filter out unwanted columns
         
-        // We need to create a separate scope to be able to define variables
-        // "private" to this case
-        {
-            // get number of result columns returned by the sqlite query
-            int col_cnt = sqlite3_data_count(pStmt);    
-       
-            for (int i = 0; i < col_cnt; i++) {
-                string col_name(reinterpret_cast<const char *>(
-                                sqlite3_column_name(pStmt, i)));
-                
-                if (fields == nullptr || fields->size() == 0 ||
-                    std::find(fields->begin(), fields->end(), col_name) !=
-                    fields->end()) {
-                    string col_content(reinterpret_cast<const char *>(
-                                       sqlite3_column_text(pStmt, i)));
-
-                    result.emplace_back(col_name, col_content);
-                }
-            }
-        }
+        ctx.select(pStmt, fields);
+        ctx.fill_row(pStmt, result);
 
         retval = kOK;
         break;
@@ -262,12 +519,23 @@ int SqliteLibDB::Read(void *ctx_, const string &table, const string &key,
     return(retval);
 }
 
-int SqliteLibDB::Scan(void *ctx_, const string &table, const string &key,
+int SqliteLibDB::Scan(void *ctx, const string &table, const string &key,
                       int len, const vector<std::string> *fields,
                       vector<std::vector<KVPair>> &result) {
+    return ScanWithKeys(ctx, table, key, len, fields, result, nullptr);
+}
+
+int SqliteLibDB::ScanWithKeys(void *ctx_, const string &table,
+                              const string &key, int len,
+                              const vector<std::string> *fields,
+                              vector<std::vector<KVPair>> &result,
+                              vector<std::string> *keys) {
     int retval = -1;                    // Return code of this function
     int db_rc  = -1;                    // Return code for DB operations
     
+    if (options.blob_rows)
+        return ScanBlob(ctx_, table, key, len, fields, result, keys);
+
     auto &ctx = Ctx::cast(ctx_);
 
     // Assemble an SQL selection statement. We always select everything from
@@ -276,7 +544,7 @@ int SqliteLibDB::Scan(void *ctx_, const string &table, const string &key,
     // to the KVPair vector anyways.
     string stmt{"SELECT * FROM "};
     stmt += escape_sql(table.c_str()).get();
-    stmt += "  WHERE YCSBC_KEY >= ? LIMIT ?;";
+    stmt += "  WHERE YCSBC_KEY >= ? ORDER BY YCSBC_KEY LIMIT ?;";
 
     auto it = ctx.stmts.find(stmt);
     sqlite3_stmt *pStmt = nullptr;
@@ -299,36 +567,28 @@ int SqliteLibDB::Scan(void *ctx_, const string &table, const string &key,
     bind_string(pStmt, 1, key);
     bind_int(pStmt, 2, len);
 
+    // The selected columns are the same for all rows.
+    ctx.select(pStmt, fields);
+
     // We have to step the database multiple times, since we have requested
     // several rows at once. Bail out of the whole application upon any errors.
+    // Rows already present in result are overwritten to reuse their memory.
+    std::size_t rows = 0;
     retval = kErrorNoData;
     while ((db_rc = sqlite3_step(pStmt)) != SQLITE_DONE) {
         if (db_rc == SQLITE_ROW) {
             // Fill the result into the result vector, filter out unwanted 
             // columns
-        
-            // We need to create a separate scope to be able to define variables
-            // "private" to this case
-            // get number of result columns returned by the sqlite query
-            int col_cnt = sqlite3_data_count(pStmt);
-
-            vector<KVPair> row_vec(fields ? fields->size() : col_cnt);
-
-            for (int i = 0; i < col_cnt; i++) {
-                string col_name(reinterpret_cast<const char *>(
-                                sqlite3_column_name(pStmt, i)));
-
-                if (fields == nullptr || fields->size() == 0 || 
-                    std::find(fields->begin(), fields->end(), col_name) !=
-                    fields->end()) {
-                    string col_content(reinterpret_cast<const char *>(
-                                       sqlite3_column_text(pStmt, i)));
-
-                    row_vec.emplace_back(col_name, col_content);
-                }
+            if (rows == result.size())
+                result.emplace_back();
+            ctx.fill_row(pStmt, result[rows++]);
+
+            if (keys) {
+                // The text must be fetched before its length.
+                auto text = reinterpret_cast<const char *>(
+                    sqlite3_column_text(pStmt, 0));
+                keys->emplace_back(text, sqlite3_column_bytes(pStmt, 0));
             }
-
-            result.push_back(row_vec);
             retval = kOK;
         }
         else {
@@ -338,6 +598,7 @@ int SqliteLibDB::Scan(void *ctx_, const string &table, const string &key,
             throw std::runtime_error("Failed to step scan statement");
         }
     }
+    result.resize(rows);
 
     check_sqlite(sqlite3_clear_bindings(pStmt));
     check_sqlite(sqlite3_reset(pStmt));
@@ -347,6 +608,87 @@ int SqliteLibDB::Scan(void *ctx_, const string &table, const string &key,
     return(retval);
 }
 
+int SqliteLibDB::ReadView(void *ctx_, const string &table, const string &key,
+                          const vector<std::string> *fields,
+                          ResultView &result) {
+    int retval = -1;                    // Return code of this function
+
+    // Packed rows are only supported through the adapter.
+    if (options.blob_rows)
+        return DB::ReadView(ctx_, table, key, fields, result);
+
+    auto &ctx = Ctx::cast(ctx_);
+
+    // Same statement as for Read(), so it is shared in the cache.
+    string stmt{"SELECT * FROM "};
+    stmt += escape_sql(table.c_str()).get();
+    stmt += "  WHERE YCSBC_KEY = ?";
+    sqlite3_stmt *pStmt = ctx.prepare(std::move(stmt));
+
+    bind_string(pStmt, 1, key);
+
+    result.Clear();
+    switch (sqlite3_step(pStmt)) {
+    case SQLITE_DONE:
+        retval = kErrorNoData;
+        break;
+    case SQLITE_ROW:
+        ctx.select(pStmt, fields);
+        ctx.fill_view(pStmt, result);
+        retval = kOK;
+        break;
+    default:
+        std::cerr << "Stepping error: " << sqlite3_errmsg(ctx.database) << std::endl;
+        throw std::runtime_error("Failed to step read statement");
+    }
+
+    check_sqlite(sqlite3_clear_bindings(pStmt));
+    check_sqlite(sqlite3_reset(pStmt));
+
+    return retval;
+}
+
+int SqliteLibDB::ScanView(void *ctx_, const string &table, const string &key,
+                          int len, const vector<std::string> *fields,
+                          ResultView &result) {
+    int retval = kErrorNoData;          // Return code of this function
+    int db_rc  = -1;                    // Return code for DB operations
+
+    // Packed rows are only supported through the adapter.
+    if (options.blob_rows)
+        return DB::ScanView(ctx_, table, key, len, fields, result);
+
+    auto &ctx = Ctx::cast(ctx_);
+
+    // Same statement as for Scan(), so it is shared in the cache.
+    string stmt{"SELECT * FROM "};
+    stmt += escape_sql(table.c_str()).get();
+    stmt += "  WHERE YCSBC_KEY >= ? ORDER BY YCSBC_KEY LIMIT ?;";
+    sqlite3_stmt *pStmt = ctx.prepare(std::move(stmt));
+
+    bind_string(pStmt, 1, key);
+    bind_int(pStmt, 2, len);
+
+    ctx.select(pStmt, fields);
+
+    result.Clear();
+    while ((db_rc = sqlite3_step(pStmt)) != SQLITE_DONE) {
+        if (db_rc != SQLITE_ROW) {
+            std::cerr << "Stepping error: "
+                      << sqlite3_errmsg(ctx.database) << std::endl;
+            throw std::runtime_error("Failed to step scan statement");
+        }
+
+        ctx.fill_view(pStmt, result);
+        retval = kOK;
+    }
+
+    check_sqlite(sqlite3_clear_bindings(pStmt));
+    check_sqlite(sqlite3_reset(pStmt));
+
+    return retval;
+}
+
 int SqliteLibDB::Update(void *ctx_, const string &table, const string &key,
                         vector<KVPair> &values) {
     int  rc    = -1;                    // Return code for DB operations
@@ -354,6 +696,9 @@ int SqliteLibDB::Update(void *ctx_, const string &table, const string &key,
     
     std::size_t i = 0;                  // Index into values vector
 
+    if (options.blob_rows)
+        return UpdateBlob(ctx_, table, key, values);
+
     auto &ctx = Ctx::cast(ctx_);
 
     // Assemble an SQL insertion statement.
@@ -414,6 +759,9 @@ int SqliteLibDB::Insert(void *ctx_, const string &table, const string &key,
                         vector<KVPair> &values) {
     int rc = -1;                    // Return code for DB operations
     
+    if (options.blob_rows)
+        return InsertBlob(ctx_, table, key, values);
+
     auto &ctx = Ctx::cast(ctx_);
 
     // Sort fields such that order becomes irrelevant for key of map.
@@ -455,6 +803,10 @@ int SqliteLibDB::Insert(void *ctx_, const string &table, const string &key,
         bind_string(pStmt, i + 2, values[i].second);
     }
 
+    // When bulk loading, the first insert of a batch opens the transaction.
+    if (ctx.batch && !ctx.pending)
+        exec_sql(ctx.database, "BEGIN;");
+
     // We do not expect any result row, hence SQLITE_DONE should be returned.
     do {
         rc = sqlite3_step(pStmt);
@@ -468,6 +820,11 @@ int SqliteLibDB::Insert(void *ctx_, const string &table, const string &key,
     check_sqlite(sqlite3_clear_bindings(pStmt));
     check_sqlite(sqlite3_reset(pStmt));
 
+    if (ctx.batch && ++ctx.pending == ctx.batch) {
+        exec_sql(ctx.database, "COMMIT;");
+        ctx.pending = 0;
+    }
+
     return kOK;
 }
 
@@ -512,6 +869,315 @@ int SqliteLibDB::Delete(void *ctx_, const string &table, const string &key) {
     return(kOK);
 }
 
+/*
+ * BLOB rows
+ *
+ * All fields of a record are packed into one BLOB in the order of the table's
+ * columns. Every field is stored as a 32 bit length followed by its bytes.
+ * Fields that were never written are stored with length 0.
+ */
+
+// A view on a field value inside a packed row or a KVPair.
+typedef std::pair<const char *, uint32_t> FieldRef;
+
+/* Split a packed row into its fields. */
+static void unpack_row(const void *blob, int size, vector<FieldRef> &out) {
+    const char *pos = static_cast<const char *>(blob);
+    const char *end = pos + size;
+
+    for (auto &field : out) {
+        uint32_t len = 0;
+
+        if (end - pos < static_cast<std::ptrdiff_t>(sizeof(len)))
+            throw std::runtime_error("Truncated BLOB row");
+        memcpy(&len, pos, sizeof(len));
+        pos += sizeof(len);
+
+        if (static_cast<std::size_t>(end - pos) < len)
+            throw std::runtime_error("Truncated BLOB row");
+        field = {pos, len};
+        pos += len;
+    }
+}
+
+/* Pack all fields into a single row. */
+static void pack_row(const vector<FieldRef> &fields, string &blob) {
+    std::size_t size = 0;
+    for (auto &field : fields)
+        size += sizeof(uint32_t) + field.second;
+
+    blob.clear();
+    blob.reserve(size);
+    for (auto &field : fields) {
+        blob.append(reinterpret_cast<const char *>(&field.second),
+                    sizeof(uint32_t));
+        blob.append(field.first, field.second);
+    }
+}
+
+/* Copy the requested fields of a packed row into a KVPair vector.
+ * Strings already present in result are overwritten to reuse their memory.
+ */
+static void row_to_kvpairs(const vector<string> &cols,
+                           const vector<FieldRef> &row,
+                           const vector<string> *fields,
+                           vector<DB::KVPair> &result) {
+    std::size_t n = 0;
+
+    for (std::size_t i = 0; i < cols.size(); i++) {
+        if (fields == nullptr || fields->size() == 0 ||
+            std::find(fields->begin(), fields->end(), cols[i]) !=
+            fields->end()) {
+            if (n == result.size())
+                result.emplace_back();
+            result[n].first.assign(cols[i]);
+            result[n].second.assign(row[i].first, row[i].second);
+            n++;
+        }
+    }
+    result.resize(n);
+}
+
+int SqliteLibDB::ColumnIndex(const string &table, const string &field) const {
+    auto &cols = columns.at(table);
+    auto it = std::find(cols.begin(), cols.end(), field);
+
+    return it == cols.end() ? -1 : it - cols.begin();
+}
+
+int SqliteLibDB::ReadBlob(void *ctx_, const string &table, const string &key,
+                          const vector<string> *fields,
+                          vector<KVPair> &result) {
+    int retval = -1;                    // Return code of this function
+
+    auto &ctx = Ctx::cast(ctx_);
+    auto &cols = columns.at(table);
+
+    string stmt{"SELECT YCSBC_VALUE FROM "};
+    stmt += escape_sql(table.c_str()).get();
+    stmt += " WHERE YCSBC_KEY = ?;";
+    sqlite3_stmt *pStmt = ctx.prepare(std::move(stmt));
+
+    bind_string(pStmt, 1, key);
+
+    switch (sqlite3_step(pStmt)) {
+    case SQLITE_DONE:
+        result.clear();
+        retval = kErrorNoData;
+        break;
+    case SQLITE_ROW:
+        {
+            vector<FieldRef> row(cols.size());
+            const void *blob = sqlite3_column_blob(pStmt, 0);
+            unpack_row(blob, sqlite3_column_bytes(pStmt, 0), row);
+            row_to_kvpairs(cols, row, fields, result);
+        }
+        retval = kOK;
+        break;
+    default:
+        std::cerr << "Stepping error: " << sqlite3_errmsg(ctx.database) << std::endl;
+        throw std::runtime_error("Failed to step read statement");
+    }
+
+    check_sqlite(sqlite3_clear_bindings(pStmt));
+    check_sqlite(sqlite3_reset(pStmt));
+
+    return retval;
+}
+
+int SqliteLibDB::ScanBlob(void *ctx_, const string &table, const string &key,
+                          int len, const vector<string> *fields,
+                          vector<vector<KVPair>> &result,
+                          vector<string> *keys) {
+    int retval = kErrorNoData;          // Return code of this function
+    int db_rc  = -1;                    // Return code for DB operations
+
+    auto &ctx = Ctx::cast(ctx_);
+    auto &cols = columns.at(table);
+
+    string stmt{"SELECT YCSBC_KEY, YCSBC_VALUE FROM "};
+    stmt += escape_sql(table.c_str()).get();
+    stmt += " WHERE YCSBC_KEY >= ? ORDER BY YCSBC_KEY LIMIT ?;";
+    sqlite3_stmt *pStmt = ctx.prepare(std::move(stmt));
+
+    bind_string(pStmt, 1, key);
+    bind_int(pStmt, 2, len);
+
+    vector<FieldRef> row(cols.size());
+    std::size_t rows = 0;
+    while ((db_rc = sqlite3_step(pStmt)) != SQLITE_DONE) {
+        if (db_rc != SQLITE_ROW) {
+            std::cerr << "Stepping error: "
+                      << sqlite3_errmsg(ctx.database) << std::endl;
+            throw std::runtime_error("Failed to step scan statement");
+        }
+
+        // The blob must be fetched before its length.
+        const void *blob = sqlite3_column_blob(pStmt, 1);
+        unpack_row(blob, sqlite3_column_bytes(pStmt, 1), row);
+        if (rows == result.size())
+            result.emplace_back();
+        row_to_kvpairs(cols, row, fields, result[rows++]);
+        if (keys) {
+            // The text must be fetched before its length.
+            auto text = reinterpret_cast<const char *>(
+                sqlite3_column_text(pStmt, 0));
+            keys->emplace_back(text, sqlite3_column_bytes(pStmt, 0));
+        }
+        retval = kOK;
+    }
+    result.resize(rows);
+
+    check_sqlite(sqlite3_clear_bindings(pStmt));
+    check_sqlite(sqlite3_reset(pStmt));
+
+    return retval;
+}
+
+/* Update some fields of a record by patching its packed row.
+ *
+ * Reading and writing back the row happens in one write transaction, so
+ * concurrent updates of the same record cannot get lost.
+ */
+int SqliteLibDB::UpdateBlob(void *ctx_, const string &table, const string &key,
+                            vector<KVPair> &values) {
+    int rc = -1;                        // Return code for DB operations
+    int retval = kOK;                   // Return code of this function
+
+    auto &ctx = Ctx::cast(ctx_);
+    auto &cols = columns.at(table);
+
+    string stmt{"SELECT YCSBC_VALUE FROM "};
+    stmt += escape_sql(table.c_str()).get();
+    stmt += " WHERE YCSBC_KEY = ?;";
+    sqlite3_stmt *pSelect = ctx.prepare(std::move(stmt));
+
+    stmt = "UPDATE ";
+    stmt += escape_sql(table.c_str()).get();
+    stmt += " SET YCSBC_VALUE = ? WHERE YCSBC_KEY = ?;";
+    sqlite3_stmt *pUpdate = ctx.prepare(std::move(stmt));
+
+    // Updates inside a batch transaction are already isolated.
+    bool own_txn = !ctx.pending;
+    if (own_txn)
+        exec_sql(ctx.database, "BEGIN IMMEDIATE;");
+
+    // Roll the transaction back and leave the statements reusable if the
+    // update fails halfway.
+    try {
+        bind_string(pSelect, 1, key);
+        rc = sqlite3_step(pSelect);
+        if (rc == SQLITE_ROW) {
+            // Patch the updated fields into the old row. The references into
+            // the old row stay valid until the select statement is reset.
+            vector<FieldRef> row(cols.size());
+            const void *old = sqlite3_column_blob(pSelect, 0);
+            unpack_row(old, sqlite3_column_bytes(pSelect, 0), row);
+            for (auto &value : values) {
+                int idx = ColumnIndex(table, value.first);
+                if (idx < 0)
+                    throw std::runtime_error("Unknown field " + value.first);
+                row[idx] = {value.second.data(),
+                            static_cast<uint32_t>(value.second.size())};
+            }
+
+            string blob;
+            pack_row(row, blob);
+
+            check_sqlite(sqlite3_bind_blob(pUpdate, 1, blob.data(),
+                                           blob.size(), SQLITE_STATIC));
+            bind_string(pUpdate, 2, key);
+            do {
+                rc = sqlite3_step(pUpdate);
+                // Retry loop because concurrent readers lock us out.
+            } while (rc == SQLITE_LOCKED);
+            if (rc != SQLITE_DONE) {
+                std::cerr << "Stepping error: " << sqlite3_errmsg(ctx.database) << std::endl;
+                throw std::runtime_error("Failed to step update statement");
+            }
+
+            check_sqlite(sqlite3_clear_bindings(pUpdate));
+            check_sqlite(sqlite3_reset(pUpdate));
+        }
+        else if (rc == SQLITE_DONE) {
+            retval = kErrorNoData;
+        }
+        else {
+            std::cerr << "Stepping error: " << sqlite3_errmsg(ctx.database) << std::endl;
+            throw std::runtime_error("Failed to step update statement");
+        }
+
+        check_sqlite(sqlite3_clear_bindings(pSelect));
+        check_sqlite(sqlite3_reset(pSelect));
+
+        if (own_txn)
+            exec_sql(ctx.database, "COMMIT;");
+    } catch (...) {
+        sqlite3_reset(pSelect);
+        sqlite3_clear_bindings(pSelect);
+        sqlite3_reset(pUpdate);
+        sqlite3_clear_bindings(pUpdate);
+        if (own_txn)
+            sqlite3_exec(ctx.database, "ROLLBACK;", nullptr, nullptr, nullptr);
+        throw;
+    }
+
+    return retval;
+}
+
+int SqliteLibDB::InsertBlob(void *ctx_, const string &table, const string &key,
+                            vector<KVPair> &values) {
+    int rc = -1;                        // Return code for DB operations
+
+    auto &ctx = Ctx::cast(ctx_);
+    auto &cols = columns.at(table);
+
+    string stmt{"INSERT INTO "};
+    stmt += escape_sql(table.c_str()).get();
+    stmt += " (YCSBC_KEY, YCSBC_VALUE) VALUES (?, ?);";
+    sqlite3_stmt *pStmt = ctx.prepare(std::move(stmt));
+
+    // Fields missing from values are stored empty.
+    vector<FieldRef> row(cols.size(), FieldRef{"", 0});
+    for (auto &value : values) {
+        int idx = ColumnIndex(table, value.first);
+        if (idx < 0)
+            throw std::runtime_error("Unknown field " + value.first);
+        row[idx] = {value.second.data(),
+                    static_cast<uint32_t>(value.second.size())};
+    }
+
+    string blob;
+    pack_row(row, blob);
+
+    bind_string(pStmt, 1, key);
+    check_sqlite(sqlite3_bind_blob(pStmt, 2, blob.data(), blob.size(),
+                                   SQLITE_STATIC));
+
+    // When bulk loading, the first insert of a batch opens the transaction.
+    if (ctx.batch && !ctx.pending)
+        exec_sql(ctx.database, "BEGIN;");
+
+    do {
+        rc = sqlite3_step(pStmt);
+        // Retry loop because concurrent write operations lock others out.
+    } while (rc == SQLITE_LOCKED);
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Stepping error: " << sqlite3_errmsg(ctx.database) << std::endl;
+        throw std::runtime_error("Failed to step insert statement");
+    }
+
+    check_sqlite(sqlite3_clear_bindings(pStmt));
+    check_sqlite(sqlite3_reset(pStmt));
+
+    if (ctx.batch && ++ctx.pending == ctx.batch) {
+        exec_sql(ctx.database, "COMMIT;");
+        ctx.pending = 0;
+    }
+
+    return kOK;
+}
+
 SqliteLibDB::~SqliteLibDB() {
     check_sqlite(sqlite3_close(schema_database));
 }
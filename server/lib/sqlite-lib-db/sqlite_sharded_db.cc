@@ -0,0 +1,207 @@
+/******************************************************************************
+ *                                                                            *
+ * sqlite_sharded_db.cc - A database backend that hash-partitions the        *
+ *                        records over several independent sqlite databases.  *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "sqlite_sharded_db.h"      // Class definitions for sqlite_sharded_db
+#include "sharding.h"               // For fnv_hash and merge_sorted_rows
+
+#include <fstream>
+#include <stdexcept>
+
+using std::string;
+using std::vector;
+
+namespace ycsbc {
+
+/*
+ * Per-thread context, holding one connection (context) for every shard.
+ */
+struct ShardedCtx {
+    vector<void *> shard_ctxs{};
+
+    // Per-shard scan results, kept across scans to reuse their memory.
+    vector<vector<vector<DB::KVPair>>> rows{};
+    vector<vector<string>> keys{};
+
+    static ShardedCtx &cast(void *ctx) {
+        return *reinterpret_cast<ShardedCtx *>(ctx);
+    }
+};
+
+SqliteShardedDB::SqliteShardedDB(std::size_t nshards, const string &filename,
+                                 const SqliteLibOptions &options) {
+    if (nshards == 0)
+        throw std::invalid_argument("Need at least one shard");
+
+    for (std::size_t i = 0; i < nshards; i++) {
+        // Independent in-memory DBs must be named, otherwise all connections
+        // with cache=shared end up in the same database.
+        string shard_name;
+        if (filename == ":memory:")
+            shard_name = "file:ycsbc-shard" + std::to_string(i) +
+                         "?mode=memory&cache=shared";
+        else
+            shard_name = filename + "-shard" + std::to_string(i);
+
+        shards.emplace_back(new SqliteLibDB(shard_name, options));
+    }
+}
+
+std::size_t SqliteShardedDB::ShardOf(const string &key) const {
+    return fnv_hash(key) % shards.size();
+}
+
+void SqliteShardedDB::CreateSchema(DB::Tables tables) {
+    for (auto &shard : shards)
+        shard->CreateSchema(tables);
+}
+
+/* Open a connection to every shard for this thread. */
+void *SqliteShardedDB::Init() {
+    std::unique_ptr<ShardedCtx> ctx{new ShardedCtx{}};
+
+    ctx->shard_ctxs.reserve(shards.size());
+    for (auto &shard : shards)
+        ctx->shard_ctxs.push_back(shard->Init());
+    ctx->rows.resize(shards.size());
+    ctx->keys.resize(shards.size());
+
+    return ctx.release();
+}
+
+void SqliteShardedDB::Close(void *ctx_) {
+    auto &ctx = ShardedCtx::cast(ctx_);
+
+    for (std::size_t i = 0; i < shards.size(); i++)
+        shards[i]->Close(ctx.shard_ctxs[i]);
+
+    delete &ctx;
+}
+
+void SqliteShardedDB::BeginLoad() {
+    for (auto &shard : shards)
+        shard->BeginLoad();
+}
+
+void SqliteShardedDB::EndLoad() {
+    for (auto &shard : shards)
+        shard->EndLoad();
+}
+
+/* Write the snapshots of all shards, then the manifest describing them. */
+bool SqliteShardedDB::Snapshot(const string &path, const string &records) {
+    for (std::size_t i = 0; i < shards.size(); i++) {
+        if (!shards[i]->Snapshot(path + "." + std::to_string(i), records))
+            return false;
+    }
+
+    std::ofstream manifest(path, std::ios::trunc);
+    manifest << shards.size() << '\n' << records << '\n';
+    if (!manifest.flush())
+        throw std::runtime_error("Cannot write snapshot " + path);
+    return true;
+}
+
+/* Restore the shards after checking the manifest of the snapshot. */
+bool SqliteShardedDB::Restore(const string &path, const string &records) {
+    std::ifstream manifest(path);
+    if (!manifest)
+        throw std::runtime_error("Cannot open snapshot " + path);
+
+    std::size_t nshards = 0;
+    string stored;
+    if (!(manifest >> nshards) || !manifest.ignore() ||
+        !std::getline(manifest, stored))
+        throw std::runtime_error("Not a sharded snapshot: " + path);
+    if (nshards != shards.size())
+        throw std::runtime_error("Snapshot " + path + " has " +
+                                 std::to_string(nshards) + " shards instead of " +
+                                 std::to_string(shards.size()));
+    if (stored != records)
+        throw std::runtime_error("Snapshot " + path + " holds other records: " +
+                                 stored);
+
+    for (std::size_t i = 0; i < shards.size(); i++) {
+        if (!shards[i]->Restore(path + "." + std::to_string(i), records))
+            return false;
+    }
+    return true;
+}
+
+int SqliteShardedDB::Read(void *ctx_, const string &table, const string &key,
+                          const vector<string> *fields,
+                          vector<KVPair> &result) {
+    auto &ctx = ShardedCtx::cast(ctx_);
+    std::size_t shard = ShardOf(key);
+
+    return shards[shard]->Read(ctx.shard_ctxs[shard], table, key, fields,
+                               result);
+}
+
+int SqliteShardedDB::ReadView(void *ctx_, const string &table,
+                              const string &key, const vector<string> *fields,
+                              ResultView &result) {
+    auto &ctx = ShardedCtx::cast(ctx_);
+    std::size_t shard = ShardOf(key);
+
+    return shards[shard]->ReadView(ctx.shard_ctxs[shard], table, key, fields,
+                                   result);
+}
+
+/* Scan all shards and merge their (sorted) results by key.
+ *
+ * Each shard may hold all of the len records following key, so every shard
+ * has to be asked for len records. A shard without records following key
+ * reports kErrorNoData, which only fails the scan if all of them do. Any other
+ * error of a shard fails the whole scan.
+ */
+int SqliteShardedDB::Scan(void *ctx_, const string &table, const string &key,
+                          int len, const vector<string> *fields,
+                          vector<vector<KVPair>> &result) {
+    auto &ctx = ShardedCtx::cast(ctx_);
+    auto &rows = ctx.rows;
+    auto &keys = ctx.keys;
+
+    for (std::size_t i = 0; i < shards.size(); i++) {
+        keys[i].clear();
+        int rc = shards[i]->ScanWithKeys(ctx.shard_ctxs[i], table, key, len,
+                                         fields, rows[i], &keys[i]);
+        if (rc != kOK && rc != kErrorNoData) {
+            result.clear();
+            return rc;
+        }
+    }
+
+    std::size_t n = merge_sorted_rows(keys, rows, len, result);
+
+    return n == 0 ? kErrorNoData : kOK;
+}
+
+int SqliteShardedDB::Update(void *ctx_, const string &table, const string &key,
+                            vector<KVPair> &values) {
+    auto &ctx = ShardedCtx::cast(ctx_);
+    std::size_t shard = ShardOf(key);
+
+    return shards[shard]->Update(ctx.shard_ctxs[shard], table, key, values);
+}
+
+int SqliteShardedDB::Insert(void *ctx_, const string &table, const string &key,
+                            vector<KVPair> &values) {
+    auto &ctx = ShardedCtx::cast(ctx_);
+    std::size_t shard = ShardOf(key);
+
+    return shards[shard]->Insert(ctx.shard_ctxs[shard], table, key, values);
+}
+
+int SqliteShardedDB::Delete(void *ctx_, const string &table,
+                            const string &key) {
+    auto &ctx = ShardedCtx::cast(ctx_);
+    std::size_t shard = ShardOf(key);
+
+    return shards[shard]->Delete(ctx.shard_ctxs[shard], table, key);
+}
+
+} // ycsbc
@@ -17,10 +17,13 @@
 #include <l4/sys/scheduler>
 #include <pthread-l4.h>
 
+#include <sqlite3.h>
+
+#include "breakdown.h"
 #include "db.h"
+#include "db_host.h"
 #include "serializer.h"
 #include "sqlite_ipc_server.h" // IPC interface for this server
-#include "sqlite_lib_db.h"
 #include "utils.h"
 
 using serializer::Deserializer;
@@ -41,8 +44,10 @@ struct BenchArgs {
   L4::Cap<L4Re::Dataspace> out;
   // Location to return the create gate to.
   L4::Cap<BenchI> *gate;
-  ycsbc::SqliteLibDB *db;
+  dbhost::Host *host;
   l4_umword_t cpu;
+  // Measure the latency breakdown
+  bool timed;
 };
 
 // Implements a single benchmark thread, which performs the Read(), Scan(), etc.
@@ -60,15 +65,16 @@ class BenchServer : public L4::Epiface_t<BenchServer, BenchI> {
   L4::Cap<L4Re::Dataspace> ds_out;
   char *ds_out_addr = 0;
 
-  // SqliteLibDB object create in the main thread
-  ycsbc::SqliteLibDB *database;
+  // Connection to the database created in the main thread
+  dbhost::Session session;
 
-  // Context object returned from SqliteLibDB object
-  void *sqlite_ctx;
+  // Result of the last read or scan
+  dbhost::Result result;
 
 public:
   BenchServer(L4::Cap<L4Re::Dataspace> in, L4::Cap<L4Re::Dataspace> out,
-              ycsbc::SqliteLibDB *db) {
+              dbhost::Host &host, bool timed)
+      : session{host, timed} {
     ds_in = L4Re::Util::cap_alloc.alloc<L4Re::Dataspace>();
     L4Re::chkcap(ds_in);
 
@@ -79,8 +85,6 @@ public:
     ds_in.move(in);
     ds_out.move(out);
 
-    database = db;
-
     // Attach memory windows to this AS
     // Map new dataspaces into this AS
     if (L4Re::Env::env()->rm()->attach(&ds_in_addr, YCSBC_DS_SIZE,
@@ -95,8 +99,6 @@ public:
                                        L4::Ipc::make_cap_full(ds_out)) < 0) {
       throw std::runtime_error{"Failed to attach db_out dataspace."};
     }
-
-    sqlite_ctx = database->Init();
   }
 
   // Create a new benchmark server running its own server loop on this thread.
@@ -109,13 +111,14 @@ public:
     auto in = args->in;
     auto out = args->out;
     auto gate = args->gate;
-    auto db = args->db;
+    auto host = args->host;
     auto cpu = args->cpu;
+    auto timed = args->timed;
 
     ycsbc::migrate(cpu);
 
     // FIXME: server is never freed.
-    auto server = new BenchServer{in, out, db};
+    auto server = new BenchServer{in, out, *host, timed};
     // FIXME: Capability is never unregistered.
     L4Re::chkcap(server->registry.registry()->register_obj(server));
 
@@ -135,128 +138,146 @@ public:
 
   // Read some value from the database
   long op_read(BenchI::Rights) {
-    // Placeholder variables, will be filled from input page
-    std::string table;
-    std::string key;
-    std::vector<std::string> fields = std::vector<std::string>(0);
-
-    // Output vector, sent back to client after operation
-    std::vector<DB::KVPair> result;
+    session.begin();
 
     // Deserialize input from input dataspace
-    Deserializer d{ds_in_addr};
-
-    d >> table;
-    d >> key;
-    d >> fields;
+    Deserializer d{ds_in_addr, YCSBC_DS_SIZE};
 
-    if (database->Read(sqlite_ctx, table, key, &fields, result) != DB::kOK) {
-      return (-L4_EINVAL);
+    if (session.read(d, result) != DB::kOK) {
+      session.end(ds_out_addr);
+      return RESULT_FAILED;
     }
 
     // Put result into output dataspace
     memset(ds_out_addr, '\0', YCSBC_DS_SIZE);
-    Serializer s{ds_out_addr, YCSBC_DS_SIZE};
-    s << result;
+    Serializer s = output();
+    session.record(s, result);
 
+    session.end(ds_out_addr);
     return (L4_EOK);
   }
 
   // Scan for some values from the database
   long op_scan(BenchI::Rights) {
-    // Placeholder variables, will be filled from input page
-    std::string table;
-    std::string key;
-    int len = 0;
-    std::vector<std::string> fields = std::vector<std::string>(0);
-
-    // Output vector, sent back to client after operation
-    std::vector<std::vector<DB::KVPair>> result;
+    session.begin();
 
     // Deserialize input from input dataspace
-    Deserializer d{ds_in_addr};
-
-    d >> table;
-    d >> key;
-    d >> len;
-    d >> fields;
+    Deserializer d{ds_in_addr, YCSBC_DS_SIZE};
 
-    if (database->Scan(sqlite_ctx, table, key, len, &fields, result) !=
-        DB::kOK) {
-      return (-L4_EINVAL);
+    if (session.scan(d, result) != DB::kOK) {
+      session.end(ds_out_addr);
+      return RESULT_FAILED;
     }
 
     // Put result into output dataspace
     memset(ds_out_addr, '\0', YCSBC_DS_SIZE);
-    Serializer s{ds_out_addr, YCSBC_DS_SIZE};
-    s << result;
+    Serializer s = output();
+    session.chunk(s, result);
+
+    session.end(ds_out_addr);
+    return (L4_EOK);
+  }
+
+  // Send the next chunk of the previous scan result
+  long op_scan_next(BenchI::Rights) {
+    session.begin();
+
+    // Put result into output dataspace
+    memset(ds_out_addr, '\0', YCSBC_DS_SIZE);
+    Serializer s = output();
+    if (!session.chunk(s, result))
+      return (-L4_EINVAL);
 
+    session.end(ds_out_addr);
     return (L4_EOK);
   }
 
   // Insert a value into the database
   long op_insert(BenchI::Rights) {
-    // Placeholder variables, will be filled from input page
-    std::string table;
-    std::string key;
-    std::vector<DB::KVPair> values;
+    session.begin();
 
     // Deserialize input from input dataspace
-    Deserializer d{ds_in_addr};
+    Deserializer d{ds_in_addr, YCSBC_DS_SIZE};
+    int rc = session.insert(d);
 
-    d >> table;
-    d >> key;
-    d >> values;
-
-    if (database->Insert(sqlite_ctx, table, key, values) != DB::kOK) {
-      return (-L4_EINVAL);
-    }
-
-    return (L4_EOK);
+    session.end(ds_out_addr);
+    return status(rc);
   }
 
   // Update a value in the database
   long op_update(BenchI::Rights) {
-    // Placeholder variables, will be filled from input page
-    std::string table;
-    std::string key;
-    std::vector<DB::KVPair> values;
+    session.begin();
 
     // Deserialize input from input dataspace
-    Deserializer d{ds_in_addr};
+    Deserializer d{ds_in_addr, YCSBC_DS_SIZE};
+    int rc = session.update(d);
 
-    d >> table;
-    d >> key;
-    d >> values;
-
-    if (database->Update(sqlite_ctx, table, key, values) != DB::kOK) {
-      return (-L4_EINVAL);
-    }
-
-    return (L4_EOK);
+    session.end(ds_out_addr);
+    return status(rc);
   }
 
   // Deletes a value from the database
   long op_del(BenchI::Rights) {
-    // Placeholder variables, will be filled from input page
-    std::string table;
-    std::string key;
+    session.begin();
 
     // Deserialize input from input dataspace
-    Deserializer d{ds_in_addr};
+    Deserializer d{ds_in_addr, YCSBC_DS_SIZE};
+    int rc = session.del(d);
 
-    d >> table;
-    d >> key;
+    session.end(ds_out_addr);
+    return status(rc);
+  }
 
-    if (database->Delete(sqlite_ctx, table, key) != DB::kOK) {
-      return (-L4_EINVAL);
+  // Perform a small operation passed in the message registers
+  long op_exec(BenchI::Rights, char opcode,
+               L4::Ipc::Array_ref<char const> const &req,
+               L4::Ipc::Array_ref<char> &resp) {
+    session.begin();
+
+    // The header of the latency breakdown precedes the response.
+    std::size_t header = session.header_size();
+    Deserializer d{req.data, req.length};
+    Serializer s{resp.data + header, resp.length - header};
+    long rc = -L4_EINVAL;
+
+    switch (opcode) {
+    case 'r':
+      rc = status(session.read(d, result));
+      if (rc != L4_EOK)
+        break;
+
+      // Only send the record in the message registers if it fits, together
+      // with the flag in front of it.
+      if (session.record_size(result) < s.remaining()) {
+        s.varint(1);
+        session.record(s, result);
+      } else {
+        s.varint(0);
+        Serializer out{ds_out_addr, YCSBC_DS_SIZE};
+        session.record(out, result);
+      }
+      break;
+    case 'i':
+      rc = status(session.insert(d));
+      break;
+    case 'u':
+      rc = status(session.update(d));
+      break;
+    case 'd':
+      rc = status(session.del(d));
+      break;
     }
 
-    return (L4_EOK);
+    session.end(resp.data);
+    resp.length = header + s.length();
+    return rc;
   }
 
-  // Unmaps the client-provided memory windows
+  // Closes the database connection and unmaps the client-provided memory
+  // windows
   long op_close(BenchI::Rights) {
+    session.close();
+
     // Detach client mappings
     if (L4Re::Env::env()->rm()->detach(ds_in_addr, &ds_in) < 0) {
       std::cerr << "Failed to detach input dataspace." << std::endl;
@@ -281,14 +302,29 @@ public:
     // Never reached
     return (L4_EOK);
   }
+
+private:
+  // Serializer on the output dataspace behind the header of the latency
+  // breakdown
+  Serializer output() const {
+    std::size_t header = session.header_size();
+    return Serializer{ds_out_addr + header, YCSBC_DS_SIZE - header};
+  }
+
+  // Map the status of a database operation to an IPC return code.
+  static long status(int rc) { return rc == DB::kOK ? L4_EOK : RESULT_FAILED; }
 };
 
 // Implements the interface for the database management and a factory for new
 // benchmark threads.
 class DbServer : public L4::Epiface_t<DbServer, DbI> {
-  // YCSB SQLite backend which we are testing against.
-  // TODO: Delete when tearing down this object
-  ycsbc::SqliteLibDB *db = nullptr;
+  // Database selected by the client, which we are testing against. It is
+  // kept for the following clients if they only run transactions.
+  dbhost::Host host;
+  DB *db = nullptr;
+
+  // Measure the latency breakdown, as requested by the client
+  bool timed = false;
 
 public:
   long op_schema(DbI::Rights, L4::Ipc::Snd_fpage buf_cap) {
@@ -309,16 +345,23 @@ public:
       return (-L4_EINVAL);
     }
 
-    Deserializer d{infopage_addr};
+    Deserializer d{infopage_addr, YCSBC_DS_SIZE};
 
-    std::string fname{};
-    d >> fname;
-    db = new ycsbc::SqliteLibDB(fname);
-
-    DB::Tables tables{};
-
-    d >> tables;
-    db->CreateSchema(tables);
+    // A failed open may delete the current database.
+    db = nullptr;
+    dbhost::Params params;
+    try {
+      db = host.open(d, params);
+    } catch (std::invalid_argument const &e) {
+      std::cerr << "Client requested an invalid database: " << e.what()
+                << std::endl;
+      return (-L4_EINVAL);
+    } catch (std::exception const &e) {
+      std::cerr << "Malformed database description: " << e.what()
+                << std::endl;
+      return (-L4_EINVAL);
+    }
+    timed = breakdown::enabled(params);
 
     return L4_EOK;
   }
@@ -328,6 +371,11 @@ public:
                 l4_umword_t cpu) {
     L4::Cap<BenchI> gate;
 
+    if (!db) {
+      std::cerr << "No database created." << std::endl;
+      return (-L4_EINVAL);
+    }
+
     // Check if we actually received capabilities
     if (!in_buf.cap_received() || !out_buf.cap_received()) {
       std::cerr << "Received fpages were not capabilities." << std::endl;
@@ -344,8 +392,9 @@ public:
         .in = in,
         .out = out,
         .gate = &gate,
-        .db = db,
+        .host = &host,
         .cpu = cpu,
+        .timed = timed,
     };
     if (pthread_create(&thread, nullptr, BenchServer::loop, &args))
       throw std::runtime_error{"pthread_create failed"};
@@ -19,9 +19,12 @@
 #include <stdexcept>
 #include <thread>
 
+#include <sqlite3.h>
+
+#include "breakdown.h"
 #include "db.h"
+#include "db_host.h"
 #include "serializer.h"
-#include "sqlite_lib_db.h"
 #include "sqlite_shm_server.h" // IPC interface for this server
 #include "utils.h"
 
@@ -45,15 +48,21 @@ class BenchServer {
   L4::Cap<L4Re::Dataspace> ds_out;
   char *ds_out_addr = 0;
 
-  // SqliteLibDB object create in the main thread
-  ycsbc::SqliteLibDB *database;
+  // Connection to the database created in the main thread, shared by all
+  // operation slots
+  dbhost::Session session;
 
-  // Context object returned from SqliteLibDB object
-  void *sqlite_ctx;
+  // Number and size of the operation slots
+  std::size_t depth;
+  std::size_t slot_size;
+  // Result of the last read or scan of every slot
+  std::vector<dbhost::Result> slots;
 
 public:
   BenchServer(L4::Cap<L4Re::Dataspace> in, L4::Cap<L4Re::Dataspace> out,
-              ycsbc::SqliteLibDB *db) {
+              dbhost::Host &host, std::size_t depth, bool timed)
+      : session{host, timed}, depth{depth},
+        slot_size{shm::slot_size(depth)}, slots(depth) {
     ds_in = L4Re::Util::cap_alloc.alloc<L4Re::Dataspace>();
     L4Re::chkcap(ds_in);
 
@@ -64,8 +73,6 @@ public:
     ds_in.move(in);
     ds_out.move(out);
 
-    database = db;
-
     // Attach memory windows to this AS
     // Map new dataspaces into this AS
     if (L4Re::Env::env()->rm()->attach(&ds_in_addr, YCSBC_DS_SIZE,
@@ -80,175 +87,99 @@ public:
                                        L4::Ipc::make_cap_full(ds_out)) < 0) {
       throw std::runtime_error{"Failed to attach db_out dataspace."};
     }
-
-    sqlite_ctx = database->Init();
   }
 
   // Wait for incoming messages by busy-waiting on the first bit of the input
-  // dataspace to be non-zero.
-  // Signal a response in the same way on the output dataspace.
+  // slots to be non-zero.
+  // Signal a response in the same way on the output slot.
   void loop(l4_umword_t cpu) {
     ycsbc::migrate(cpu);
 
     for (;;) {
-      char op;
-
-      // A new message is indicated by a non-zero value in the first byte.
-      // The non-zero value actually specifies the operation to perform.
-      // I would like to use std::atomic_ref here. But it is only available
-      // since C++20.
-      // Alignment should be irrelevant here because we only access
-      // byte-granular.
-      while (!(op = __atomic_load_n(ds_in_addr, __ATOMIC_ACQUIRE))) {
-        // Use PAUSE to hint a spin-wait loop. This should use YIELD on ARM.
-        __builtin_ia32_pause();
-      }
-
-      // Create (de)serializer honoring the 1 byte used for synchronization.
-      Deserializer de{ds_in_addr + 1};
-      Serializer ser{ds_out_addr + 1, YCSBC_DS_SIZE - 1};
-      long rc = -1;
-      // Parse opcode.
-      switch (op) {
-      case 0:
-        throw std::runtime_error{"unreachable"};
-      case 'r':
-        rc = read(de, ser);
-        break;
-      case 's':
-        rc = scan(de, ser);
-        break;
-      case 'i':
-        rc = insert(de);
-        break;
-      case 'u':
-        rc = update(de);
-        break;
-      case 'd':
-        rc = del(de);
-        break;
-      case 'c':
-        // Send response before unmapping the necessary dataspace.
-        __atomic_store_n(ds_out_addr, 1, __ATOMIC_RELEASE);
-        if (close() != L4_EOK)
-          throw std::runtime_error{"failed to close BenchServer"};
-        return;
-      default:
-        throw std::runtime_error{"invalid opcode"};
+      bool idle = true;
+
+      // Serve all slots with pending messages in turn.
+      for (std::size_t i = 0; i < depth; i++) {
+        char *in_addr = ds_in_addr + i * slot_size;
+        char *out_addr = ds_out_addr + i * slot_size;
+        char op;
+
+        // A new message is indicated by a non-zero value in the first byte.
+        // The non-zero value actually specifies the operation to perform.
+        // I would like to use std::atomic_ref here. But it is only available
+        // since C++20.
+        // Alignment should be irrelevant here because we only access
+        // byte-granular.
+        if (!(op = __atomic_load_n(in_addr, __ATOMIC_ACQUIRE)))
+          continue;
+        idle = false;
+
+        if (!handle(op, slots[i], in_addr, out_addr))
+          return;
       }
 
-      if (rc != L4_EOK) {
-        throw std::runtime_error{"operation failed"};
+      if (idle) {
+        // Use PAUSE to hint a spin-wait loop. This should use YIELD on ARM.
+        __builtin_ia32_pause();
       }
-
-      // Reset notification byte.
-      *ds_in_addr = 0;
-      __atomic_store_n(ds_out_addr, 1, __ATOMIC_RELEASE);
     }
   }
 
 private:
-  // Read some value from the database
-  long read(Deserializer &d, Serializer &s) {
-    // Placeholder variables, will be filled from input page
-    std::string table;
-    std::string key;
-    std::vector<std::string> fields = std::vector<std::string>(0);
-
-    // Output vector, sent back to client after operation
-    std::vector<DB::KVPair> result;
-
-    d >> table;
-    d >> key;
-    d >> fields;
-
-    if (database->Read(sqlite_ctx, table, key, &fields, result) != DB::kOK) {
-      return (-L4_EINVAL);
-    }
-
-    // Put result into output dataspace
-    s << result;
-
-    return (L4_EOK);
-  }
-
-  // Scan for some values from the database
-  long scan(Deserializer &d, Serializer &s) {
-    // Placeholder variables, will be filled from input page
-    std::string table;
-    std::string key;
-    int len = 0;
-    std::vector<std::string> fields = std::vector<std::string>(0);
-
-    // Output vector, sent back to client after operation
-    std::vector<std::vector<DB::KVPair>> result;
-
-    d >> table;
-    d >> key;
-    d >> len;
-    d >> fields;
-
-    if (database->Scan(sqlite_ctx, table, key, len, &fields, result) !=
-        DB::kOK) {
-      return (-L4_EINVAL);
-    }
-
-    // Put result into output dataspace
-    s << result;
-
-    return (L4_EOK);
-  }
-
-  // Insert a value into the database
-  long insert(Deserializer &d) {
-    // Placeholder variables, will be filled from input page
-    std::string table;
-    std::string key;
-    std::vector<DB::KVPair> values;
-
-    d >> table;
-    d >> key;
-    d >> values;
-
-    if (database->Insert(sqlite_ctx, table, key, values) != DB::kOK) {
-      return (-L4_EINVAL);
+  // Perform the operation op of a slot and signal its completion, and whether
+  // it succeeded. Returns false if the connection was closed.
+  bool handle(char op, dbhost::Result &slot, char *in_addr, char *out_addr) {
+    session.begin();
+
+    // Create (de)serializer honoring the 1 byte used for synchronization and
+    // the header of the latency breakdown in front of the response.
+    std::size_t header = session.header_size();
+    Deserializer de{in_addr + 1, slot_size - 1};
+    Serializer ser{out_addr + 1 + header, slot_size - 1 - header};
+    bool ok = false;
+    // Parse opcode.
+    switch (op) {
+    case 'r':
+      ok = session.read(de, slot) == DB::kOK;
+      if (ok)
+        session.record(ser, slot);
+      break;
+    case 's':
+      ok = session.scan(de, slot) == DB::kOK && session.chunk(ser, slot);
+      break;
+    case 'n':
+      // Send the next chunk of the previous scan result
+      ok = session.chunk(ser, slot);
+      break;
+    case 'i':
+      ok = session.insert(de) == DB::kOK;
+      break;
+    case 'u':
+      ok = session.update(de) == DB::kOK;
+      break;
+    case 'd':
+      ok = session.del(de) == DB::kOK;
+      break;
+    case 'c':
+      // Release the database before the client may open the next one.
+      session.close();
+      // Send response before unmapping the necessary dataspace.
+      __atomic_store_n(out_addr, RESPONSE_OK, __ATOMIC_RELEASE);
+      if (close() != L4_EOK)
+        throw std::runtime_error{"failed to close BenchServer"};
+      return false;
+    default:
+      std::cerr << "Invalid opcode " << op << "." << std::endl;
+      break;
     }
 
-    return (L4_EOK);
-  }
-
-  // Update a value in the database
-  long update(Deserializer &d) {
-    // Placeholder variables, will be filled from input page
-    std::string table;
-    std::string key;
-    std::vector<DB::KVPair> values;
-
-    d >> table;
-    d >> key;
-    d >> values;
-
-    if (database->Update(sqlite_ctx, table, key, values) != DB::kOK) {
-      return (-L4_EINVAL);
-    }
-
-    return (L4_EOK);
-  }
-
-  // Deletes a value from the database
-  long del(Deserializer &d) {
-    // Placeholder variables, will be filled from input page
-    std::string table;
-    std::string key;
-
-    d >> table;
-    d >> key;
+    session.end(out_addr + 1);
 
-    if (database->Delete(sqlite_ctx, table, key) != DB::kOK) {
-      return (-L4_EINVAL);
-    }
-
-    return (L4_EOK);
+    // Reset notification byte.
+    *in_addr = 0;
+    __atomic_store_n(out_addr, ok ? RESPONSE_OK : RESPONSE_FAILED,
+                     __ATOMIC_RELEASE);
+    return true;
   }
 
   // Unmaps the client-provided memory windows and terminates the server
@@ -276,9 +207,13 @@ private:
 // Implements the interface for the database management and a factory for new
 // benchmark threads.
 class DbServer : public L4::Epiface_t<DbServer, DbI> {
-  // YCSB SQLite backend which we are testing against.
-  // TODO: Delete when tearing down this object
-  ycsbc::SqliteLibDB *db = nullptr;
+  // Database selected by the client, which we are testing against. It is
+  // kept for the following clients if they only run transactions.
+  dbhost::Host host;
+  DB *db = nullptr;
+
+  // Measure the latency breakdown, as requested by the client
+  bool timed = false;
 
 public:
   long op_schema(DbI::Rights, L4::Ipc::Snd_fpage buf_cap) {
@@ -299,34 +234,51 @@ public:
       return -L4_EINVAL;
     }
 
-    Deserializer d{infopage_addr};
-
-    std::string fname{};
-    d >> fname;
-    db = new ycsbc::SqliteLibDB(fname);
+    Deserializer d{infopage_addr, YCSBC_DS_SIZE};
 
-    DB::Tables tables{};
-
-    d >> tables;
-    db->CreateSchema(tables);
+    // A failed open may delete the current database.
+    db = nullptr;
+    dbhost::Params params;
+    try {
+      db = host.open(d, params);
+    } catch (std::invalid_argument const &e) {
+      std::cerr << "Client requested an invalid database: " << e.what()
+                << std::endl;
+      return -L4_EINVAL;
+    } catch (std::exception const &e) {
+      std::cerr << "Malformed database description: " << e.what()
+                << std::endl;
+      return -L4_EINVAL;
+    }
+    timed = breakdown::enabled(params);
 
     return L4_EOK;
   }
 
   long op_spawn(DbI::Rights, L4::Ipc::Snd_fpage in_buf,
-                L4::Ipc::Snd_fpage out_buf, l4_umword_t cpu) {
+                L4::Ipc::Snd_fpage out_buf, l4_umword_t cpu,
+                l4_umword_t depth) {
+    if (!db) {
+      std::cerr << "No database created." << std::endl;
+      return (-L4_EINVAL);
+    }
+
     // Check if we actually received capabilities
     if (!in_buf.cap_received() || !out_buf.cap_received()) {
       std::cerr << "Received fpages were not capabilities." << std::endl;
       return (-L4_EACCESS);
     }
+    if (depth == 0 || depth > MAX_QUEUE_DEPTH) {
+      std::cerr << "Invalid queue depth " << depth << "." << std::endl;
+      return (-L4_EINVAL);
+    }
 
     // Construct the memory buffer caps from the input arguments
     L4::Cap<L4Re::Dataspace> in = main_server.rcv_cap<L4Re::Dataspace>(0);
     L4::Cap<L4Re::Dataspace> out = main_server.rcv_cap<L4Re::Dataspace>(1);
 
     // FIXME: server is never freed.
-    auto server = new BenchServer{in, out, db};
+    auto server = new BenchServer{in, out, host, depth, timed};
 
     // Thread object must not be constructed on the stack.
     // FIXME: Cleanup thread object.
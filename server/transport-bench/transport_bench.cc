@@ -0,0 +1,446 @@
+/* Microbenchmark of the communication mechanisms used between the benchmark
+ * application and the database servers.
+ *
+ * A client and a server thread of this task exchange messages of a given
+ * payload size, without any database or serialization involved. The server
+ * echoes the payload. Every mechanism is measured with the threads placed on
+ * the same CPU, on neighboring CPUs and on the first and the last online CPU
+ * (which usually are on different sockets), or on explicitly given CPUs.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <l4/re/dataspace>
+#include <l4/re/env>
+#include <l4/re/error_helper>
+#include <l4/re/rm>
+#include <l4/re/util/cap_alloc>
+#include <l4/sys/ipc.h>
+#include <pthread-l4.h>
+
+#include "tsc.h"
+#include "utils.h"
+#include "vmp/spsc_queue.h"
+
+using sqlite::YCSBC_DS_SIZE;
+
+namespace tbench {
+
+// Label of the message that stops an IPC server thread
+static const long STOP_LABEL = 1;
+
+// Capacity of the request and response rings of the shm_ring mechanism
+static const std::size_t RING_SIZE = 256;
+
+// CPUs of the client and the server thread
+struct Placement {
+  std::string name;
+  l4_umword_t client;
+  l4_umword_t server;
+};
+
+struct Config {
+  // Measured round trips per mechanism, placement and payload size
+  std::size_t iterations = 100000;
+  // Round trips before measuring
+  std::size_t warmup = 1000;
+  // Messages in flight at once with shm_ring
+  std::size_t batch = 16;
+};
+
+// Latencies of all measured round trips in nanoseconds
+typedef std::vector<std::uint64_t> Samples;
+
+// Allocate a dataspace of YCSBC_DS_SIZE bytes and attach it to this task.
+static char *attach_ds() {
+  auto ds = L4Re::Util::cap_alloc.alloc<L4Re::Dataspace>();
+  L4Re::chkcap(ds);
+
+  if (L4Re::Env::env()->mem_alloc()->alloc(YCSBC_DS_SIZE, ds) < 0)
+    throw std::runtime_error{"Failed to allocate dataspace."};
+
+  char *addr = 0;
+  if (L4Re::Env::env()->rm()->attach(&addr, YCSBC_DS_SIZE,
+                                     L4Re::Rm::F::Search_addr |
+                                         L4Re::Rm::F::RW,
+                                     L4::Ipc::make_cap_rw(ds)) < 0)
+    throw std::runtime_error{"Failed to attach dataspace."};
+
+  // Fault in all pages up front.
+  memset(addr, 0, YCSBC_DS_SIZE);
+  return addr;
+}
+
+// Dataspaces for the requests and responses, shared by all runs
+struct Buffers {
+  char *in = attach_ds();
+  char *out = attach_ds();
+  // Payload sent by the client and received back
+  std::vector<char> payload = std::vector<char>(YCSBC_DS_SIZE, 'x');
+  std::vector<char> echo = std::vector<char>(YCSBC_DS_SIZE);
+};
+
+// Report the size of the payload slots of shm_ring (cache-line aligned).
+static std::size_t ring_slot_size(std::size_t size) {
+  return (std::max<std::size_t>(size, 1) + 63) & ~std::size_t{63};
+}
+
+// Report the number of messages in a batch of shm_ring.
+static std::size_t ring_batch(Config const &config, std::size_t size) {
+  return std::min(std::min(config.batch, YCSBC_DS_SIZE / ring_slot_size(size)),
+                  RING_SIZE);
+}
+
+// Measure iterations + warmup round trips, each performed by round_trip().
+static Samples measure(Config const &config,
+                       std::function<void()> const &round_trip,
+                       std::size_t iterations) {
+  ycsbc::TscClock const &clock = ycsbc::TscClock::Get();
+  Samples samples;
+  samples.reserve(iterations);
+
+  for (std::size_t i = 0; i < config.warmup; i++)
+    round_trip();
+
+  for (std::size_t i = 0; i < iterations; i++) {
+    uint64_t start = clock.Now();
+    round_trip();
+    samples.push_back(clock.Now() - start);
+  }
+  return samples;
+}
+
+/*
+ * Plain IPC call, the payload is passed in the message registers. The server
+ * thread is called through its thread capability and replies with the same
+ * message registers.
+ */
+static Samples run_ipc(Config const &config, Placement const &p,
+                       std::size_t size, Buffers &b) {
+  std::size_t words = (size + sizeof(l4_umword_t) - 1) / sizeof(l4_umword_t);
+
+  std::thread server{[&] {
+    ycsbc::migrate(p.server);
+
+    l4_umword_t label;
+    l4_msgtag_t tag = l4_ipc_wait(l4_utcb(), &label, L4_IPC_NEVER);
+    for (;;) {
+      if (l4_msgtag_has_error(tag))
+        throw std::runtime_error{"IPC server failed to receive"};
+      if (l4_msgtag_label(tag) == STOP_LABEL)
+        return;
+      tag = l4_ipc_reply_and_wait(l4_utcb(), l4_msgtag(0, words, 0, 0),
+                                  &label, L4_IPC_NEVER);
+    }
+  }};
+  l4_cap_idx_t cap = pthread_l4_cap(server.native_handle());
+
+  ycsbc::migrate(p.client);
+  Samples samples = measure(config, [&] {
+    memcpy(l4_utcb_mr()->mr, b.payload.data(), size);
+    auto tag = l4_ipc_call(cap, l4_utcb(), l4_msgtag(0, words, 0, 0),
+                           L4_IPC_NEVER);
+    if (l4_msgtag_has_error(tag))
+      throw std::runtime_error{"IPC call failed"};
+    memcpy(b.echo.data(), l4_utcb_mr()->mr, size);
+  }, config.iterations);
+
+  l4_ipc_send(cap, l4_utcb(), l4_msgtag(STOP_LABEL, 0, 0, 0), L4_IPC_NEVER);
+  server.join();
+  return samples;
+}
+
+/*
+ * IPC call with the payload in a dataspace, like the dataspace-based RPCs of
+ * the ipc server. The message registers only carry the payload size.
+ */
+static Samples run_ipc_ds(Config const &config, Placement const &p,
+                          std::size_t size, Buffers &b) {
+  std::thread server{[&] {
+    ycsbc::migrate(p.server);
+
+    l4_umword_t label;
+    l4_msgtag_t tag = l4_ipc_wait(l4_utcb(), &label, L4_IPC_NEVER);
+    for (;;) {
+      if (l4_msgtag_has_error(tag))
+        throw std::runtime_error{"IPC server failed to receive"};
+      if (l4_msgtag_label(tag) == STOP_LABEL)
+        return;
+      memcpy(b.out, b.in, l4_utcb_mr()->mr[0]);
+      tag = l4_ipc_reply_and_wait(l4_utcb(), l4_msgtag(0, 0, 0, 0), &label,
+                                  L4_IPC_NEVER);
+    }
+  }};
+  l4_cap_idx_t cap = pthread_l4_cap(server.native_handle());
+
+  ycsbc::migrate(p.client);
+  Samples samples = measure(config, [&] {
+    memcpy(b.in, b.payload.data(), size);
+    l4_utcb_mr()->mr[0] = size;
+    auto tag = l4_ipc_call(cap, l4_utcb(), l4_msgtag(0, 1, 0, 0),
+                           L4_IPC_NEVER);
+    if (l4_msgtag_has_error(tag))
+      throw std::runtime_error{"IPC call failed"};
+    memcpy(b.echo.data(), b.out, size);
+  }, config.iterations);
+
+  l4_ipc_send(cap, l4_utcb(), l4_msgtag(STOP_LABEL, 0, 0, 0), L4_IPC_NEVER);
+  server.join();
+  return samples;
+}
+
+/*
+ * Shared memory with a doorbell byte in front of the payload, like the shm
+ * server: both sides busy-wait on the first byte of their input dataspace.
+ */
+static Samples run_shm(Config const &config, Placement const &p,
+                       std::size_t size, Buffers &b) {
+  // Clear the doorbells of the previous run.
+  *b.in = 0;
+  *b.out = 0;
+
+  std::thread server{[&] {
+    ycsbc::migrate(p.server);
+
+    for (;;) {
+      char op;
+      while (!(op = __atomic_load_n(b.in, __ATOMIC_ACQUIRE)))
+        __builtin_ia32_pause();
+      if (op == 2)
+        return;
+
+      memcpy(b.out + 1, b.in + 1, size);
+      *b.in = 0;
+      __atomic_store_n(b.out, 1, __ATOMIC_RELEASE);
+    }
+  }};
+
+  ycsbc::migrate(p.client);
+  Samples samples = measure(config, [&] {
+    memcpy(b.in + 1, b.payload.data(), size);
+    __atomic_store_n(b.in, 1, __ATOMIC_RELEASE);
+    while (!__atomic_load_n(b.out, __ATOMIC_ACQUIRE))
+      __builtin_ia32_pause();
+    memcpy(b.echo.data(), b.out + 1, size);
+    *b.out = 0;
+  }, config.iterations);
+
+  __atomic_store_n(b.in, 2, __ATOMIC_RELEASE);
+  server.join();
+  return samples;
+}
+
+/*
+ * Shared memory with a ring of requests and a ring of responses. The client
+ * sends a batch of messages before collecting their responses, every message
+ * with its payload in a slot of its own. A round trip is a whole batch.
+ */
+static Samples run_shm_ring(Config const &config, Placement const &p,
+                            std::size_t size, Buffers &b) {
+  typedef vmp::SpscQueue<std::uint32_t, RING_SIZE> Ring;
+  const std::uint32_t stop = UINT32_MAX;
+
+  std::size_t slot_size = ring_slot_size(size);
+  std::size_t batch = ring_batch(config, size);
+
+  std::unique_ptr<Ring> requests{new Ring};
+  std::unique_ptr<Ring> responses{new Ring};
+
+  std::thread server{[&] {
+    ycsbc::migrate(p.server);
+
+    for (;;) {
+      std::uint32_t slot;
+      while (!requests->Pop(slot))
+        __builtin_ia32_pause();
+      if (slot == stop)
+        return;
+
+      memcpy(b.out + slot * slot_size, b.in + slot * slot_size, size);
+      // Cannot fail, at most batch responses are outstanding.
+      responses->Push(slot);
+    }
+  }};
+
+  ycsbc::migrate(p.client);
+  Samples samples = measure(config, [&] {
+    for (std::uint32_t i = 0; i < batch; i++) {
+      memcpy(b.in + i * slot_size, b.payload.data(), size);
+      requests->Push(i);
+    }
+    for (std::size_t i = 0; i < batch; i++) {
+      std::uint32_t slot;
+      while (!responses->Pop(slot))
+        __builtin_ia32_pause();
+      memcpy(b.echo.data(), b.out + slot * slot_size, size);
+    }
+  }, (config.iterations + batch - 1) / batch);
+
+  requests->Push(stop);
+  server.join();
+  return samples;
+}
+
+// Print the statistics of a run as one tab-separated line.
+static void report(std::string const &mechanism, Placement const &p,
+                   std::size_t size, std::size_t batch, Samples &samples) {
+  std::sort(samples.begin(), samples.end());
+
+  std::uint64_t total = 0;
+  for (auto s : samples)
+    total += s;
+
+  std::size_t n = samples.size();
+  double mean = n ? double(total) / n : 0;
+  double ops_per_sec = total ? n * batch * 1e9 / total : 0;
+
+  std::cout << mechanism << '\t' << p.name << '\t' << p.client << '\t'
+            << p.server << '\t' << size << '\t' << batch << '\t' << n * batch
+            << '\t' << mean << '\t' << (n ? samples[n / 2] : 0) << '\t'
+            << (n ? samples[n * 99 / 100] : 0) << '\t'
+            << (n ? samples[n - 1] : 0) << '\t' << ops_per_sec << std::endl;
+}
+
+static std::vector<std::string> split(std::string const &list) {
+  std::vector<std::string> items;
+  std::stringstream ss{list};
+  std::string item;
+  while (std::getline(ss, item, ','))
+    items.push_back(item);
+  return items;
+}
+
+} // namespace tbench
+
+using namespace tbench;
+
+static void usage(char const *command) {
+  std::cout << "Usage: " << command << " [options]" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -n iterations: round trips per run (default: 100000)"
+            << std::endl;
+  std::cout << "  -sizes list: payload sizes in bytes"
+            << " (default: 8,64,256,4096,65536)" << std::endl;
+  std::cout << "  -batch n: messages per batch of shm_ring (default: 16)"
+            << std::endl;
+  std::cout << "  -mechanisms list: any of ipc,ipc_ds,shm,shm_ring"
+            << " (default: all)" << std::endl;
+  std::cout << "  -placements list: any of same,near,far (default: all)"
+            << std::endl;
+  std::cout << "  -pair client:server: also run with the threads on these CPUs"
+            << std::endl;
+}
+
+int main(int argc, char const *argv[]) {
+  Config config;
+  std::vector<std::size_t> sizes{8, 64, 256, 4096, 65536};
+  std::vector<std::string> mechanisms{"ipc", "ipc_ds", "shm", "shm_ring"};
+  std::vector<std::string> placement_names{"same", "near", "far"};
+  std::vector<Placement> pairs;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    std::string value = argv[++i];
+
+    if (arg == "-n") {
+      config.iterations = std::stoul(value);
+    } else if (arg == "-sizes") {
+      sizes.clear();
+      for (auto &s : split(value))
+        sizes.push_back(std::stoul(s));
+    } else if (arg == "-batch") {
+      config.batch = std::max<std::size_t>(std::stoul(value), 1);
+    } else if (arg == "-mechanisms") {
+      mechanisms = split(value);
+    } else if (arg == "-placements") {
+      placement_names = split(value);
+    } else if (arg == "-pair") {
+      auto colon = value.find(':');
+      if (colon == std::string::npos) {
+        usage(argv[0]);
+        return 1;
+      }
+      pairs.push_back(Placement{value, std::stoul(value.substr(0, colon)),
+                                std::stoul(value.substr(colon + 1))});
+    } else {
+      std::cout << "Unknown option '" << arg << "'" << std::endl;
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  auto cpus = ycsbc::online_cpus();
+  std::vector<Placement> placements;
+  for (auto &name : placement_names) {
+    if (name == "same") {
+      placements.push_back(Placement{name, cpus[0], cpus[0]});
+    } else if (name == "near" && cpus.size() > 1) {
+      placements.push_back(Placement{name, cpus[0], cpus[1]});
+    } else if (name == "far" && cpus.size() > 2) {
+      placements.push_back(Placement{name, cpus[0], cpus.back()});
+    } else if (name != "near" && name != "far") {
+      std::cout << "Unknown placement '" << name << "'" << std::endl;
+      return 1;
+    }
+  }
+  placements.insert(placements.end(), pairs.begin(), pairs.end());
+
+  Buffers buffers;
+
+  std::cout << "mechanism\tplacement\tclient_cpu\tserver_cpu\tpayload\tbatch"
+            << "\tops\tmean_ns\tp50_ns\tp99_ns\tmax_ns\tops_per_sec"
+            << std::endl;
+
+  for (auto &mechanism : mechanisms) {
+    for (auto &p : placements) {
+      // Spinning threads would only preempt each other.
+      if (p.client == p.server && mechanism.compare(0, 3, "shm") == 0)
+        continue;
+
+      for (auto size : sizes) {
+        // The doorbell byte takes one byte of the dataspace.
+        if (size >= YCSBC_DS_SIZE)
+          continue;
+
+        Samples samples;
+        std::size_t batch = 1;
+
+        if (mechanism == "ipc") {
+          if (size > L4_UTCB_GENERIC_DATA_SIZE * sizeof(l4_umword_t))
+            continue;
+          samples = run_ipc(config, p, size, buffers);
+        } else if (mechanism == "ipc_ds") {
+          samples = run_ipc_ds(config, p, size, buffers);
+        } else if (mechanism == "shm") {
+          samples = run_shm(config, p, size, buffers);
+        } else if (mechanism == "shm_ring") {
+          batch = ring_batch(config, size);
+          samples = run_shm_ring(config, p, size, buffers);
+        } else {
+          std::cout << "Unknown mechanism '" << mechanism << "'" << std::endl;
+          return 1;
+        }
+
+        report(mechanism, p, size, batch, samples);
+      }
+    }
+  }
+
+  return 0;
+}
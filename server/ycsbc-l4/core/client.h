@@ -10,133 +10,392 @@
 #ifndef YCSB_C_CLIENT_H_
 #define YCSB_C_CLIENT_H_
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <string>
 #include "db.h"
 #include "core_workload.h"
+#include "measurements.h"
+#include "trace.h"
+#include "tsc.h"
 #include "utils.h"
 
 namespace ycsbc {
 
 class Client {
  public:
-  Client(DB &db, CoreWorkload &wl, void *ctx) : db_(db), workload_(wl), ctx_{ctx} { }
+  // If measurements is set, the count, status and latency of every
+  // operation is reported to it. If progress is set, it counts the
+  // operations performed, so that other threads can watch the progress.
+  // The random numbers of the workload are drawn from state, see
+  // CoreWorkload::NewThreadState().
+  Client(DB &db, CoreWorkload &wl, void *ctx,
+         const CoreWorkload::ThreadState &state, bool result_views = false,
+         std::size_t queue_depth = 1, Measurements *measurements = nullptr,
+         std::atomic<uint64_t> *progress = nullptr)
+      : db_(db), workload_(wl), ctx_{ctx}, state_(state),
+        result_views_{result_views},
+        queue_depth_{queue_depth}, measurements_{measurements},
+        progress_{progress}, clock_(TscClock::Get()) { }
   
   virtual bool DoInsert();
+  virtual bool DoInsert(uint64_t key_num);
   virtual bool DoTransaction();
+  // Perform num_ops transactions through the asynchronous DB interface, with
+  // up to queue_depth operations in flight. Returns the number of successful
+  // transactions.
+  virtual int DoTransactionsAsync(int num_ops);
+
+  // Append every transaction drawn from the workload to ops.
+  void RecordTrace(std::vector<TraceOp> *ops) { record_ = ops; }
+  // Perform the count transactions of a trace instead of drawing them from
+  // the workload.
+  void ReplayTrace(const TraceOp *ops, std::size_t count) {
+    replay_ = ops;
+    replay_end_ = ops + count;
+  }
   
   virtual ~Client() { }
   
  protected:
   
-  virtual int TransactionRead();
-  virtual int TransactionReadModifyWrite();
-  virtual int TransactionScan();
-  virtual int TransactionUpdate();
-  virtual int TransactionInsert();
+  virtual int TransactionRead(const TraceOp &op);
+  virtual int TransactionReadModifyWrite(const TraceOp &op);
+  virtual int TransactionScan(const TraceOp &op);
+  virtual int TransactionUpdate(const TraceOp &op);
+  virtual int TransactionInsert(const TraceOp &op);
+
+  // Draw the next transaction from the workload, or take it from the trace
+  // replayed.
+  TraceOp NextOp();
+  // Report the fields to read or scan for op.
+  const std::vector<std::string> *Fields(const TraceOp &op);
+  // Build the values written by op.
+  void BuildValues(const TraceOp &op, std::vector<DB::KVPair> &values);
+
+  // Read/scan into the result buffers selected by result_views_.
+  int Read(const std::string &table, const std::string &key,
+           const std::vector<std::string> *fields);
+  int Scan(const std::string &table, const std::string &key, int len,
+           const std::vector<std::string> *fields);
   
   DB &db_;
   CoreWorkload &workload_;
   void *ctx_;
+  CoreWorkload::ThreadState state_;
+
+  // Result buffers reused across operations to avoid reallocations
+  std::vector<DB::KVPair> read_result_;
+  std::vector<std::vector<DB::KVPair>> scan_result_;
+
+  // Use the (zero-copy) view interface of the DB for reads and scans
+  bool result_views_;
+  ResultView result_view_;
+
+  // A transaction in flight on the asynchronous interface
+  struct ClientOp : AsyncOp {
+    // Read of a read-modify-write, the update still has to follow
+    bool rmw_read = false;
+    // Transaction of the workload and the time it was submitted
+    Operation operation = ycsbc::READ;
+    uint64_t start = 0;
+    // Everything drawn for the transaction
+    TraceOp trace{};
+  };
+
+  // Fill op with the next transaction of the workload.
+  void PrepareOp(ClientOp &op);
+
+  // Maximum number of asynchronous operations in flight
+  std::size_t queue_depth_;
+  std::vector<std::unique_ptr<ClientOp>> ops_;
+  // Operations completed since the last Poll()
+  std::vector<ClientOp *> completed_;
+
+  // Report an operation started at start (see Now()) to measurements_.
+  uint64_t Now() const { return measurements_ ? clock_.Now() : 0; }
+  void Measure(Operation op, int status, uint64_t start) {
+    if (measurements_)
+      measurements_->Report(op, status == DB::kOK, clock_.Now() - start);
+    // Only this thread writes the counter, no need for an atomic increment.
+    if (progress_)
+      progress_->store(progress_->load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+  }
+
+  Measurements *measurements_;
+  std::atomic<uint64_t> *progress_;
+  const TscClock &clock_;
+
+  // Trace recorded or replayed, if any
+  std::vector<TraceOp> *record_ = nullptr;
+  const TraceOp *replay_ = nullptr;
+  const TraceOp *replay_end_ = nullptr;
+  // Field selected for reads and scans
+  std::vector<std::string> fields_;
 };
 
 inline bool Client::DoInsert() {
   std::string key = workload_.NextSequenceKey();
   std::vector<DB::KVPair> pairs;
-  workload_.BuildValues(pairs);
+  workload_.BuildValues(pairs, state_);
   return (db_.Insert(ctx_, workload_.NextTable(), key, pairs) == DB::kOK);
 }
 
+inline bool Client::DoInsert(uint64_t key_num) {
+  std::string key = workload_.SequenceKey(key_num);
+  std::vector<DB::KVPair> pairs;
+  workload_.BuildValues(pairs, state_);
+  uint64_t start = Now();
+  int status = db_.Insert(ctx_, workload_.NextTable(), key, pairs);
+  Measure(INSERT, status, start);
+  return (status == DB::kOK);
+}
+
 inline bool Client::DoTransaction() {
   int status = -1;
-  switch (workload_.NextOperation()) {
+  TraceOp op = NextOp();
+  Operation operation = static_cast<Operation>(op.operation);
+  uint64_t start = Now();
+  switch (operation) {
     case READ:
-      status = TransactionRead();
+      status = TransactionRead(op);
       break;
     case UPDATE:
-      status = TransactionUpdate();
+      status = TransactionUpdate(op);
       break;
     case INSERT:
-      status = TransactionInsert();
+      status = TransactionInsert(op);
       break;
     case SCAN:
-      status = TransactionScan();
+      status = TransactionScan(op);
       break;
     case READMODIFYWRITE:
-      status = TransactionReadModifyWrite();
+      status = TransactionReadModifyWrite(op);
       break;
     default:
       throw utils::Exception("Operation request is not recognized!");
   }
   assert(status >= 0);
+  Measure(operation, status, start);
   return (status == DB::kOK);
 }
 
-inline int Client::TransactionRead() {
-  const std::string &table = workload_.NextTable();
-  const std::string &key = workload_.NextTransactionKey();
-  std::vector<DB::KVPair> result;
-  if (!workload_.read_all_fields()) {
-    std::vector<std::string> fields;
-    fields.push_back("field" + workload_.NextFieldName());
-    return db_.Read(ctx_, table, key, &fields, result);
+inline TraceOp Client::NextOp() {
+  if (replay_) {
+    if (replay_ == replay_end_)
+      throw utils::Exception("Trace exhausted");
+    const TraceOp &op = *replay_++;
+    // Reject fields the workload has no names for.
+    int fields = workload_.field_count();
+    if ((op.field != TraceOp::kAllFields && op.field >= fields) ||
+        (op.write_field != TraceOp::kAllFields && op.write_field >= fields))
+      throw utils::Exception("Trace field out of range");
+    return op;
+  }
+
+  TraceOp op{};
+  op.field = op.write_field = TraceOp::kAllFields;
+  Operation operation = workload_.NextOperation(state_);
+  op.operation = operation;
+  if (operation == INSERT) {
+    op.key = workload_.NextSequenceKeyNum();
   } else {
-    return db_.Read(ctx_, table, key, NULL, result);
+    op.key = workload_.NextTransactionKeyNum(state_);
+  }
+
+  if ((operation == READ || operation == SCAN ||
+       operation == READMODIFYWRITE) && !workload_.read_all_fields()) {
+    op.field = workload_.NextFieldNum(state_);
+  }
+  if (operation == SCAN) {
+    op.length = workload_.NextScanLength(state_);
   }
+  if ((operation == UPDATE || operation == READMODIFYWRITE) &&
+      !workload_.write_all_fields()) {
+    op.write_field = workload_.NextFieldNum(state_);
+  }
+
+  if (record_) {
+    if (workload_.field_count() >= TraceOp::kAllFields)
+      throw utils::Exception("Too many fields for a trace");
+    // All values written get the same length, as when replaying the trace.
+    if (operation != READ && operation != SCAN)
+      op.length = workload_.NextFieldLength(state_);
+    record_->push_back(op);
+  }
+  return op;
 }
 
-inline int Client::TransactionReadModifyWrite() {
-  const std::string &table = workload_.NextTable();
-  const std::string &key = workload_.NextTransactionKey();
-  std::vector<DB::KVPair> result;
+inline const std::vector<std::string> *Client::Fields(const TraceOp &op) {
+  if (op.field == TraceOp::kAllFields)
+    return NULL;
+  fields_.assign(1, workload_.FieldName(op.field));
+  return &fields_;
+}
 
-  if (!workload_.read_all_fields()) {
-    std::vector<std::string> fields;
-    fields.push_back("field" + workload_.NextFieldName());
-    db_.Read(ctx_, table, key, &fields, result);
-  } else {
-    db_.Read(ctx_, table, key, NULL, result);
+inline void Client::BuildValues(const TraceOp &op,
+                                std::vector<DB::KVPair> &values) {
+  // Without a trace, the length of every value is drawn on its own.
+  bool traced = record_ || replay_;
+  auto add = [&](uint64_t field) {
+    size_t length = traced ? op.length : workload_.NextFieldLength(state_);
+    values.emplace_back(workload_.FieldName(field),
+                        std::string(length, state_.value.NextPrintChar()));
+  };
+
+  if (op.write_field != TraceOp::kAllFields) {
+    add(op.write_field);
+    return;
   }
+  for (int i = 0; i < workload_.field_count(); ++i) {
+    add(i);
+  }
+}
 
-  std::vector<DB::KVPair> values;
-  if (workload_.write_all_fields()) {
-    workload_.BuildValues(values);
-  } else {
-    workload_.BuildUpdate(values);
+inline int Client::Read(const std::string &table, const std::string &key,
+                        const std::vector<std::string> *fields) {
+  if (result_views_)
+    return db_.ReadView(ctx_, table, key, fields, result_view_);
+  return db_.Read(ctx_, table, key, fields, read_result_);
+}
+
+inline int Client::Scan(const std::string &table, const std::string &key,
+                        int len, const std::vector<std::string> *fields) {
+  if (result_views_)
+    return db_.ScanView(ctx_, table, key, len, fields, result_view_);
+  return db_.Scan(ctx_, table, key, len, fields, scan_result_);
+}
+
+inline void Client::PrepareOp(ClientOp &op) {
+  op.table = workload_.NextTable();
+  op.fields.clear();
+  op.values.clear();
+  op.rmw_read = false;
+
+  TraceOp next = NextOp();
+  Operation operation = static_cast<Operation>(next.operation);
+  op.operation = operation;
+  op.trace = next;
+  op.key = workload_.SequenceKey(next.key);
+  switch (operation) {
+    case INSERT:
+      op.type = AsyncOp::INSERT;
+      BuildValues(next, op.values);
+      return;
+    case READ:
+    case READMODIFYWRITE:
+      op.type = AsyncOp::READ;
+      op.rmw_read = (operation == READMODIFYWRITE);
+      break;
+    case SCAN:
+      op.type = AsyncOp::SCAN;
+      op.record_count = next.length;
+      break;
+    case UPDATE:
+      op.type = AsyncOp::UPDATE;
+      BuildValues(next, op.values);
+      return;
+    default:
+      throw utils::Exception("Operation request is not recognized!");
+  }
+
+  if (next.field != TraceOp::kAllFields) {
+    op.fields.push_back(workload_.FieldName(next.field));
+  }
+}
+
+inline int Client::DoTransactionsAsync(int num_ops) {
+  std::size_t depth = std::min(queue_depth_, db_.QueueDepth(ctx_));
+  std::vector<ClientOp *> idle;
+  std::vector<ClientOp *> done;
+
+  if (depth == 0)
+    depth = 1;
+  while (ops_.size() < depth) {
+    ops_.emplace_back(new ClientOp{});
+    ClientOp *op = ops_.back().get();
+    op->callback = [this, op](AsyncOp &) { completed_.push_back(op); };
   }
+  for (std::size_t i = 0; i < depth; i++)
+    idle.push_back(ops_[i].get());
+
+  int submitted = 0;
+  int oks = 0;
+  while (submitted < num_ops || idle.size() < depth) {
+    // Fill the queue.
+    while (submitted < num_ops && !idle.empty()) {
+      ClientOp *op = idle.back();
+      idle.pop_back();
+      PrepareOp(*op);
+      submitted++;
+      op->start = Now();
+      db_.Submit(ctx_, *op);
+    }
+
+    if (completed_.empty())
+      db_.Poll(ctx_, true);
+
+    // Callbacks may append to completed_ while the completions are handled.
+    done.swap(completed_);
+    for (ClientOp *op : done) {
+      if (op->rmw_read) {
+        // Like TransactionReadModifyWrite(), the update ignores the result of
+        // the read.
+        op->rmw_read = false;
+        op->type = AsyncOp::UPDATE;
+        op->fields.clear();
+        BuildValues(op->trace, op->values);
+        db_.Submit(ctx_, *op);
+        continue;
+      }
+
+      Measure(op->operation, op->status, op->start);
+      oks += (op->status == DB::kOK);
+      idle.push_back(op);
+    }
+    done.clear();
+  }
+
+  return oks;
+}
+
+inline int Client::TransactionRead(const TraceOp &op) {
+  const std::string &table = workload_.NextTable();
+  const std::string &key = workload_.SequenceKey(op.key);
+  return Read(table, key, Fields(op));
+}
+
+inline int Client::TransactionReadModifyWrite(const TraceOp &op) {
+  const std::string &table = workload_.NextTable();
+  const std::string &key = workload_.SequenceKey(op.key);
+  Read(table, key, Fields(op));
+
+  std::vector<DB::KVPair> values;
+  BuildValues(op, values);
   return db_.Update(ctx_, table, key, values);
 }
 
-inline int Client::TransactionScan() {
+inline int Client::TransactionScan(const TraceOp &op) {
   const std::string &table = workload_.NextTable();
-  const std::string &key = workload_.NextTransactionKey();
-  int len = workload_.NextScanLength();
-  std::vector<std::vector<DB::KVPair>> result;
-  if (!workload_.read_all_fields()) {
-    std::vector<std::string> fields;
-    fields.push_back("field" + workload_.NextFieldName());
-    return db_.Scan(ctx_, table, key, len, &fields, result);
-  } else {
-    return db_.Scan(ctx_, table, key, len, NULL, result);
-  }
+  const std::string &key = workload_.SequenceKey(op.key);
+  return Scan(table, key, op.length, Fields(op));
 }
 
-inline int Client::TransactionUpdate() {
+inline int Client::TransactionUpdate(const TraceOp &op) {
   const std::string &table = workload_.NextTable();
-  const std::string &key = workload_.NextTransactionKey();
+  const std::string &key = workload_.SequenceKey(op.key);
   std::vector<DB::KVPair> values;
-  if (workload_.write_all_fields()) {
-    workload_.BuildValues(values);
-  } else {
-    workload_.BuildUpdate(values);
-  }
+  BuildValues(op, values);
   return db_.Update(ctx_, table, key, values);
 }
 
-inline int Client::TransactionInsert() {
+inline int Client::TransactionInsert(const TraceOp &op) {
   const std::string &table = workload_.NextTable();
-  const std::string &key = workload_.NextSequenceKey();
+  const std::string &key = workload_.SequenceKey(op.key);
   std::vector<DB::KVPair> values;
-  workload_.BuildValues(values);
+  BuildValues(op, values);
   return db_.Insert(ctx_, table, key, values);
 } 
 
@@ -17,7 +17,7 @@ namespace ycsbc {
 class ConstGenerator : public Generator<uint64_t> {
  public:
   ConstGenerator(int constant) : constant_(constant) { }
-  uint64_t Next() { return constant_; }
+  uint64_t Next(Random &) { return constant_; }
   uint64_t Last() { return constant_; }
  private:
   uint64_t constant_;
@@ -79,6 +79,9 @@ const string CoreWorkload::INSERT_START_DEFAULT = "0";
 const string CoreWorkload::RECORD_COUNT_PROPERTY = "recordcount";
 const string CoreWorkload::OPERATION_COUNT_PROPERTY = "operationcount";
 
+const string CoreWorkload::SEED_PROPERTY = "seed";
+const string CoreWorkload::SEED_DEFAULT = "0";
+
 void CoreWorkload::Init(const utils::Properties &p) {
   table_name_ = p.GetProperty(TABLENAME_PROPERTY,TABLENAME_DEFAULT);
   
@@ -107,6 +110,7 @@ void CoreWorkload::Init(const utils::Properties &p) {
                                             SCAN_LENGTH_DISTRIBUTION_DEFAULT);
   int insert_start = std::stoi(p.GetProperty(INSERT_START_PROPERTY,
                                              INSERT_START_DEFAULT));
+  seed_ = std::stoull(p.GetProperty(SEED_PROPERTY, SEED_DEFAULT), nullptr, 0);
   
   read_all_fields_ = utils::StrToBool(p.GetProperty(READ_ALL_FIELDS_PROPERTY,
                                                     READ_ALL_FIELDS_DEFAULT));
@@ -119,6 +123,7 @@ void CoreWorkload::Init(const utils::Properties &p) {
     ordered_inserts_ = true;
   }
   
+  insert_start_ = insert_start;
   key_generator_ = new CounterGenerator(insert_start);
   
   if (read_proportion > 0) {
@@ -199,19 +204,21 @@ ycsbc::Generator<uint64_t> *CoreWorkload::GetFieldLenGenerator(
   }
 }
 
-void CoreWorkload::BuildValues(std::vector<ycsbc::DB::KVPair> &values) {
+void CoreWorkload::BuildValues(std::vector<ycsbc::DB::KVPair> &values,
+                               ThreadState &state) {
   for (int i = 0; i < field_count_; ++i) {
     ycsbc::DB::KVPair pair;
     pair.first.append("field").append(std::to_string(i));
-    pair.second.append(field_len_generator_->Next(), utils::RandomPrintChar());
+    pair.second.append(NextFieldLength(state), state.value.NextPrintChar());
     values.push_back(pair);
   }
 }
 
-void CoreWorkload::BuildUpdate(std::vector<ycsbc::DB::KVPair> &update) {
+void CoreWorkload::BuildUpdate(std::vector<ycsbc::DB::KVPair> &update,
+                               ThreadState &state) {
   ycsbc::DB::KVPair pair;
-  pair.first.append(NextFieldName());
-  pair.second.append(field_len_generator_->Next(), utils::RandomPrintChar());
+  pair.first.append(NextFieldName(state));
+  pair.second.append(NextFieldLength(state), state.value.NextPrintChar());
   update.push_back(pair);
 }
 
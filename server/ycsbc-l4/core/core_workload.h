@@ -17,6 +17,7 @@
 #include "generator.h"
 #include "discrete_generator.h"
 #include "counter_generator.h"
+#include "random.h"
 #include "utils.h"
 
 namespace ycsbc {
@@ -141,6 +142,32 @@ class CoreWorkload {
   static const std::string RECORD_COUNT_PROPERTY;
   static const std::string OPERATION_COUNT_PROPERTY;
 
+  ///
+  /// The name of the property for the seed that all random numbers of the
+  /// workload are derived from.
+  ///
+  static const std::string SEED_PROPERTY;
+  static const std::string SEED_DEFAULT;
+
+  ///
+  /// Random state of a client thread: one independent stream per generator,
+  /// so that the numbers drawn for one purpose do not shift those drawn for
+  /// another, e.g., when reading all fields instead of one.
+  ///
+  struct ThreadState {
+    explicit ThreadState(const Random &rng) :
+        operation(rng.Split(0)), key(rng.Split(1)), field(rng.Split(2)),
+        field_length(rng.Split(3)), scan_length(rng.Split(4)),
+        value(rng.Split(5)) { }
+
+    Random operation;
+    Random key;
+    Random field;
+    Random field_length;
+    Random scan_length;
+    Random value;
+  };
+
   ///
   /// Initialize the scenario.
   /// Called once, in the main client thread, before any operations are started.
@@ -148,16 +175,62 @@ class CoreWorkload {
   virtual void Init(const utils::Properties &p);
   /// Returns used table names with their columns.
   virtual DB::Tables Tables() const;
+
+  ///
+  /// Returns the random state of client thread number thread in the load
+  /// phase or in the transaction phase. It only depends on the seed, the
+  /// phase and the thread number. The keys of inserted records are not part
+  /// of it, they come from a counter shared by all threads.
+  ///
+  ThreadState NewThreadState(bool loading, uint64_t thread) const {
+    return ThreadState(Random(seed_).Split(loading ? 0 : 1).Split(thread));
+  }
   
-  virtual void BuildValues(std::vector<ycsbc::DB::KVPair> &values);
-  virtual void BuildUpdate(std::vector<ycsbc::DB::KVPair> &update);
+  virtual void BuildValues(std::vector<ycsbc::DB::KVPair> &values,
+                           ThreadState &state);
+  virtual void BuildUpdate(std::vector<ycsbc::DB::KVPair> &update,
+                           ThreadState &state);
   
   virtual std::string NextTable() { return table_name_; }
   virtual std::string NextSequenceKey(); /// Used for loading data
-  virtual std::string NextTransactionKey(); /// Used for transactions
-  virtual Operation NextOperation() { return op_chooser_.Next(); }
-  virtual std::string NextFieldName();
-  virtual size_t NextScanLength() { return scan_len_chooser_->Next(); }
+  
+  ///
+  /// Returns the key for the record with sequence number key_num.
+  /// Used for loading disjoint key ranges from several threads. Afterwards,
+  /// SkipSequenceKeys() must be called with the number of records loaded.
+  ///
+  std::string SequenceKey(uint64_t key_num) { return BuildKeyName(key_num); }
+  void SkipSequenceKeys(uint64_t count) {
+    key_generator_->Set(key_generator_->Last() + 1 + count);
+  }
+  uint64_t insert_start() const { return insert_start_; }
+  
+  /// Used for transactions
+  virtual std::string NextTransactionKey(ThreadState &state);
+  virtual Operation NextOperation(ThreadState &state) {
+    return op_chooser_.Next(state.operation);
+  }
+  virtual std::string NextFieldName(ThreadState &state);
+  virtual size_t NextScanLength(ThreadState &state) {
+    return scan_len_chooser_->Next(state.scan_length);
+  }
+
+  ///
+  /// The numbers drawn for the keys, fields and value lengths, so that
+  /// transactions can be recorded and replayed (see trace.h).
+  ///
+  uint64_t NextSequenceKeyNum() { return key_generator_->Next(); }
+  uint64_t NextTransactionKeyNum(ThreadState &state);
+  uint64_t NextFieldNum(ThreadState &state) {
+    return field_chooser_->Next(state.field);
+  }
+  uint64_t NextFieldLength(ThreadState &state) {
+    return field_len_generator_->Next(state.field_length);
+  }
+  std::string FieldName(uint64_t field_num) {
+    return std::string("field").append(std::to_string(field_num));
+  }
+  int field_count() const { return field_count_; }
   
   bool read_all_fields() const { return read_all_fields_; }
   bool write_all_fields() const { return write_all_fields_; }
@@ -166,7 +239,7 @@ class CoreWorkload {
       field_count_(0), read_all_fields_(false), write_all_fields_(false),
       field_len_generator_(NULL), key_generator_(NULL), key_chooser_(NULL),
       field_chooser_(NULL), scan_len_chooser_(NULL), insert_key_sequence_(3),
-      ordered_inserts_(true), record_count_(0) {
+      ordered_inserts_(true), record_count_(0), insert_start_(0), seed_(0) {
   }
   
   virtual ~CoreWorkload() {
@@ -186,7 +259,7 @@ class CoreWorkload {
   bool read_all_fields_;
   bool write_all_fields_;
   Generator<uint64_t> *field_len_generator_;
-  Generator<uint64_t> *key_generator_;
+  CounterGenerator *key_generator_;
   DiscreteGenerator<Operation> op_chooser_;
   Generator<uint64_t> *key_chooser_;
   Generator<uint64_t> *field_chooser_;
@@ -194,7 +267,9 @@ class CoreWorkload {
   CounterGenerator insert_key_sequence_;
   bool ordered_inserts_;
   size_t record_count_;
+  uint64_t insert_start_;
   int zero_padding_;
+  uint64_t seed_;
 };
 
 inline std::string CoreWorkload::NextSequenceKey() {
@@ -202,12 +277,16 @@ inline std::string CoreWorkload::NextSequenceKey() {
   return BuildKeyName(key_num);
 }
 
-inline std::string CoreWorkload::NextTransactionKey() {
+inline uint64_t CoreWorkload::NextTransactionKeyNum(ThreadState &state) {
   uint64_t key_num;
   do {
-    key_num = key_chooser_->Next();
+    key_num = key_chooser_->Next(state.key);
   } while (key_num > insert_key_sequence_.Last());
-  return BuildKeyName(key_num);
+  return key_num;
+}
+
+inline std::string CoreWorkload::NextTransactionKey(ThreadState &state) {
+  return BuildKeyName(NextTransactionKeyNum(state));
 }
 
 inline std::string CoreWorkload::BuildKeyName(uint64_t key_num) {
@@ -220,8 +299,8 @@ inline std::string CoreWorkload::BuildKeyName(uint64_t key_num) {
   return std::string("user").append(zeros, '0').append(key_num_str);
 }
 
-inline std::string CoreWorkload::NextFieldName() {
-  return std::string("field").append(std::to_string(field_chooser_->Next()));
+inline std::string CoreWorkload::NextFieldName(ThreadState &state) {
+  return FieldName(NextFieldNum(state));
 }
   
 } // ycsbc
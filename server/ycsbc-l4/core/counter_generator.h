@@ -20,6 +20,7 @@ class CounterGenerator : public Generator<uint64_t> {
  public:
   CounterGenerator(uint64_t start) : counter_(start) { }
   uint64_t Next() { return counter_.fetch_add(1); }
+  uint64_t Next(Random &) { return Next(); }
   uint64_t Last() { return counter_.load() - 1; }
   void Set(uint64_t start) { counter_.store(start); }
  private:
@@ -13,7 +13,6 @@
 
 #include <atomic>
 #include <cassert>
-#include <mutex>
 #include <vector>
 #include "utils.h"
 
@@ -25,14 +24,13 @@ class DiscreteGenerator : public Generator<Value> {
   DiscreteGenerator() : sum_(0) { }
   void AddValue(Value value, double weight);
 
-  Value Next();
+  Value Next(Random &rng);
   Value Last() { return last_; }
 
  private:
   std::vector<std::pair<Value, double>> values_;
   double sum_;
   std::atomic<Value> last_;
-  std::mutex mutex_;
 };
 
 template <typename Value>
@@ -45,10 +43,8 @@ inline void DiscreteGenerator<Value>::AddValue(Value value, double weight) {
 }
 
 template <typename Value>
-inline Value DiscreteGenerator<Value>::Next() {
-  mutex_.lock();
-  double chooser = utils::RandomDouble();
-  mutex_.unlock();
+inline Value DiscreteGenerator<Value>::Next(Random &rng) {
+  double chooser = rng.NextDouble();
   
   for (auto p = values_.cbegin(); p != values_.cend(); ++p) {
     if (chooser < p->second / sum_) {
@@ -11,13 +11,19 @@
 
 #include <cstdint>
 #include <string>
+#include "random.h"
 
 namespace ycsbc {
 
+///
+/// Generators hold no random state of their own: every call to Next() draws
+/// from the stream passed by the caller, so that each thread draws from its
+/// own streams and the values are reproducible.
+///
 template <typename Value>
 class Generator {
  public:
-  virtual Value Next() = 0;
+  virtual Value Next(Random &rng) = 0;
   virtual Value Last() = 0;
   virtual ~Generator() { }
 };
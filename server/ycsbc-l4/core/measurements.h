@@ -0,0 +1,76 @@
+//
+//  measurements.h
+//  YCSB-C
+//
+//  Counts and latencies of the operations of a benchmark phase.
+//
+
+#ifndef YCSB_C_MEASUREMENTS_H_
+#define YCSB_C_MEASUREMENTS_H_
+
+#include <cstdint>
+#include "core_workload.h"
+#include "histogram.h"
+
+namespace ycsbc {
+
+inline const char *OperationName(Operation op) {
+  switch (op) {
+    case INSERT: return "INSERT";
+    case READ: return "READ";
+    case UPDATE: return "UPDATE";
+    case SCAN: return "SCAN";
+    case READMODIFYWRITE: return "READMODIFYWRITE";
+  }
+  return "UNKNOWN";
+}
+
+// Number of operations, failed operations and the latency distribution (in
+// nanoseconds) per operation type. Every client thread fills its own object;
+// the objects of all threads are merged afterwards.
+class Measurements {
+ public:
+  static const int kOperations = READMODIFYWRITE + 1;
+
+  struct Stats {
+    uint64_t count = 0;
+    uint64_t errors = 0;
+    Histogram latency;
+  };
+
+  void Report(Operation op, bool ok, uint64_t latency_ns) {
+    Stats &s = stats_[op];
+    s.count++;
+    s.errors += !ok;
+    s.latency.Add(latency_ns);
+  }
+
+  void Merge(const Measurements &other) {
+    for (int i = 0; i < kOperations; i++) {
+      stats_[i].count += other.stats_[i].count;
+      stats_[i].errors += other.stats_[i].errors;
+      stats_[i].latency.Merge(other.stats_[i].latency);
+    }
+  }
+
+  const Stats &Get(Operation op) const { return stats_[op]; }
+
+  // Totals over all operation types
+  uint64_t Count() const {
+    uint64_t n = 0;
+    for (auto &s : stats_) n += s.count;
+    return n;
+  }
+  uint64_t Errors() const {
+    uint64_t n = 0;
+    for (auto &s : stats_) n += s.errors;
+    return n;
+  }
+
+ private:
+  Stats stats_[kOperations];
+};
+
+} // ycsbc
+
+#endif // YCSB_C_MEASUREMENTS_H_
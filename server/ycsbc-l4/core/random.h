@@ -0,0 +1,77 @@
+//
+//  random.h
+//  YCSB-C
+//
+//  Splittable pseudo-random number generator for reproducible workloads.
+//
+
+#ifndef YCSB_C_RANDOM_H_
+#define YCSB_C_RANDOM_H_
+
+#include <cstdint>
+
+namespace ycsbc {
+
+///
+/// SplitMix64: a fast generator whose state is a single word, so that
+/// independent streams can be derived from a seed for every thread and
+/// generator with Split(). Not thread-safe; every thread uses its own
+/// streams. Satisfies UniformRandomBitGenerator.
+///
+class Random {
+ public:
+  typedef uint64_t result_type;
+
+  explicit Random(uint64_t seed = 0) : state_(seed) { }
+
+  ///
+  /// Returns the stream number stream derived from this one. The stream
+  /// returned does not depend on the numbers drawn from this one before.
+  ///
+  Random Split(uint64_t stream) const {
+    return Random(Mix(state_ ^ Mix(stream + kGamma)));
+  }
+
+  uint64_t Next() { return Mix(state_ += kGamma); }
+
+  /// Returns a double in [0, 1).
+  double NextDouble() { return (Next() >> 11) * (1.0 / (UINT64_C(1) << 53)); }
+
+  /// Returns an integer in [min, max], both inclusive, without modulo bias.
+  uint64_t NextUniform(uint64_t min, uint64_t max);
+
+  /// Returns an ASCII code that can be printed to display.
+  char NextPrintChar() { return Next() % 94 + 33; }
+
+  uint64_t operator()() { return Next(); }
+  static constexpr uint64_t min() { return 0; }
+  static constexpr uint64_t max() { return UINT64_MAX; }
+
+ private:
+  static const uint64_t kGamma = UINT64_C(0x9E3779B97F4A7C15);
+
+  static uint64_t Mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+  }
+
+  uint64_t state_;
+};
+
+inline uint64_t Random::NextUniform(uint64_t min, uint64_t max) {
+  uint64_t range = max - min;
+  if (range == UINT64_MAX) return Next();
+  // Reject the values above the largest multiple of range + 1.
+  uint64_t n = range + 1;
+  uint64_t limit = UINT64_MAX - UINT64_MAX % n;
+  uint64_t value;
+  do {
+    value = Next();
+  } while (value >= limit);
+  return min + value % n;
+}
+
+} // ycsbc
+
+#endif // YCSB_C_RANDOM_H_
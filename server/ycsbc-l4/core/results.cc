@@ -0,0 +1,260 @@
+//
+//  results.cc
+//  YCSB-C
+//
+//  Machine-readable results of a benchmark run.
+//
+
+#include "results.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "tsc.h"
+
+using std::ostream;
+using std::string;
+
+namespace ycsbc {
+
+namespace {
+
+// Percentiles reported for every distribution, with their key suffix
+const std::pair<double, const char *> kPercentiles[] = {
+    {50, "p50"}, {90, "p90"}, {99, "p99"}, {99.9, "p999"}};
+
+string JsonString(const string &s) {
+  std::ostringstream out;
+  out << '"';
+  for (char c : s) {
+    switch (c) {
+      case '"': out << "\\\""; break;
+      case '\\': out << "\\\\"; break;
+      case '\n': out << "\\n"; break;
+      case '\t': out << "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+              << static_cast<int>(c) << std::dec;
+        } else {
+          out << c;
+        }
+    }
+  }
+  out << '"';
+  return out.str();
+}
+
+// Quote a CSV field if necessary.
+string CsvString(const string &s) {
+  if (s.find_first_of(",\"\n") == string::npos) return s;
+  string out = "\"";
+  for (char c : s) {
+    if (c == '"') out += '"';
+    out += c;
+  }
+  return out + '"';
+}
+
+// Escape semicolons and backslashes in a key or value of CsvProperties() with
+// a backslash, since values like that of "sweep" contain semicolons.
+string EscapeProperty(const string &s) {
+  string out;
+  for (char c : s) {
+    if (c == ';' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+// All properties as key=value pairs separated by semicolons
+string CsvProperties(const Results &results) {
+  string out;
+  if (!results.props) return out;
+  for (auto &p : results.props->properties()) {
+    if (!out.empty()) out += ';';
+    out += EscapeProperty(p.first) + '=' + EscapeProperty(p.second);
+  }
+  return out;
+}
+
+// CPUs of the client and the database thread as client:db, separated by
+// semicolons
+string CsvPlacement(const Results &results) {
+  string out;
+  for (auto &p : results.placement) {
+    if (!out.empty()) out += ';';
+    out += std::to_string(p.first) + ':' + std::to_string(p.second);
+  }
+  return out;
+}
+
+// Operations per second of a phase
+double Throughput(const Results::Phase &phase) {
+  if (phase.duration_ns == 0) return 0;
+  return phase.measurements.Count() * 1e9 / phase.duration_ns;
+}
+
+void JsonHistogram(ostream &os, const Histogram &h, const char *unit) {
+  os << "{\"mean_" << unit << "\":" << h.Mean()
+     << ",\"min_" << unit << "\":" << h.Min();
+  for (auto &p : kPercentiles) {
+    os << ",\"" << p.second << '_' << unit << "\":" << h.Percentile(p.first);
+  }
+  os << ",\"max_" << unit << "\":" << h.Max() << '}';
+}
+
+void JsonPhase(ostream &os, const Results::Phase &phase) {
+  const Measurements &m = phase.measurements;
+  os << "{\"name\":" << JsonString(phase.name)
+     << ",\"duration_ns\":" << phase.duration_ns
+     << ",\"operations\":" << m.Count()
+     << ",\"errors\":" << m.Errors()
+     << ",\"throughput_ops\":" << Throughput(phase)
+     << ",\"threads\":[";
+  for (std::size_t i = 0; i < phase.threads.size(); i++) {
+    os << (i ? "," : "") << "{\"operations\":" << phase.threads[i].operations
+       << ",\"errors\":" << phase.threads[i].errors << '}';
+  }
+  os << "],\"latency\":{";
+  bool first = true;
+  for (int i = 0; i < Measurements::kOperations; i++) {
+    Operation op = static_cast<Operation>(i);
+    const Measurements::Stats &s = m.Get(op);
+    if (s.count == 0) continue;
+    os << (first ? "" : ",") << JsonString(OperationName(op))
+       << ":{\"count\":" << s.count << ",\"errors\":" << s.errors
+       << ",\"latency\":";
+    JsonHistogram(os, s.latency, "ns");
+    os << '}';
+    first = false;
+  }
+  os << "}}";
+}
+
+} // namespace
+
+void WriteJson(ostream &os, const Results &results) {
+  const TscClock &clock = TscClock::Get();
+
+  os << std::fixed << std::setprecision(1);
+  os << "{\"workload\":" << JsonString(results.workload_file)
+     << ",\"allocator\":" << JsonString(results.allocator)
+     << ",\"clock\":{\"source\":"
+     << (clock.Fallback() ? "\"steady_clock\"" : "\"cycle_counter\"")
+     << ",\"frequency_hz\":" << clock.Frequency() << '}';
+
+  os << ",\"properties\":{";
+  if (results.props) {
+    bool first = true;
+    for (auto &p : results.props->properties()) {
+      os << (first ? "" : ",") << JsonString(p.first) << ':'
+         << JsonString(p.second);
+      first = false;
+    }
+  }
+  os << '}';
+
+  os << ",\"placement\":[";
+  for (std::size_t i = 0; i < results.placement.size(); i++) {
+    os << (i ? "," : "") << "{\"thread\":" << i
+       << ",\"client_cpu\":" << results.placement[i].first
+       << ",\"db_cpu\":" << results.placement[i].second << '}';
+  }
+  os << ']';
+
+  os << ",\"repetition\":" << results.repetition;
+
+  os << ",\"phases\":[";
+  for (std::size_t i = 0; i < results.phases.size(); i++) {
+    os << (i ? "," : "");
+    JsonPhase(os, results.phases[i]);
+  }
+  os << ']';
+
+  if (results.breakdown) {
+    os << ",\"breakdown\":{";
+    for (std::size_t i = 0; i < breakdown::STAGES; i++) {
+      breakdown::Stage stage = static_cast<breakdown::Stage>(i);
+      os << (i ? "," : "") << JsonString(breakdown::stage_name(stage)) << ':';
+      JsonHistogram(os, (*results.breakdown)[stage], "cycles");
+    }
+    os << '}';
+  }
+
+  os << '}' << std::endl;
+}
+
+void WriteCsv(ostream &os, const Results &results, bool header) {
+  string dbname, threads;
+  if (results.props) {
+    dbname = results.props->GetProperty("dbname", "basic");
+    threads = results.props->GetProperty("threadcount", "1");
+  }
+  string placement = CsvString(CsvPlacement(results));
+  string properties = CsvString(CsvProperties(results));
+
+  if (header) {
+    os << "dbname,workload,threads,allocator,phase,duration_ns,throughput_ops,"
+          "operation,count,errors,mean_ns,min_ns";
+    for (auto &p : kPercentiles) os << ',' << p.second << "_ns";
+    os << ",max_ns,repetition,placement,properties" << std::endl;
+  }
+
+  os << std::fixed << std::setprecision(1);
+  for (auto &phase : results.phases) {
+    for (int i = 0; i < Measurements::kOperations; i++) {
+      Operation op = static_cast<Operation>(i);
+      const Measurements::Stats &s = phase.measurements.Get(op);
+      if (s.count == 0) continue;
+      os << CsvString(dbname) << ',' << CsvString(results.workload_file) << ','
+         << threads << ',' << CsvString(results.allocator) << ','
+         << CsvString(phase.name) << ',' << phase.duration_ns << ','
+         << Throughput(phase) << ',' << OperationName(op) << ',' << s.count
+         << ',' << s.errors << ',' << s.latency.Mean() << ','
+         << s.latency.Min();
+      for (auto &p : kPercentiles) os << ',' << s.latency.Percentile(p.first);
+      os << ',' << s.latency.Max() << ',' << results.repetition << ','
+         << placement << ',' << properties << std::endl;
+    }
+  }
+}
+
+void WriteResults(const Results &results) {
+  string file = results.props->GetProperty("results.file");
+  string format = results.props->GetProperty("results.format", "json");
+  if (file.empty()) return;
+  if (format != "json" && format != "csv") {
+    throw utils::Exception("Unknown results format: " + format);
+  }
+
+  // Only start a new file, or the output on stdout, with the header row.
+  static bool stdout_header = true;
+  bool header = true;
+  std::ofstream out;
+  if (file == "-") {
+    header = stdout_header;
+    if (format == "csv") stdout_header = false;
+  } else {
+    std::ifstream existing(file, std::ios::ate);
+    header = !existing || existing.tellg() == 0;
+    out.open(file, std::ios::app);
+    if (!out) throw utils::Exception("Cannot open results file: " + file);
+  }
+  ostream &os = file == "-" ? std::cout : out;
+
+  // Keep the formatting of the stream.
+  std::ios::fmtflags flags = os.flags();
+  std::streamsize precision = os.precision();
+  if (format == "json") {
+    WriteJson(os, results);
+  } else {
+    WriteCsv(os, results, header);
+  }
+  os.flags(flags);
+  os.precision(precision);
+}
+
+} // ycsbc
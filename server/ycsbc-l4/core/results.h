@@ -0,0 +1,71 @@
+//
+//  results.h
+//  YCSB-C
+//
+//  Machine-readable results of a benchmark run.
+//
+
+#ifndef YCSB_C_RESULTS_H_
+#define YCSB_C_RESULTS_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <l4/sys/types.h>
+
+#include "breakdown.h"
+#include "measurements.h"
+#include "properties.h"
+
+namespace ycsbc {
+
+// Everything known about a benchmark run: its configuration, where its
+// threads ran, and the measurements of its phases.
+struct Results {
+  struct Phase {
+    std::string name;
+    uint64_t duration_ns = 0;
+    Measurements measurements;
+    // Operations performed and failed, per client thread
+    struct Thread {
+      uint64_t operations;
+      uint64_t errors;
+    };
+    std::vector<Thread> threads;
+  };
+
+  const utils::Properties *props = nullptr;
+  std::string workload_file;
+  std::string allocator;
+  // CPUs of the client thread and of its database thread, per client thread
+  std::vector<std::pair<l4_umword_t, l4_umword_t>> placement;
+  std::vector<Phase> phases;
+  // Repetition of the transaction phase of the same configuration
+  std::size_t repetition = 0;
+  // Latency breakdown of the run phase, if recorded by the database
+  const breakdown::Stages *breakdown = nullptr;
+};
+
+// Write results as a single line holding one JSON object, so that results of
+// several runs can be appended to the same file or stream.
+void WriteJson(std::ostream &os, const Results &results);
+
+// Write results as CSV, one row per phase and operation type. The placement
+// and all properties are given in one column each, as semicolon-separated
+// lists, with semicolons and backslashes in the properties escaped by a
+// backslash. The latency breakdown is only part of the JSON results, because its
+// stages do not fit the rows of operations. The header row is only written if
+// header is set.
+void WriteCsv(std::ostream &os, const Results &results, bool header);
+
+// Write results as selected by the properties "results.file" (a path, "-"
+// for stdout, nothing written if unset) and "results.format" ("json" or
+// "csv"). Results are appended to existing files.
+void WriteResults(const Results &results);
+
+} // ycsbc
+
+#endif // YCSB_C_RESULTS_H_
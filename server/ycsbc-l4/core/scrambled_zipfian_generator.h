@@ -28,7 +28,7 @@ class ScrambledZipfianGenerator : public Generator<uint64_t> {
   ScrambledZipfianGenerator(uint64_t num_items) :
       ScrambledZipfianGenerator(0, num_items - 1) { }
   
-  uint64_t Next();
+  uint64_t Next(Random &rng);
   uint64_t Last();
   
  private:
@@ -43,8 +43,8 @@ inline uint64_t ScrambledZipfianGenerator::Scramble(uint64_t value) const {
   return base_ + utils::FNVHash64(value) % num_items_;
 }
 
-inline uint64_t ScrambledZipfianGenerator::Next() {
-  return Scramble(generator_.Next());
+inline uint64_t ScrambledZipfianGenerator::Next(Random &rng) {
+  return Scramble(generator_.Next(rng));
 }
 
 inline uint64_t ScrambledZipfianGenerator::Last() {
@@ -21,11 +21,9 @@ namespace ycsbc {
 class SkewedLatestGenerator : public Generator<uint64_t> {
  public:
   SkewedLatestGenerator(CounterGenerator &counter) :
-      basis_(counter), zipfian_(basis_.Last()) {
-    Next();
-  }
+      basis_(counter), zipfian_(basis_.Last()), last_(basis_.Last()) { }
   
-  uint64_t Next();
+  uint64_t Next(Random &rng);
   uint64_t Last() { return last_; }
  private:
   CounterGenerator &basis_;
@@ -33,9 +31,9 @@ class SkewedLatestGenerator : public Generator<uint64_t> {
   std::atomic<uint64_t> last_;
 };
 
-inline uint64_t SkewedLatestGenerator::Next() {
+inline uint64_t SkewedLatestGenerator::Next(Random &rng) {
   uint64_t max = basis_.Last();
-  return last_ = max - zipfian_.Next(max);
+  return last_ = max - zipfian_.Next(rng, max);
 }
 
 } // ycsbc
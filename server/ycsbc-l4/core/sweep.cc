@@ -0,0 +1,130 @@
+//
+//  sweep.cc
+//  YCSB-C
+//
+//  Parameter sweeps over several benchmark configurations.
+//
+
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <sstream>
+
+#include "core_workload.h"
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+namespace ycsbc {
+
+vector<SweepPoint> ParseSweep(const string &spec) {
+  vector<SweepPoint> points(1);
+
+  std::istringstream dimensions(spec);
+  string dimension;
+  while (std::getline(dimensions, dimension, ';')) {
+    if (utils::Trim(dimension).empty()) continue;
+
+    size_t pos = dimension.find('=');
+    if (pos == string::npos) {
+      throw utils::Exception("Sweep dimension without values: " + dimension);
+    }
+    string key = utils::Trim(dimension.substr(0, pos));
+    if (key == "threads") key = "threadcount";
+    if (key == "db") key = "dbname";
+
+    vector<string> values;
+    std::istringstream list(dimension.substr(pos + 1));
+    string value;
+    while (std::getline(list, value, ',')) {
+      values.push_back(utils::Trim(value));
+    }
+    if (key.empty() || values.empty()) {
+      throw utils::Exception("Malformed sweep dimension: " + dimension);
+    }
+
+    // Every point so far is combined with every value of this key.
+    vector<SweepPoint> product;
+    for (auto &point : points) {
+      for (auto &v : values) {
+        product.push_back(point);
+        product.back().emplace_back(key, v);
+      }
+    }
+    points.swap(product);
+  }
+  return points;
+}
+
+bool IsRunProperty(const string &key, const utils::Properties &props) {
+  const string dbname = props.GetProperty("dbname", "basic");
+  const bool server = dbname == "sqlite_ipc" || dbname == "sqlite_shm";
+  if (key == "queuedepth") return !server;
+  if (key == "threadcount") {
+    const string db =
+        server ? props.GetProperty("server.db", "sqlite_lib") : dbname;
+    if (db == "partitioned") {
+      return !props.GetProperty("partitioned.shards").empty();
+    }
+    if (db == "sqlite_sharded") {
+      return !props.GetProperty("sqlite.shards").empty();
+    }
+  }
+
+  static const std::set<string> run_properties = {
+      CoreWorkload::READ_ALL_FIELDS_PROPERTY,
+      CoreWorkload::WRITE_ALL_FIELDS_PROPERTY,
+      CoreWorkload::READ_PROPORTION_PROPERTY,
+      CoreWorkload::UPDATE_PROPORTION_PROPERTY,
+      CoreWorkload::SCAN_PROPORTION_PROPERTY,
+      CoreWorkload::READMODIFYWRITE_PROPORTION_PROPERTY,
+      CoreWorkload::REQUEST_DISTRIBUTION_PROPERTY,
+      CoreWorkload::MAX_SCAN_LENGTH_PROPERTY,
+      CoreWorkload::SCAN_LENGTH_DISTRIBUTION_PROPERTY,
+      CoreWorkload::OPERATION_COUNT_PROPERTY,
+      "threadcount", "result-views", "migrate-rr", "avoid-boot-cpu",
+      "disperse", "placement", "progress", "trace.record", "trace.replay"};
+  return run_properties.count(key) > 0;
+}
+
+SweepPoint LoadProperties(const SweepPoint &point,
+                          const utils::Properties &props) {
+  SweepPoint load;
+  for (auto &p : point) {
+    if (!IsRunProperty(p.first, props)) load.push_back(p);
+  }
+  return load;
+}
+
+Summary Summarize(const vector<double> &samples) {
+  // Two-sided 97.5% quantiles of Student's t-distribution for 1 to 30
+  // degrees of freedom
+  static const double t975[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+  Summary s;
+  s.n = samples.size();
+  if (s.n == 0) return s;
+
+  s.min = *std::min_element(samples.begin(), samples.end());
+  s.max = *std::max_element(samples.begin(), samples.end());
+  for (double x : samples) s.mean += x;
+  s.mean /= s.n;
+  if (s.n == 1) return s;
+
+  double squares = 0;
+  for (double x : samples) squares += (x - s.mean) * (x - s.mean);
+  s.stddev = std::sqrt(squares / (s.n - 1));
+
+  size_t df = s.n - 1;
+  double t = df <= 30 ? t975[df - 1] : 1.960;
+  s.ci95 = t * s.stddev / std::sqrt(static_cast<double>(s.n));
+  return s;
+}
+
+} // ycsbc
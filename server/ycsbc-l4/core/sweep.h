@@ -0,0 +1,59 @@
+//
+//  sweep.h
+//  YCSB-C
+//
+//  Parameter sweeps over several benchmark configurations.
+//
+
+#ifndef YCSB_C_SWEEP_H_
+#define YCSB_C_SWEEP_H_
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "properties.h"
+
+namespace ycsbc {
+
+// Properties set for one configuration of a sweep
+typedef std::vector<std::pair<std::string, std::string>> SweepPoint;
+
+// Parses a sweep specification of the form "key=v1,v2;key2=v3,v4" into the
+// cartesian product of all values, the first key varying slowest. The keys
+// "threads" and "db" are accepted for "threadcount" and "dbname" like on the
+// command line. An empty specification yields a single point without any
+// properties. Throws utils::Exception for malformed specifications.
+std::vector<SweepPoint> ParseSweep(const std::string &spec);
+
+// Reports whether a property only affects the transaction phase of the
+// configuration props, so that the database loaded for one value can be reused
+// for another. The thread count is not if the database (or the one behind the
+// database server) is sharded without an explicit number of shards, which then
+// defaults to the thread count. The queue depth is not for the database
+// servers, whose clients fix it when they are created.
+bool IsRunProperty(const std::string &key, const utils::Properties &props);
+
+// The properties of point that affect loading the database of the
+// configuration props, which includes the properties of point, in their order
+// in point
+SweepPoint LoadProperties(const SweepPoint &point,
+                          const utils::Properties &props);
+
+// Mean of repeated measurements with a 95% confidence interval
+struct Summary {
+  std::size_t n = 0;
+  double mean = 0;
+  double stddev = 0;
+  // Half width of the confidence interval (Student's t-distribution)
+  double ci95 = 0;
+  double min = 0;
+  double max = 0;
+};
+
+Summary Summarize(const std::vector<double> &samples);
+
+} // ycsbc
+
+#endif // YCSB_C_SWEEP_H_
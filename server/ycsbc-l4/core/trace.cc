@@ -0,0 +1,110 @@
+//
+//  trace.cc
+//  YCSB-C
+//
+//  Recorded transactions for replaying exactly the same operations.
+//
+
+#include "trace.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+namespace ycsbc {
+
+namespace {
+
+const char kTraceMagic[8] = {'Y', 'C', 'S', 'B', 'T', 'R', 'C', '2'};
+
+// Magic, number of threads and length of the description of the records,
+// followed by the description (padded to 8 bytes), the number of transactions
+// of every thread and their transactions, thread by thread
+struct TraceHeader {
+  char magic[8];
+  uint64_t threads;
+  uint64_t records;
+};
+
+// Length of the description of the records in the file, which keeps the
+// counts and transactions following it aligned
+uint64_t Padded(uint64_t length) {
+  return (length + 7) & ~uint64_t{7};
+}
+
+} // namespace
+
+void WriteTrace(const string &path, const string &records,
+                const vector<vector<TraceOp>> &threads) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw utils::Exception("Cannot create trace " + path);
+
+  TraceHeader header;
+  memcpy(header.magic, kTraceMagic, sizeof(header.magic));
+  header.threads = threads.size();
+  header.records = records.size();
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  string padded = records;
+  padded.resize(Padded(records.size()), '\0');
+  out.write(padded.data(), padded.size());
+  for (auto &ops : threads) {
+    uint64_t count = ops.size();
+    out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  }
+  for (auto &ops : threads) {
+    out.write(reinterpret_cast<const char *>(ops.data()),
+              ops.size() * sizeof(TraceOp));
+  }
+  if (!out.flush()) throw utils::Exception("Cannot write trace " + path);
+}
+
+TraceReader::TraceReader(const string &path) : map_(MAP_FAILED), size_(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw utils::Exception("Cannot open trace " + path);
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    size_ = st.st_size;
+    map_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (map_ == MAP_FAILED) throw utils::Exception("Cannot map trace " + path);
+
+  const char *data = static_cast<const char *>(map_);
+  const TraceHeader *header = reinterpret_cast<const TraceHeader *>(data);
+  size_t offset = sizeof(TraceHeader);
+  if (size_ < offset || memcmp(header->magic, kTraceMagic, 8) != 0 ||
+      (size_ - offset) / sizeof(uint64_t) <
+          Padded(header->records) / sizeof(uint64_t) + header->threads) {
+    munmap(map_, size_);
+    throw utils::Exception("Not a trace: " + path);
+  }
+  records_.assign(data + offset, header->records);
+  offset += Padded(header->records);
+
+  const uint64_t *counts = reinterpret_cast<const uint64_t *>(data + offset);
+  offset += header->threads * sizeof(uint64_t);
+  for (uint64_t t = 0; t < header->threads; ++t) {
+    if ((size_ - offset) / sizeof(TraceOp) < counts[t]) {
+      munmap(map_, size_);
+      throw utils::Exception("Truncated trace: " + path);
+    }
+    ops_.push_back(reinterpret_cast<const TraceOp *>(data + offset));
+    counts_.push_back(counts[t]);
+    offset += counts[t] * sizeof(TraceOp);
+  }
+}
+
+TraceReader::~TraceReader() {
+  munmap(map_, size_);
+}
+
+} // ycsbc
@@ -0,0 +1,66 @@
+//
+//  trace.h
+//  YCSB-C
+//
+//  Recorded transactions for replaying exactly the same operations.
+//
+
+#ifndef YCSB_C_TRACE_H_
+#define YCSB_C_TRACE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ycsbc {
+
+// A transaction of a trace: everything the workload draws for it. The keys,
+// field names and values are built from it as by the workload, except that
+// all values written by one operation have the same length.
+struct TraceOp {
+  static const uint8_t kAllFields = 0xff;
+
+  uint64_t key;         // Key number (see CoreWorkload::SequenceKey())
+  uint32_t length;      // Scan length, or length of the values written
+  uint8_t field;        // Field read or scanned, or kAllFields
+  uint8_t write_field;  // Field updated or inserted, or kAllFields
+  uint8_t operation;    // Operation
+  uint8_t reserved;
+};
+
+static_assert(sizeof(TraceOp) == 16, "TraceOp must be packed");
+
+// Write the transactions of every client thread to a trace file. records
+// describes the records the keys refer to, e.g., their count.
+void WriteTrace(const std::string &path, const std::string &records,
+                const std::vector<std::vector<TraceOp>> &threads);
+
+// A trace file mapped into memory.
+class TraceReader {
+ public:
+  // Throws utils::Exception if the file cannot be mapped or is no trace.
+  explicit TraceReader(const std::string &path);
+  ~TraceReader();
+
+  TraceReader(const TraceReader &) = delete;
+  TraceReader &operator=(const TraceReader &) = delete;
+
+  // Description of the records, as passed to WriteTrace()
+  const std::string &Records() const { return records_; }
+  std::size_t Threads() const { return ops_.size(); }
+  // Transactions of client thread t
+  const TraceOp *Ops(std::size_t t) const { return ops_[t]; }
+  uint64_t Count(std::size_t t) const { return counts_[t]; }
+
+ private:
+  void *map_;
+  std::size_t size_;
+  std::string records_;
+  std::vector<const TraceOp *> ops_;
+  std::vector<uint64_t> counts_;
+};
+
+} // ycsbc
+
+#endif // YCSB_C_TRACE_H_
@@ -12,34 +12,26 @@
 #include "generator.h"
 
 #include <atomic>
-#include <mutex>
-#include <random>
 
 namespace ycsbc {
 
 class UniformGenerator : public Generator<uint64_t> {
  public:
   // Both min and max are inclusive
-  UniformGenerator(uint64_t min, uint64_t max) : dist_(min, max) { Next(); }
+  UniformGenerator(uint64_t min, uint64_t max) :
+      min_(min), max_(max), last_int_(min) { }
   
-  uint64_t Next();
-  uint64_t Last();
+  uint64_t Next(Random &rng);
+  uint64_t Last() { return last_int_; }
   
  private:
-  std::mt19937_64 generator_;
-  std::uniform_int_distribution<uint64_t> dist_;
-  uint64_t last_int_;
-  std::mutex mutex_;
+  const uint64_t min_;
+  const uint64_t max_;
+  std::atomic<uint64_t> last_int_;
 };
 
-inline uint64_t UniformGenerator::Next() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return last_int_ = dist_(generator_);
-}
-
-inline uint64_t UniformGenerator::Last() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return last_int_;
+inline uint64_t UniformGenerator::Next(Random &rng) {
+  return last_int_ = rng.NextUniform(min_, max_);
 }
 
 } // ycsbc
@@ -12,7 +12,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <exception>
-#include <random>
+#include <string>
 
 namespace utils {
 
@@ -34,19 +34,6 @@ inline uint64_t FNVHash64(uint64_t val) {
 
 inline uint64_t Hash(uint64_t val) { return FNVHash64(val); }
 
-inline double RandomDouble(double min = 0.0, double max = 1.0) {
-  static thread_local std::default_random_engine generator;
-  std::uniform_real_distribution<double> uniform(min, max);
-  return uniform(generator);
-}
-
-///
-/// Returns an ASCII code that can be printed to desplay
-///
-inline char RandomPrintChar() {
-  return rand() % 94 + 33;
-}
-
 class Exception : public std::exception {
  public:
   Exception(const std::string &message) : message_(message) { }
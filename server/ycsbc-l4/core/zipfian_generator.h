@@ -31,16 +31,15 @@ class ZipfianGenerator : public Generator<uint64_t> {
     alpha_ = 1.0 / (1.0 - theta_);
     RaiseZeta(num_items_);
     eta_ = Eta();
-    
-    Next();
+    last_value_ = base_;
   }
   
   ZipfianGenerator(uint64_t num_items) :
       ZipfianGenerator(0, num_items - 1, kZipfianConst) { }
   
-  uint64_t Next(uint64_t num_items);
+  uint64_t Next(Random &rng, uint64_t num_items);
   
-  uint64_t Next() { return Next(num_items_); }
+  uint64_t Next(Random &rng) { return Next(rng, num_items_); }
 
   uint64_t Last();
   
@@ -89,7 +88,7 @@ class ZipfianGenerator : public Generator<uint64_t> {
   std::mutex mutex_;
 };
 
-inline uint64_t ZipfianGenerator::Next(uint64_t num) {
+inline uint64_t ZipfianGenerator::Next(Random &rng, uint64_t num) {
   assert(num >= 2 && num < kMaxNumItems);
   std::lock_guard<std::mutex> lock(mutex_);
 
@@ -98,7 +97,7 @@ inline uint64_t ZipfianGenerator::Next(uint64_t num) {
     eta_ = Eta();
   }
   
-  double u = utils::RandomDouble();
+  double u = rng.NextDouble();
   double uz = u * zeta_n_;
   
   if (uz < 1.0) {
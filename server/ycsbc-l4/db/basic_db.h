@@ -33,7 +33,7 @@ class BasicDB : public DB {
   int Read(void *, const std::string &table, const std::string &key,
            const std::vector<std::string> *fields,
            std::vector<KVPair> &result) override {
-    (void) result;
+    result.clear();
     std::lock_guard<std::mutex> lock(mutex_);
     cout << "READ " << table << ' ' << key;
     if (fields) {
@@ -51,7 +51,7 @@ class BasicDB : public DB {
   int Scan(void *, const std::string &table, const std::string &key,
            int len, const std::vector<std::string> *fields,
            std::vector<std::vector<KVPair>> &result) override {
-    (void) result;
+    result.clear();
     std::lock_guard<std::mutex> lock(mutex_);
     cout << "SCAN " << table << ' ' << key << " " << len;
     if (fields) {
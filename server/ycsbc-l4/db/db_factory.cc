@@ -10,8 +10,7 @@
 
 #include <string>
 #include "db/basic_db.h"
-#include "db/lock_stl_db.h"
-#include "sqlite_lib_db.h"
+#include "db_host.h"
 #include "sqlite_ipc_db.h"
 #include "sqlite_shm_db.h"
 
@@ -23,19 +22,25 @@ DB* DBFactory::CreateDB(utils::Properties &props) {
   if (props["dbname"] == "basic") {
     return new BasicDB;
   }
-  else if (props["dbname"] == "lock_stl") {
-    return new LockStlDB;
-  }
-  else if (props["dbname"] == "sqlite_lib") {
-    return new SqliteLibDB;
-  }
   else if (props["dbname"] == "sqlite_ipc") {
-    return new SqliteIpcDB;
+    // The server hosts any in-process backend and gets all properties to
+    // configure it.
+    size_t depth = stoul(props.GetProperty("queuedepth", "1"));
+    return new SqliteIpcDB(props.GetProperty("server.db", "sqlite_lib"),
+                           props.properties(), depth);
   }
   else if (props["dbname"] == "sqlite_shm") {
-    return new SqliteShmDB;
+    size_t depth = stoul(props.GetProperty("queuedepth", "1"));
+    return new SqliteShmDB(props.GetProperty("server.db", "sqlite_lib"),
+                           props.properties(), depth);
+  }
+  else {
+    // All other backends run in this process, created the same way as by
+    // the database servers.
+    try {
+      return dbhost::create_db(props["dbname"], props.properties());
+    } catch (const invalid_argument &e) {
+      throw utils::Exception(e.what());
+    }
   }
-  else 
-    return NULL;
 }
-
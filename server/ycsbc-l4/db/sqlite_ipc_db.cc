@@ -13,26 +13,63 @@
 
 #include <array>
 #include <assert.h>
+#include <condition_variable>
 #include <cstddef>
+#include <deque>
 #include <exception>
+#include <functional> // std::ref
 #include <iostream>
 #include <l4/re/error_helper> // L4Re::Chkcap and friends
 #include <l4/re/rm>
 #include <l4/re/util/cap_alloc>
 #include <memory> // unique_ptr etc.
+#include <mutex>
 #include <stdexcept>
 #include <sys/ipc.h>
+#include <thread>
 
 using serializer::Deserializer;
 using serializer::Serializer;
+using serializer::Schema;
 using sqlite::YCSBC_DS_SIZE;
 using sqlite::ipc::BenchI;
 using sqlite::ipc::DbI;
+using sqlite::ipc::RESULT_FAILED;
+using sqlite::ipc::UTCB_PAYLOAD_SIZE;
 using std::string;
 using std::vector;
 
 namespace ycsbc {
 
+struct IpcCltCtx;
+
+/*
+ * Worker threads of a benchmark thread that issue its asynchronous
+ * operations, each on a session (and thus server thread) of its own.
+ */
+struct IpcWorkers {
+  std::vector<IpcCltCtx *> sessions{};
+  std::vector<std::thread> threads{};
+
+  // Protects pending, finished, error and stop
+  std::mutex lock{};
+  std::condition_variable submitted{};
+  std::condition_variable completed{};
+
+  // Submitted operations no worker has started yet
+  std::deque<AsyncOp *> pending{};
+  // Operations finished by the workers but not yet completed by Poll()
+  std::vector<AsyncOp *> finished{};
+  // First exception thrown by a worker, rethrown by Poll()
+  std::exception_ptr error{};
+  bool stop = false;
+
+  // Only used by the benchmark thread: the number of operations in flight
+  // and the operations completed by the current Poll()
+  std::size_t in_flight = 0;
+  std::vector<AsyncOp *> ready{};
+};
+
 /*
  * Context structure for clients of the sqlite IPC server.
  */
@@ -48,7 +85,23 @@ struct IpcCltCtx {
   L4::Cap<L4Re::Dataspace> ds_out;
   char *ds_out_addr = 0;
 
-  IpcCltCtx() = default;
+  // Request and response of operations passed in the message registers
+  char utcb_req[UTCB_PAYLOAD_SIZE];
+  char utcb_resp[UTCB_PAYLOAD_SIZE];
+
+  // Worker threads for asynchronous operations, if the queue depth is > 1
+  IpcWorkers *workers = nullptr;
+
+  // The database failed the last operation, see RESULT_FAILED
+  bool failed = false;
+
+  // Time the operations of this context and add them to stages. The
+  // responses of the server start with a header then.
+  bool timed;
+  breakdown::Probe probe{};
+  breakdown::Stages stages{};
+
+  explicit IpcCltCtx(bool timed) : timed{timed} {}
 
   ~IpcCltCtx() {
     // Resource deallocation is currently done inside SqliteIpcDB::Close().
@@ -63,13 +116,143 @@ struct IpcCltCtx {
   static IpcCltCtx &cast(void *ctx) {
     return *reinterpret_cast<IpcCltCtx *>(ctx);
   }
+
+  std::size_t header_size() const {
+    return timed ? breakdown::HEADER_SIZE : 0;
+  }
+
+  // Stamps of the latency breakdown: an operation starts, its request is
+  // about to be sent, its response (starting with the header) has arrived and
+  // has been handled.
+  void begin() {
+    if (timed)
+      probe.Begin();
+  }
+  void send() {
+    if (timed)
+      probe.Send();
+  }
+  void receive(char const *header) {
+    if (timed)
+      probe.Receive(header);
+  }
+  void done() {
+    if (timed)
+      probe.End(stages);
+  }
+
+  // Checks the return code of the server for command. Throws for errors of
+  // the transport and records whether the database failed the operation.
+  void check(long rc, char const *command) {
+    if (rc < 0)
+      throw std::runtime_error{string{command} + " command failed"};
+    failed = rc == RESULT_FAILED;
+  }
+
+  // Deserializer on the output dataspace behind the header of the latency
+  // breakdown
+  Deserializer output() const {
+    std::size_t header = header_size();
+    return Deserializer{ds_out_addr + header, YCSBC_DS_SIZE - header};
+  }
+
+  // Performs the operation `opcode` with the request serialized by s (on
+  // utcb_req) in the message registers. Returns a deserializer on the
+  // response in utcb_resp. Check failed before deserializing it.
+  Deserializer exec(char opcode, Serializer const &s) {
+    L4::Ipc::Array<char const> req(s.length(), utcb_req);
+    L4::Ipc::Array<char> resp(sizeof(utcb_resp), utcb_resp);
+
+    send();
+    check(bench->exec(opcode, req, resp), "exec");
+    receive(resp.data);
+
+    std::size_t header = header_size();
+    return Deserializer{resp.data + header, resp.length - header};
+  }
 };
 
+// Maximum length of a varint, see serializer::Serializer::varint().
+static const std::size_t MAX_VARINT_SIZE = 10;
+
+/* Upper bound for the size of a read request. */
+static std::size_t request_size(const string &key,
+                                const vector<string> *fields) {
+  std::size_t size = 3 * MAX_VARINT_SIZE + key.size();
+
+  if (fields != nullptr) {
+    for (auto &f : *fields)
+      size += 2 * MAX_VARINT_SIZE + f.size();
+  }
+  return size;
+}
+
+/* Upper bound for the size of an insert or update request. */
+static std::size_t request_size(const string &key,
+                                const vector<DB::KVPair> &values) {
+  std::size_t size = 3 * MAX_VARINT_SIZE + key.size();
+
+  for (auto &v : values)
+    size += 3 * MAX_VARINT_SIZE + v.first.size() + v.second.size();
+  return size;
+}
+
+/*
+ * Send a read request to the server and return a deserializer on the record
+ * read. Small requests and results are passed in the message registers.
+ * Check ctx.failed before deserializing the record.
+ */
+static Deserializer call_read(IpcCltCtx &ctx, Schema const &schema,
+                              std::size_t table_id, const string &key,
+                              const vector<string> *fields) {
+  ctx.begin();
+
+  if (request_size(key, fields) <= UTCB_PAYLOAD_SIZE) {
+    Serializer s{ctx.utcb_req, UTCB_PAYLOAD_SIZE};
+    s.varint(table_id);
+    s.bytes(key);
+    s.fields(schema, table_id, fields);
+
+    Deserializer d = ctx.exec('r', s);
+    if (ctx.failed)
+      return d;
+    std::size_t in_utcb{};
+    d.varint(in_utcb);
+    if (in_utcb)
+      return d;
+
+    // The header is in the message registers in any case.
+    return Deserializer{ctx.ds_out_addr, YCSBC_DS_SIZE};
+  } else {
+    // First, reset the input page for the server
+    memset(ctx.ds_in_addr, '\0', YCSBC_DS_SIZE);
+
+    // Serialize everything into the input dataspace
+    Serializer s{ctx.ds_in_addr, YCSBC_DS_SIZE};
+    s.varint(table_id);
+    s.bytes(key);
+    s.fields(schema, table_id, fields);
+
+    // Call the server
+    ctx.send();
+    ctx.check(ctx.bench->read(), "read");
+    ctx.receive(ctx.ds_out_addr);
+  }
+
+  return ctx.output();
+}
+
 /* Initialize IPC gate capability. */
-SqliteIpcDB::SqliteIpcDB(const string &filename)
-    : filename{filename}, server{L4Re::Env::env()->get_cap<DbI>("ipc")} {
+SqliteIpcDB::SqliteIpcDB(const string &db_name, const dbhost::Params &params,
+                         std::size_t queue_depth)
+    : db_name{db_name}, params{params}, queue_depth{queue_depth},
+      timed{breakdown::enabled(params)},
+      server{L4Re::Env::env()->get_cap<DbI>("ipc")} {
   L4Re::chkcap(server);
 
+  if (queue_depth == 0)
+    throw std::invalid_argument{"queue depth must be positive"};
+
   // Setup the main thread's data space used for sending database schema
   // information to the server during SqliteIpcDB::CreateSchema()
   db_infopage = L4Re::Util::cap_alloc.alloc<L4Re::Dataspace>();
@@ -97,10 +280,13 @@ SqliteIpcDB::SqliteIpcDB(const string &filename)
 
 /* Send IPC for creating the schema. */
 void SqliteIpcDB::CreateSchema(DB::Tables tables) {
-  // Funnel the filename and the schema description into the infopage.
+  // Funnel the database selection and the schema description into the
+  // infopage.
   Serializer s{db_infopage_addr, YCSBC_DS_SIZE};
-  s << filename;
-  s << tables;
+  dbhost::write_spec(s, db_name, params, tables);
+
+  // Both sides derive the ids of the compact message format from tables.
+  schema = serializer::Schema{tables};
 
   // Call the server
   L4::Ipc::Cap<L4Re::Dataspace> snd_cap(db_infopage);
@@ -111,9 +297,10 @@ void SqliteIpcDB::CreateSchema(DB::Tables tables) {
   std::cout << "Schema created." << std::endl;
 }
 
-/* Create a new session for this thread at the SQLite server. */
-void *SqliteIpcDB::Init(l4_umword_t cpu) {
-  std::unique_ptr<IpcCltCtx> ctx{new IpcCltCtx{}};
+/* Create a new session at the SQLite server, served by a thread on cpu. */
+static IpcCltCtx *open_session(L4::Cap<DbI> server, l4_umword_t cpu,
+                               bool timed) {
+  std::unique_ptr<IpcCltCtx> ctx{new IpcCltCtx{timed}};
 
   // Allocate capabilities of context
   ctx->bench = L4Re::Util::cap_alloc.alloc<BenchI>();
@@ -156,31 +343,163 @@ void *SqliteIpcDB::Init(l4_umword_t cpu) {
   return (ctx.release());
 }
 
+// Signals the end of a session to the Sqlite IPC server and destroys its
+// context. This also involves freeing all dataspaces used for communication
+// with the server.
+static void close_session(IpcCltCtx &ctx) {
+  // Wait for the server to detach the ds_in and ds_out dataspaces we handed
+  // over earlier.
+  if (ctx.bench->close() != L4_EOK) {
+    std::cerr << "WARNING: Failed to properly shut down connection to server."
+              << std::endl;
+  }
+
+  // Detach communication mappings from this address space
+  if (L4Re::Env::env()->rm()->detach(ctx.ds_in_addr, &ctx.ds_in) < 0) {
+    std::cerr << "Failed to detach input dataspace." << std::endl;
+    return;
+  }
+  if (L4Re::Env::env()->rm()->detach(ctx.ds_out_addr, &ctx.ds_out) < 0) {
+    std::cerr << "Failed to detach output dataspace." << std::endl;
+    return;
+  }
+
+  // Return the memory of the dataspaces
+  // Note that we could have also directly disabled the derived mappings in
+  // the server process by adding L4_FP_ALL_SPACES to the flags. However, I
+  // thought that it would be nice to notify the server anyway, so we trust it
+  // to do the unmapping itself.
+  L4Re::Env::env()->task()->unmap(ctx.ds_in.fpage(), L4_FP_DELETE_OBJ);
+  L4Re::Env::env()->task()->unmap(ctx.ds_out.fpage(), L4_FP_DELETE_OBJ);
+
+  // Free the caps associated with the communication mappings
+  L4Re::Util::cap_alloc.free(ctx.ds_in);
+  L4Re::Util::cap_alloc.free(ctx.ds_out);
+
+  // Terminate the server thread associated with this client thread.
+  ctx.bench->terminate();
+  L4Re::Util::cap_alloc.free(ctx.bench);
+
+  delete &ctx;
+
+  // std::cerr << "Benchmark thread terminated." << std::endl;
+}
+
+/*
+ * Body of a worker thread: execute the operations submitted to workers
+ * synchronously on session until the workers are stopped.
+ */
+static void work(DB &db, IpcWorkers &workers, IpcCltCtx *session) {
+  for (;;) {
+    AsyncOp *op;
+    {
+      std::unique_lock<std::mutex> guard{workers.lock};
+      workers.submitted.wait(guard, [&workers] {
+        return workers.stop || !workers.pending.empty();
+      });
+      if (workers.pending.empty())
+        return;
+      op = workers.pending.front();
+      workers.pending.pop_front();
+    }
+
+    // Errors of the transport must not terminate the client from this
+    // thread. The benchmark thread rethrows them in Poll().
+    std::exception_ptr error;
+    try {
+      op->status = db.Execute(session, *op);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> guard{workers.lock};
+      if (error && !workers.error)
+        workers.error = error;
+      workers.finished.push_back(op);
+    }
+    workers.completed.notify_one();
+  }
+}
+
+/* Create a new session for this thread at the SQLite server. */
+void *SqliteIpcDB::Init(l4_umword_t cpu) {
+  IpcCltCtx *ctx = open_session(server, cpu, timed);
+
+  // Asynchronous operations are issued by worker threads, each with its own
+  // session. The first worker shares the session of ctx.
+  if (queue_depth > 1) {
+    auto workers = new IpcWorkers{};
+    ctx->workers = workers;
+    workers->sessions.push_back(ctx);
+    for (std::size_t i = 1; i < queue_depth; i++)
+      workers->sessions.push_back(open_session(server, cpu, timed));
+    for (auto session : workers->sessions)
+      workers->threads.emplace_back(work, std::ref(*this), std::ref(*workers),
+                                    session);
+  }
+
+  return (ctx);
+}
+
 int SqliteIpcDB::Read(void *ctx_, const string &table, const string &key,
                       const vector<std::string> *fields,
                       vector<KVPair> &result) {
   auto &ctx = IpcCltCtx::cast(ctx_);
+  std::size_t table_id = schema.table_id(table);
+
+  // Call the server and deserialize the operation results
+  Deserializer d = call_read(ctx, schema, table_id, key, fields);
+  if (ctx.failed)
+    result.clear();
+  else
+    d.values(schema, table_id, result);
+  ctx.done();
+
+  if (result.size() == 0)
+    return (kErrorNoData);
+  else
+    return (kOK);
+}
+
+int SqliteIpcDB::Scan(void *ctx_, const string &table, const string &key,
+                      int len, const vector<std::string> *fields,
+                      vector<std::vector<KVPair>> &result) {
+  auto &ctx = IpcCltCtx::cast(ctx_);
+  ctx.begin();
 
   // First, reset the input page for the server
   memset(ctx.ds_in_addr, '\0', YCSBC_DS_SIZE);
 
   // Serialize everything into the input dataspace
   Serializer s{ctx.ds_in_addr, YCSBC_DS_SIZE};
-  s << table;
-  s << key;
-  // We must transfer anything at all, even if it is just an empty vector
-  if (fields != nullptr)
-    s << *fields;
-  else
-    s << std::vector<std::string>(0);
+  std::size_t table_id = schema.table_id(table);
+  s.varint(table_id);
+  s.bytes(key);
+  s.varint(len);
+  s.fields(schema, table_id, fields);
 
   // Call the server
-  if (ctx.bench->read() != L4_EOK)
-    throw std::runtime_error{"read command failed"};
+  ctx.send();
+  ctx.check(ctx.bench->scan(), "scan");
+  ctx.receive(ctx.ds_out_addr);
+  if (ctx.failed) {
+    ctx.done();
+    result.clear();
+    return (kErrorNoData);
+  }
 
-  // Deserialize the operation results
-  Deserializer d{ctx.ds_out_addr};
-  d >> result;
+  // Deserialize the operation results. They are streamed in several chunks
+  // if they do not fit into the output dataspace.
+  for (std::size_t first = 0;; first = result.size()) {
+    Deserializer d = ctx.output();
+    if (!d.chunk(schema, table_id, result, first))
+      break;
+    ctx.send();
+    ctx.check(ctx.bench->scan_next(), "scan_next");
+    ctx.receive(ctx.ds_out_addr);
+  }
+  ctx.done();
 
   if (result.size() == 0)
     return (kErrorNoData);
@@ -188,34 +507,69 @@ int SqliteIpcDB::Read(void *ctx_, const string &table, const string &key,
     return (kOK);
 }
 
-int SqliteIpcDB::Scan(void *ctx_, const string &table, const string &key,
-                      int len, const vector<std::string> *fields,
-                      vector<std::vector<KVPair>> &result) {
+int SqliteIpcDB::ReadView(void *ctx_, const string &table, const string &key,
+                          const vector<std::string> *fields,
+                          ResultView &result) {
   auto &ctx = IpcCltCtx::cast(ctx_);
+  std::size_t table_id = schema.table_id(table);
+
+  // Call the server and reference the operation results in the response
+  // buffer of ctx or the output dataspace
+  Deserializer d = call_read(ctx, schema, table_id, key, fields);
+  if (ctx.failed) {
+    ctx.done();
+    result.Clear();
+    return (kErrorNoData);
+  }
+  d.record(schema, table_id, result);
+  ctx.done();
+
+  if (result.Fields(0) == 0)
+    return (kErrorNoData);
+  else
+    return (kOK);
+}
+
+int SqliteIpcDB::ScanView(void *ctx_, const string &table, const string &key,
+                          int len, const vector<std::string> *fields,
+                          ResultView &result) {
+  auto &ctx = IpcCltCtx::cast(ctx_);
+  ctx.begin();
 
   // First, reset the input page for the server
   memset(ctx.ds_in_addr, '\0', YCSBC_DS_SIZE);
 
   // Serialize everything into the input dataspace
   Serializer s{ctx.ds_in_addr, YCSBC_DS_SIZE};
-  s << table;
-  s << key;
-  s << len;
-  // We must transfer anything at all, even if it is just an empty vector
-  if (fields != nullptr)
-    s << *fields;
-  else
-    s << std::vector<std::string>(0);
+  std::size_t table_id = schema.table_id(table);
+  s.varint(table_id);
+  s.bytes(key);
+  s.varint(len);
+  s.fields(schema, table_id, fields);
 
   // Call the server
-  if (ctx.bench->scan() != L4_EOK)
-    throw std::runtime_error{"scan command failed"};
+  ctx.send();
+  ctx.check(ctx.bench->scan(), "scan");
+  ctx.receive(ctx.ds_out_addr);
+  if (ctx.failed) {
+    ctx.done();
+    result.Clear();
+    return (kErrorNoData);
+  }
 
-  // Deserialize the operation results
-  Deserializer d{ctx.ds_out_addr};
-  d >> result;
+  // Reference the operation results in the output dataspace. All chunks but
+  // the last one of a streamed result are copied.
+  for (bool first = true;; first = false) {
+    Deserializer d = ctx.output();
+    if (!d.chunk(schema, table_id, result, first))
+      break;
+    ctx.send();
+    ctx.check(ctx.bench->scan_next(), "scan_next");
+    ctx.receive(ctx.ds_out_addr);
+  }
+  ctx.done();
 
-  if (result.size() == 0)
+  if (result.Records() == 0)
     return (kErrorNoData);
   else
     return (kOK);
@@ -224,103 +578,211 @@ int SqliteIpcDB::Scan(void *ctx_, const string &table, const string &key,
 int SqliteIpcDB::Update(void *ctx_, const string &table, const string &key,
                         vector<KVPair> &values) {
   auto &ctx = IpcCltCtx::cast(ctx_);
+  std::size_t table_id = schema.table_id(table);
+  ctx.begin();
+
+  // Pass small requests in the message registers
+  if (request_size(key, values) <= UTCB_PAYLOAD_SIZE) {
+    Serializer s{ctx.utcb_req, UTCB_PAYLOAD_SIZE};
+    s.varint(table_id);
+    s.bytes(key);
+    s.values(schema, table_id, values);
+
+    ctx.exec('u', s);
+    ctx.done();
+    return ctx.failed ? kErrorNoData : kOK;
+  }
 
   // First, reset the input page for the server
   memset(ctx.ds_in_addr, '\0', YCSBC_DS_SIZE);
 
   // Serialize everything into the input dataspace
   Serializer s{ctx.ds_in_addr, YCSBC_DS_SIZE};
-  s << table;
-  s << key;
-  s << values;
+  s.varint(table_id);
+  s.bytes(key);
+  s.values(schema, table_id, values);
 
   // Call the server
-  if (ctx.bench->update() != L4_EOK)
-    throw std::runtime_error{"update command failed"};
+  ctx.send();
+  ctx.check(ctx.bench->update(), "update");
+  ctx.receive(ctx.ds_out_addr);
+  ctx.done();
 
-  return (kOK);
+  return ctx.failed ? kErrorNoData : kOK;
 }
 
 int SqliteIpcDB::Insert(void *ctx_, const string &table, const string &key,
                         vector<KVPair> &values) {
   auto &ctx = IpcCltCtx::cast(ctx_);
+  std::size_t table_id = schema.table_id(table);
+  ctx.begin();
+
+  // Pass small requests in the message registers
+  if (request_size(key, values) <= UTCB_PAYLOAD_SIZE) {
+    Serializer s{ctx.utcb_req, UTCB_PAYLOAD_SIZE};
+    s.varint(table_id);
+    s.bytes(key);
+    s.values(schema, table_id, values);
+
+    ctx.exec('i', s);
+    ctx.done();
+    return ctx.failed ? kErrorNoData : kOK;
+  }
 
   // First, reset the input page for the server
   memset(ctx.ds_in_addr, '\0', YCSBC_DS_SIZE);
 
   // Serialize everything into the input dataspace
   Serializer s{ctx.ds_in_addr, YCSBC_DS_SIZE};
-  s << table;
-  s << key;
-  s << values;
+  s.varint(table_id);
+  s.bytes(key);
+  s.values(schema, table_id, values);
 
   // Call the server
-  if (ctx.bench->insert() != L4_EOK)
-    throw std::runtime_error{"insert command failed"};
+  ctx.send();
+  ctx.check(ctx.bench->insert(), "insert");
+  ctx.receive(ctx.ds_out_addr);
+  ctx.done();
 
-  return (kOK);
+  return ctx.failed ? kErrorNoData : kOK;
 }
 
 int SqliteIpcDB::Delete(void *ctx_, const string &table, const string &key) {
   auto &ctx = IpcCltCtx::cast(ctx_);
+  std::size_t table_id = schema.table_id(table);
+  ctx.begin();
+
+  // Pass small requests in the message registers
+  if (request_size(key, nullptr) <= UTCB_PAYLOAD_SIZE) {
+    Serializer s{ctx.utcb_req, UTCB_PAYLOAD_SIZE};
+    s.varint(table_id);
+    s.bytes(key);
+
+    ctx.exec('d', s);
+    ctx.done();
+    return ctx.failed ? kErrorNoData : kOK;
+  }
 
   // First, reset the input page for the server
   memset(ctx.ds_in_addr, '\0', YCSBC_DS_SIZE);
 
   // Serialize everything into the input dataspace
   Serializer s{ctx.ds_in_addr, YCSBC_DS_SIZE};
-  s << table;
-  s << key;
+  s.varint(table_id);
+  s.bytes(key);
 
   // Call the server
-  if (ctx.bench->del() != L4_EOK)
-   throw std::runtime_error{"delete command failed"};
+  ctx.send();
+  ctx.check(ctx.bench->del(), "delete");
+  ctx.receive(ctx.ds_out_addr);
+  ctx.done();
 
-  return (kOK);
+  return ctx.failed ? kErrorNoData : kOK;
 }
 
-// Signals the end of the connection to the Sqlite IPC server and destroys the
-// context associated with this worker thread. This also involves freeing all
-// dataspaces used for communication with the server.
-void SqliteIpcDB::Close(void *ctx_) {
+std::size_t SqliteIpcDB::QueueDepth(void *ctx_) {
   auto &ctx = IpcCltCtx::cast(ctx_);
 
-  // Wait for the server to detach the ds_in and ds_out dataspaces we handed
-  // over earlier.
-  if (ctx.bench->close() != L4_EOK) {
-    std::cerr << "WARNING: Failed to properly shut down connection to server."
-              << std::endl;
+  return ctx.workers ? ctx.workers->sessions.size() : 1;
+}
+
+/* Hand op over to the next idle worker thread. */
+void SqliteIpcDB::Submit(void *ctx_, AsyncOp &op) {
+  auto &ctx = IpcCltCtx::cast(ctx_);
+
+  if (!ctx.workers)
+    return DB::Submit(ctx_, op);
+
+  auto &w = *ctx.workers;
+  if (w.in_flight == w.sessions.size())
+    throw std::runtime_error{"too many operations in flight"};
+  w.in_flight++;
+
+  {
+    std::lock_guard<std::mutex> guard{w.lock};
+    w.pending.push_back(&op);
   }
+  w.submitted.notify_one();
+}
 
-  // Detach communication mappings from this address space
-  if (L4Re::Env::env()->rm()->detach(ctx.ds_in_addr, &ctx.ds_in) < 0) {
-    std::cerr << "Failed to detach input dataspace." << std::endl;
-    return;
+/* Complete the operations finished by the worker threads. */
+std::size_t SqliteIpcDB::Poll(void *ctx_, bool wait) {
+  auto &ctx = IpcCltCtx::cast(ctx_);
+
+  if (!ctx.workers)
+    return 0;
+
+  auto &w = *ctx.workers;
+  std::exception_ptr error;
+  w.ready.clear();
+  {
+    std::unique_lock<std::mutex> guard{w.lock};
+    if (wait && w.in_flight > 0)
+      w.completed.wait(guard, [&w] { return !w.finished.empty(); });
+    w.ready.swap(w.finished);
+    error.swap(w.error);
   }
-  if (L4Re::Env::env()->rm()->detach(ctx.ds_out_addr, &ctx.ds_out) < 0) {
-    std::cerr << "Failed to detach output dataspace." << std::endl;
-    return;
+
+  w.in_flight -= w.ready.size();
+  if (error)
+    std::rethrow_exception(error);
+  for (auto op : w.ready) {
+    if (op->callback)
+      op->callback(*op);
   }
+  return w.ready.size();
+}
 
-  // Return the memory of the dataspaces
-  // Note that we could have also directly disabled the derived mappings in
-  // the server process by adding L4_FP_ALL_SPACES to the flags. However, I
-  // thought that it would be nice to notify the server anyway, so we trust it
-  // to do the unmapping itself.
-  L4Re::Env::env()->task()->unmap(ctx.ds_in.fpage(), L4_FP_DELETE_OBJ);
-  L4Re::Env::env()->task()->unmap(ctx.ds_out.fpage(), L4_FP_DELETE_OBJ);
+// Signals the end of the connection to the Sqlite IPC server and destroys the
+// context associated with this benchmark thread, including the sessions of
+// its worker threads.
+void SqliteIpcDB::Close(void *ctx_) {
+  auto &ctx = IpcCltCtx::cast(ctx_);
 
-  // Free the caps associated with the communication mappings
-  L4Re::Util::cap_alloc.free(ctx.ds_in);
-  L4Re::Util::cap_alloc.free(ctx.ds_out);
+  if (ctx.workers) {
+    auto &w = *ctx.workers;
+    {
+      std::lock_guard<std::mutex> guard{w.lock};
+      w.stop = true;
+    }
+    w.submitted.notify_all();
+    for (auto &t : w.threads)
+      t.join();
+
+    for (std::size_t i = 1; i < w.sessions.size(); i++) {
+      collect(*w.sessions[i]);
+      close_session(*w.sessions[i]);
+    }
+    delete &w;
+  }
 
-  // Terminate the server thread associated with this client thread.
-  ctx.bench->terminate();
-  L4Re::Util::cap_alloc.free(ctx.bench);
+  collect(ctx);
+  close_session(ctx);
+}
 
-  delete &ctx;
+/* Add the latency breakdown of a session to the one of all sessions. */
+void SqliteIpcDB::collect(IpcCltCtx &ctx) {
+  if (!timed)
+    return;
 
-  // std::cerr << "Benchmark thread terminated." << std::endl;
+  std::lock_guard<std::mutex> guard{stages_lock};
+  stages.Merge(ctx.stages);
+}
+
+/* Only count the operations of the benchmark run. */
+void SqliteIpcDB::EndLoad() {
+  std::lock_guard<std::mutex> guard{stages_lock};
+  stages.Clear();
+}
+
+bool SqliteIpcDB::TakeBreakdown(breakdown::Stages &taken) {
+  if (!timed)
+    return false;
+
+  std::lock_guard<std::mutex> guard{stages_lock};
+  taken = stages;
+  stages.Clear();
+  return true;
 }
 
 } // namespace ycsbc
@@ -9,11 +9,15 @@
 
 #pragma once
 
+#include "breakdown.h"              // Latency breakdown of operations
 #include "db.h"                     // YCSBC interface for databases
+#include "db_host.h"                // Selection of the hosted database
+#include "serializer.h"             // Compact message format
 #include "sqlite_ipc_server.h"      // Interfaces for the Sqlite server.
 
 #include <sqlite3.h>                // Definitions for Sqlite
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -22,16 +26,25 @@
 namespace ycsbc {
 
 struct Ctx;
+struct IpcCltCtx;
 
 class SqliteIpcDB : public DB {
 public:
-    SqliteIpcDB(const std::string &filename = std::string(":memory:"));
+    // The server hosts the database backend db_name, configured by params
+    // (see dbhost::create_db()). Every benchmark thread may have up to
+    // queue_depth operations in flight through the asynchronous interface.
+    // If the property breakdown is set in params, every operation is timed
+    // (see breakdown.h).
+    SqliteIpcDB(const std::string &db_name = std::string("sqlite_lib"),
+                const dbhost::Params &params = dbhost::Params(),
+                std::size_t queue_depth = 1);
     // FIXME: Add destructor.
 
     // Meta operations for database and/or connection management
     void CreateSchema(DB::Tables tables) override;
     void *Init(l4_umword_t cpu) override;
     void Close(void *ctx) override;
+    void EndLoad() override;
 
     // Database (benchmark) operations
     int Read(void *ctx, const std::string &table, const std::string &key,
@@ -42,6 +55,15 @@ public:
              const std::vector<std::string> *fields,
              std::vector<std::vector<KVPair>> &result) override;
 
+    // The views reference the output dataspace of ctx.
+    int ReadView(void *ctx, const std::string &table, const std::string &key,
+                 const std::vector<std::string> *fields,
+                 ResultView &result) override;
+
+    int ScanView(void *ctx, const std::string &table, const std::string &key,
+                 int len, const std::vector<std::string> *fields,
+                 ResultView &result) override;
+
     int Update(void *ctx, const std::string &table, const std::string &key,
                std::vector<KVPair> &values) override;
 
@@ -51,9 +73,30 @@ public:
     int Delete(void *ctx, const std::string &table,
                const std::string &key) override;
 
+    // Operations are issued by queue depth worker threads, each with its own
+    // server thread.
+    std::size_t QueueDepth(void *ctx) override;
+    void Submit(void *ctx, AsyncOp &op) override;
+    std::size_t Poll(void *ctx, bool wait) override;
+
+    bool TakeBreakdown(breakdown::Stages &stages) override;
+
 private:
-    // Filename of the DB, transmitted to server
-    const std::string filename;
+    // Name and parameters of the hosted database, transmitted to server
+    const std::string db_name;
+    const dbhost::Params params;
+
+    // Number of sessions (and worker threads) of every benchmark thread
+    const std::size_t queue_depth;
+
+    // Time the stages of every operation
+    const bool timed;
+    // Latency breakdown of all closed contexts, protected by stages_lock
+    breakdown::Stages stages;
+    std::mutex stages_lock;
+
+    // Add the latency breakdown of a session before closing it.
+    void collect(IpcCltCtx &ctx);
 
     // Capability to the sqlite IPC server
     L4::Cap<sqlite::ipc::DbI> server;
@@ -61,6 +104,9 @@ private:
     // Dataspace for transmitting database layout information during setup
     L4::Cap<L4Re::Dataspace> db_infopage;
     char *db_infopage_addr = 0;
+
+    // Table and column ids for the messages to the server
+    serializer::Schema schema{};
 };
 
 } // namespace ycsbc
@@ -28,6 +28,8 @@ using serializer::Deserializer;
 using serializer::Serializer;
 using sqlite::YCSBC_DS_SIZE;
 using sqlite::shm::DbI;
+using sqlite::shm::MAX_QUEUE_DEPTH;
+using sqlite::shm::RESPONSE_FAILED;
 using std::string;
 using std::vector;
 
@@ -45,7 +47,33 @@ struct IpcCltCtx {
   L4::Cap<L4Re::Dataspace> ds_out;
   char *ds_out_addr = 0;
 
-  IpcCltCtx() = default;
+  // Asynchronous operation in flight in a slot of the dataspaces
+  struct Slot {
+    AsyncOp *op = nullptr;
+    std::size_t table_id = 0;
+    // No chunk of a scan result has been received yet
+    bool first = true;
+    // The server reported the last response as failed
+    bool failed = false;
+    // Timestamps of the operation, only used if timed
+    breakdown::Probe probe{};
+  };
+
+  // Number and size of the slots of the dataspaces. Synchronous operations
+  // use slot 0.
+  std::size_t depth;
+  std::size_t slot_size;
+  std::vector<Slot> slots;
+  std::size_t in_flight = 0;
+
+  // Time the operations of this context and add them to stages. The
+  // responses of the server start with a header then.
+  bool timed;
+  breakdown::Stages stages{};
+
+  IpcCltCtx(std::size_t depth, bool timed)
+      : depth{depth}, slot_size{sqlite::shm::slot_size(depth)},
+        slots(depth), timed{timed} {}
 
   ~IpcCltCtx() {
     // Resource deallocation is currently done inside SqliteShmDB::Close().
@@ -57,37 +85,91 @@ struct IpcCltCtx {
   IpcCltCtx &operator=(const IpcCltCtx &) = delete;
   IpcCltCtx &operator=(IpcCltCtx &&) = delete;
 
-  Serializer serializer() const {
-    return Serializer{ds_in_addr + 1, YCSBC_DS_SIZE - 1};
+  char *slot_in(std::size_t slot) const {
+    return ds_in_addr + slot * slot_size;
+  }
+  char *slot_out(std::size_t slot) const {
+    return ds_out_addr + slot * slot_size;
+  }
+
+  // Starts a new operation in slot.
+  Serializer serializer(std::size_t slot = 0) {
+    if (timed)
+      slots[slot].probe.Begin();
+    return Serializer{slot_in(slot) + 1, slot_size - 1};
   }
 
-  // Sends the message to the other side and waits for a response.
-  Deserializer call(char opcode) const {
+  // Sends the message in slot to the other side without waiting.
+  void send(char opcode, std::size_t slot = 0) {
+    if (timed)
+      slots[slot].probe.Send();
+
     // Notify other side about message.
-    __atomic_store_n(ds_in_addr, opcode, __ATOMIC_RELEASE);
+    __atomic_store_n(slot_in(slot), opcode, __ATOMIC_RELEASE);
+  }
+
+  // Returns true and resets the notification byte if the response to the
+  // message in slot has arrived. Records whether the operation failed.
+  bool received(std::size_t slot) {
+    char status = __atomic_load_n(slot_out(slot), __ATOMIC_ACQUIRE);
+    if (!status)
+      return false;
+    slots[slot].failed = status == RESPONSE_FAILED;
+
+    if (timed)
+      slots[slot].probe.Receive(slot_out(slot) + 1);
+
+    // Reset notification byte.
+    *slot_out(slot) = 0;
+    return true;
+  }
+
+  // Deserializer on the response in slot, behind the header of the latency
+  // breakdown
+  Deserializer response(std::size_t slot = 0) const {
+    std::size_t header = timed ? breakdown::HEADER_SIZE : 0;
+    return Deserializer{slot_out(slot) + 1 + header, slot_size - 1 - header};
+  }
+
+  // Finishes the operation in slot after its response has been handled.
+  void done(std::size_t slot = 0) {
+    if (timed)
+      slots[slot].probe.End(stages);
+  }
+
+  // Sends the message to the other side and waits for a response. Check
+  // failed() before deserializing it.
+  Deserializer call(char opcode) {
+    send(opcode);
 
     // Wait for incoming message.
-    while (!(__atomic_load_n(ds_out_addr, __ATOMIC_ACQUIRE))) {
+    while (!received(0)) {
       // Use PAUSE to hint a spin-wait loop. This should use YIELD on ARM.
       __builtin_ia32_pause();
     }
 
-    // Reset notification byte.
-    *ds_out_addr = 0;
-
-    return Deserializer{ds_out_addr + 1};
+    return response();
   }
 
+  // Reports whether the server failed the operation in slot.
+  bool failed(std::size_t slot = 0) const { return slots[slot].failed; }
+
   static IpcCltCtx &cast(void *ctx) {
     return *reinterpret_cast<IpcCltCtx *>(ctx);
   }
 };
 
 /* Initialize IPC gate capability. */
-SqliteShmDB::SqliteShmDB(const string &filename)
-    : filename{filename}, server{L4Re::Env::env()->get_cap<DbI>("shm")} {
+SqliteShmDB::SqliteShmDB(const string &db_name, const dbhost::Params &params,
+                         std::size_t queue_depth)
+    : db_name{db_name}, params{params}, queue_depth{queue_depth},
+      timed{breakdown::enabled(params)},
+      server{L4Re::Env::env()->get_cap<DbI>("shm")} {
   L4Re::chkcap(server);
 
+  if (queue_depth == 0 || queue_depth > MAX_QUEUE_DEPTH)
+    throw std::invalid_argument{"queue depth out of range"};
+
   // Setup the main thread's data space used for sending database schema
   // information to the server during SqliteShmDB::CreateSchema()
   db_infopage = L4Re::Util::cap_alloc.alloc<L4Re::Dataspace>();
@@ -115,10 +197,13 @@ SqliteShmDB::SqliteShmDB(const string &filename)
 
 /* Send IPC for creating the schema. */
 void SqliteShmDB::CreateSchema(DB::Tables tables) {
-  // Funnel the filename and the schema description into the infopage.
+  // Funnel the database selection and the schema description into the
+  // infopage.
   Serializer s{db_infopage_addr, YCSBC_DS_SIZE};
-  s << filename;
-  s << tables;
+  dbhost::write_spec(s, db_name, params, tables);
+
+  // Both sides derive the ids of the compact message format from tables.
+  schema = serializer::Schema{tables};
 
   // Call the server
   L4::Ipc::Cap<L4Re::Dataspace> snd_cap(db_infopage);
@@ -131,7 +216,7 @@ void SqliteShmDB::CreateSchema(DB::Tables tables) {
 
 /* Create a new session for this thread at the SQLite server. */
 void *SqliteShmDB::Init(l4_umword_t cpu) {
-  std::unique_ptr<IpcCltCtx> ctx{new IpcCltCtx{}};
+  std::unique_ptr<IpcCltCtx> ctx{new IpcCltCtx{queue_depth, timed}};
 
   ctx->ds_in = L4Re::Util::cap_alloc.alloc<L4Re::Dataspace>();
   L4Re::chkcap(ctx->ds_in);
@@ -159,15 +244,19 @@ void *SqliteShmDB::Init(l4_umword_t cpu) {
     throw std::runtime_error{"Failed to attach db_out dataspace."};
   }
 
-  // Set the first notification bits of the dataspaces to zero.
+  // Set the notification bytes of all slots to zero.
   // Thus, the receiving threads will wait initially.
-  *ctx->ds_in_addr = 0;
+  for (std::size_t i = 0; i < queue_depth; i++) {
+    *ctx->slot_in(i) = 0;
+    *ctx->slot_out(i) = 0;
+  }
 
   // Send spawn command to server. Pay attiontion to the fact that we have to
   // explicitely make read-write capabilities in order for the sender to be
   // able to write to the memory that we send him!
   if (server->spawn(L4::Ipc::make_cap_rw(ctx->ds_in),
-                    L4::Ipc::make_cap_rw(ctx->ds_out), cpu) != L4_EOK)
+                    L4::Ipc::make_cap_rw(ctx->ds_out), cpu,
+                    queue_depth) != L4_EOK)
     throw std::runtime_error{"spawn command failed"};
 
   return (ctx.release());
@@ -180,19 +269,20 @@ int SqliteShmDB::Read(void *ctx_, const string &table, const string &key,
 
   // Serialize everything into the input dataspace
   Serializer s = ctx.serializer();
-  s << table;
-  s << key;
-  // We must transfer anything at all, even if it is just an empty vector
-  if (fields != nullptr)
-    s << *fields;
-  else
-    s << std::vector<std::string>(0);
+  std::size_t table_id = schema.table_id(table);
+  s.varint(table_id);
+  s.bytes(key);
+  s.fields(schema, table_id, fields);
 
   // Call the server
   Deserializer d = ctx.call('r');
 
   // Deserialize the operation results
-  d >> result;
+  if (ctx.failed())
+    result.clear();
+  else
+    d.values(schema, table_id, result);
+  ctx.done();
 
   if (result.size() == 0)
     return (kErrorNoData);
@@ -207,22 +297,88 @@ int SqliteShmDB::Scan(void *ctx_, const string &table, const string &key,
 
   // Serialize everything into the input dataspace
   Serializer s = ctx.serializer();
-  s << table;
-  s << key;
-  s << len;
-  // We must transfer anything at all, even if it is just an empty vector
-  if (fields != nullptr)
-    s << *fields;
+  std::size_t table_id = schema.table_id(table);
+  s.varint(table_id);
+  s.bytes(key);
+  s.varint(len);
+  s.fields(schema, table_id, fields);
+
+  // Call the server and deserialize the operation results. They are
+  // streamed in several chunks if they do not fit into the output dataspace.
+  for (char op = 's';; op = 'n') {
+    Deserializer d = ctx.call(op);
+    if (ctx.failed()) {
+      result.clear();
+      break;
+    }
+    if (!d.chunk(schema, table_id, result, op == 's' ? 0 : result.size()))
+      break;
+  }
+  ctx.done();
+
+  if (result.size() == 0)
+    return (kErrorNoData);
   else
-    s << std::vector<std::string>(0);
+    return (kOK);
+}
+
+int SqliteShmDB::ReadView(void *ctx_, const string &table, const string &key,
+                          const vector<std::string> *fields,
+                          ResultView &result) {
+  auto &ctx = IpcCltCtx::cast(ctx_);
+
+  // Serialize everything into the input dataspace
+  Serializer s = ctx.serializer();
+  std::size_t table_id = schema.table_id(table);
+  s.varint(table_id);
+  s.bytes(key);
+  s.fields(schema, table_id, fields);
 
   // Call the server
-  Deserializer d = ctx.call('s');
+  Deserializer d = ctx.call('r');
 
-  // Deserialize the operation results
-  d >> result;
+  // Reference the operation results in the output dataspace
+  if (ctx.failed()) {
+    ctx.done();
+    result.Clear();
+    return (kErrorNoData);
+  }
+  d.record(schema, table_id, result);
+  ctx.done();
 
-  if (result.size() == 0)
+  if (result.Fields(0) == 0)
+    return (kErrorNoData);
+  else
+    return (kOK);
+}
+
+int SqliteShmDB::ScanView(void *ctx_, const string &table, const string &key,
+                          int len, const vector<std::string> *fields,
+                          ResultView &result) {
+  auto &ctx = IpcCltCtx::cast(ctx_);
+
+  // Serialize everything into the input dataspace
+  Serializer s = ctx.serializer();
+  std::size_t table_id = schema.table_id(table);
+  s.varint(table_id);
+  s.bytes(key);
+  s.varint(len);
+  s.fields(schema, table_id, fields);
+
+  // Call the server and reference the operation results in the output
+  // dataspace. All chunks but the last one of a streamed result are copied.
+  for (char op = 's';; op = 'n') {
+    Deserializer d = ctx.call(op);
+    if (ctx.failed()) {
+      result.Clear();
+      break;
+    }
+    if (!d.chunk(schema, table_id, result, op == 's'))
+      break;
+  }
+  ctx.done();
+
+  if (result.Records() == 0)
     return (kErrorNoData);
   else
     return (kOK);
@@ -234,14 +390,16 @@ int SqliteShmDB::Update(void *ctx_, const string &table, const string &key,
 
   // Serialize everything into the input dataspace
   Serializer s = ctx.serializer();
-  s << table;
-  s << key;
-  s << values;
+  std::size_t table_id = schema.table_id(table);
+  s.varint(table_id);
+  s.bytes(key);
+  s.values(schema, table_id, values);
 
   // Call the server
   ctx.call('u');
+  ctx.done();
 
-  return (kOK);
+  return ctx.failed() ? kErrorNoData : kOK;
 }
 
 int SqliteShmDB::Insert(void *ctx_, const string &table, const string &key,
@@ -250,14 +408,16 @@ int SqliteShmDB::Insert(void *ctx_, const string &table, const string &key,
 
   // Serialize everything into the input dataspace
   Serializer s = ctx.serializer();
-  s << table;
-  s << key;
-  s << values;
+  std::size_t table_id = schema.table_id(table);
+  s.varint(table_id);
+  s.bytes(key);
+  s.values(schema, table_id, values);
 
   // Call the server
   ctx.call('i');
+  ctx.done();
 
-  return (kOK);
+  return ctx.failed() ? kErrorNoData : kOK;
 }
 
 int SqliteShmDB::Delete(void *ctx_, const string &table, const string &key) {
@@ -265,13 +425,122 @@ int SqliteShmDB::Delete(void *ctx_, const string &table, const string &key) {
 
   // Serialize everything into the input dataspace
   Serializer s = ctx.serializer();
-  s << table;
-  s << key;
+  std::size_t table_id = schema.table_id(table);
+  s.varint(table_id);
+  s.bytes(key);
 
   // Call the server
   ctx.call('d');
+  ctx.done();
 
-  return (kOK);
+  return ctx.failed() ? kErrorNoData : kOK;
+}
+
+std::size_t SqliteShmDB::QueueDepth(void *ctx_) {
+  return IpcCltCtx::cast(ctx_).depth;
+}
+
+/* Serialize op into a free slot and notify the server without waiting. */
+void SqliteShmDB::Submit(void *ctx_, AsyncOp &op) {
+  auto &ctx = IpcCltCtx::cast(ctx_);
+
+  if (ctx.in_flight == ctx.depth)
+    throw std::runtime_error{"too many operations in flight"};
+
+  std::size_t i = 0;
+  while (ctx.slots[i].op != nullptr)
+    i++;
+  auto &slot = ctx.slots[i];
+
+  // Serialize everything into the input slot
+  Serializer s = ctx.serializer(i);
+  std::size_t table_id = schema.table_id(op.table);
+  auto fields = op.fields.empty() ? nullptr : &op.fields;
+  s.varint(table_id);
+  s.bytes(op.key);
+
+  char opcode = 0;
+  switch (op.type) {
+  case AsyncOp::READ:
+    s.fields(schema, table_id, fields);
+    opcode = 'r';
+    break;
+  case AsyncOp::SCAN:
+    s.varint(op.record_count);
+    s.fields(schema, table_id, fields);
+    opcode = 's';
+    break;
+  case AsyncOp::UPDATE:
+    s.values(schema, table_id, op.values);
+    opcode = 'u';
+    break;
+  case AsyncOp::INSERT:
+    s.values(schema, table_id, op.values);
+    opcode = 'i';
+    break;
+  case AsyncOp::DELETE:
+    opcode = 'd';
+    break;
+  }
+
+  slot.op = &op;
+  slot.table_id = table_id;
+  slot.first = true;
+  ctx.in_flight++;
+
+  ctx.send(opcode, i);
+}
+
+/* Collect the responses that have arrived in the slots. */
+std::size_t SqliteShmDB::Poll(void *ctx_, bool wait) {
+  auto &ctx = IpcCltCtx::cast(ctx_);
+  std::size_t completed = 0;
+
+  for (;;) {
+    for (std::size_t i = 0; i < ctx.depth; i++) {
+      auto &slot = ctx.slots[i];
+      if (slot.op == nullptr || !ctx.received(i))
+        continue;
+
+      AsyncOp &op = *slot.op;
+      Deserializer d = ctx.response(i);
+      if (slot.failed) {
+        op.result.Clear();
+        op.status = kErrorNoData;
+      } else switch (op.type) {
+      case AsyncOp::READ:
+        // Reference the operation results in the output slot
+        d.record(schema, slot.table_id, op.result);
+        op.status = op.result.Fields(0) == 0 ? kErrorNoData : kOK;
+        break;
+      case AsyncOp::SCAN:
+        // Request the next chunk of a streamed result on the same slot.
+        if (d.chunk(schema, slot.table_id, op.result, slot.first)) {
+          slot.first = false;
+          ctx.send('n', i);
+          continue;
+        }
+        op.status = op.result.Records() == 0 ? kErrorNoData : kOK;
+        break;
+      default:
+        op.status = kOK;
+        break;
+      }
+
+      ctx.done(i);
+      slot.op = nullptr;
+      ctx.in_flight--;
+      completed++;
+      if (op.callback)
+        op.callback(op);
+    }
+
+    if (completed > 0 || !wait || ctx.in_flight == 0)
+      return completed;
+
+    // Use PAUSE to hint a spin-wait loop. This should use YIELD on ARM.
+    __builtin_ia32_pause();
+  }
 }
 
 // Signals the end of the connection to the Sqlite IPC server and destroys the
@@ -282,6 +551,11 @@ void SqliteShmDB::Close(void *ctx_) {
 
   ctx.call('c');
 
+  if (timed) {
+    std::lock_guard<std::mutex> guard{stages_lock};
+    stages.Merge(ctx.stages);
+  }
+
   // Detach communication mappings from this address space
   if (L4Re::Env::env()->rm()->detach(ctx.ds_in_addr, &ctx.ds_in) < 0) {
     std::cerr << "Failed to detach input dataspace." << std::endl;
@@ -309,4 +583,20 @@ void SqliteShmDB::Close(void *ctx_) {
   // std::cerr << "Benchmark thread terminated." << std::endl;
 }
 
+/* Only count the operations of the benchmark run. */
+void SqliteShmDB::EndLoad() {
+  std::lock_guard<std::mutex> guard{stages_lock};
+  stages.Clear();
+}
+
+bool SqliteShmDB::TakeBreakdown(breakdown::Stages &taken) {
+  if (!timed)
+    return false;
+
+  std::lock_guard<std::mutex> guard{stages_lock};
+  taken = stages;
+  stages.Clear();
+  return true;
+}
+
 } // namespace ycsbc
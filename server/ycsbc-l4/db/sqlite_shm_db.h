@@ -9,11 +9,15 @@
 
 #pragma once
 
+#include "breakdown.h"              // Latency breakdown of operations
 #include "db.h"                     // YCSBC interface for databases
+#include "db_host.h"                // Selection of the hosted database
+#include "serializer.h"             // Compact message format
 #include "sqlite_shm_server.h"      // Interfaces for the Sqlite server.
 
 #include <sqlite3.h>                // Definitions for Sqlite
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -25,13 +29,21 @@ struct Ctx;
 
 class SqliteShmDB : public DB {
 public:
-    SqliteShmDB(const std::string &filename = std::string(":memory:"));
+    // The server hosts the database backend db_name, configured by params
+    // (see dbhost::create_db()). Every benchmark thread may have up to
+    // queue_depth operations in flight through the asynchronous interface.
+    // If the property breakdown is set in params, every operation is timed
+    // (see breakdown.h).
+    SqliteShmDB(const std::string &db_name = std::string("sqlite_lib"),
+                const dbhost::Params &params = dbhost::Params(),
+                std::size_t queue_depth = 1);
     // FIXME: Add destructor.
 
     // Meta operations for database and/or connection management
     void CreateSchema(DB::Tables tables) override;
     void *Init(l4_umword_t cpu) override;
     void Close(void *ctx) override;
+    void EndLoad() override;
 
     // Database (benchmark) operations
     int Read(void *ctx, const std::string &table, const std::string &key,
@@ -42,6 +54,15 @@ public:
              const std::vector<std::string> *fields,
              std::vector<std::vector<KVPair>> &result) override;
 
+    // The views reference the output dataspace of ctx.
+    int ReadView(void *ctx, const std::string &table, const std::string &key,
+                 const std::vector<std::string> *fields,
+                 ResultView &result) override;
+
+    int ScanView(void *ctx, const std::string &table, const std::string &key,
+                 int len, const std::vector<std::string> *fields,
+                 ResultView &result) override;
+
     int Update(void *ctx, const std::string &table, const std::string &key,
                std::vector<KVPair> &values) override;
 
@@ -51,9 +72,26 @@ public:
     int Delete(void *ctx, const std::string &table,
                const std::string &key) override;
 
+    // Operations are pipelined through the slots of the dataspaces of ctx.
+    std::size_t QueueDepth(void *ctx) override;
+    void Submit(void *ctx, AsyncOp &op) override;
+    std::size_t Poll(void *ctx, bool wait) override;
+
+    bool TakeBreakdown(breakdown::Stages &stages) override;
+
 private:
-    // Filename of the DB, transmitted to server
-    const std::string filename;
+    // Name and parameters of the hosted database, transmitted to server
+    const std::string db_name;
+    const dbhost::Params params;
+
+    // Number of slots of the dataspaces of every benchmark thread
+    const std::size_t queue_depth;
+
+    // Time the stages of every operation
+    const bool timed;
+    // Latency breakdown of all closed contexts, protected by stages_lock
+    breakdown::Stages stages;
+    std::mutex stages_lock;
 
     // Capability to the sqlite shared memory server
     L4::Cap<sqlite::shm::DbI> server;
@@ -61,6 +99,9 @@ private:
     // Dataspace for transmitting database layout information during setup
     L4::Cap<L4Re::Dataspace> db_infopage;
     char *db_infopage_addr = 0;
+
+    // Table and column ids for the messages to the server
+    serializer::Schema schema{};
 };
 
 } // namespace ycsbc
@@ -13,12 +13,25 @@
 #include <sstream>
 #include <vector>
 #include <future>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <memory>
 
 #include "core/utils.h"
 #include "core/timer.h"
 #include "core/client.h"
 #include "core/core_workload.h"
+#include "core/measurements.h"
+#include "core/results.h"
+#include "core/sweep.h"
+#include "core/trace.h"
 #include "db/db_factory.h"
+#include "breakdown.h"
+#include "topology.h"
 #include "utils.h"
 
 using namespace std;
@@ -40,57 +53,250 @@ void UsageMessage(const char *command);
 bool StrStartWith(const char *str, const char *pre);
 string ParseCommandLine(int argc, const char *argv[], utils::Properties &props);
 
-static int DelegateClient(ycsbc::DB *db, ycsbc::CoreWorkload *wl, 
-    const int num_ops, bool is_loading, l4_umword_t cpu, l4_umword_t db_cpu) {
+// Releases the client threads at once when all of them have set up their
+// database contexts, so that the setup is not part of the measured window.
+class StartGate {
+ public:
+  explicit StartGate(int threads) : waiting_(threads) {}
+
+  // Called by every client thread when it is ready to run.
+  void Wait() {
+    unique_lock<mutex> lock(lock_);
+    if (--waiting_ == 0)
+      changed_.notify_all();
+    changed_.wait(lock, [this] { return open_; });
+  }
+
+  // Waits for all client threads, releases them and returns the start time.
+  uint64_t Open() {
+    unique_lock<mutex> lock(lock_);
+    changed_.wait(lock, [this] { return waiting_ == 0; });
+    uint64_t start = ycsbc::TscClock::Get().Now();
+    open_ = true;
+    changed_.notify_all();
+    return start;
+  }
+
+ private:
+  mutex lock_;
+  condition_variable changed_;
+  int waiting_;
+  bool open_ = false;
+};
+
+// Reports the progress of a phase to cerr every interval seconds (never if
+// zero), with the throughput since the previous report and the estimated time
+// left.
+class Progress {
+ public:
+  Progress(const string &phase, uint64_t total, int threads, unsigned interval)
+      : phase_(phase), total_(total), interval_(interval), counters_(threads) {
+    if (interval_)
+      reporter_ = thread(&Progress::Report, this);
+  }
+
+  ~Progress() {
+    if (!interval_)
+      return;
+    {
+      lock_guard<mutex> lock(lock_);
+      stop_ = true;
+    }
+    stopped_.notify_all();
+    reporter_.join();
+  }
+
+  // Counter of the operations performed by a client thread
+  atomic<uint64_t> *Counter(int thread) {
+    return interval_ ? &counters_[thread].ops : nullptr;
+  }
+
+ private:
+  void Report() {
+    typedef chrono::steady_clock clock;
+    clock::time_point begin = clock::now(), last_time = begin;
+    uint64_t last = 0;
+
+    unique_lock<mutex> lock(lock_);
+    while (!stopped_.wait_for(lock, chrono::seconds(interval_),
+                              [this] { return stop_; })) {
+      uint64_t done = 0;
+      for (auto &c : counters_) {
+        done += c.ops.load(memory_order_relaxed);
+      }
+      clock::time_point now = clock::now();
+      double elapsed = chrono::duration<double>(now - begin).count();
+      double since = chrono::duration<double>(now - last_time).count();
+
+      cerr << "# " << phase_ << " progress:\t" << done << " of " << total_
+           << " (" << (total_ ? done * 100 / total_ : 100) << "%), "
+           << (done - last) / since / 1000 << " Kops/s";
+      if (done > 0 && done < total_) {
+        cerr << ", ETA " << (uint64_t)((total_ - done) * elapsed / done)
+             << " s";
+      }
+      cerr << endl;
+      last = done;
+      last_time = now;
+    }
+  }
+
+  // Counters in their own cache lines, written by their client thread only
+  struct PaddedCounter {
+    atomic<uint64_t> ops{0};
+    char padding[64 - sizeof(atomic<uint64_t>)];
+  };
+
+  string phase_;
+  uint64_t total_;
+  unsigned interval_;
+  vector<PaddedCounter> counters_;
+  thread reporter_;
+  mutex lock_;
+  condition_variable stopped_;
+  bool stop_ = false;
+};
+
+// Measurements of a client thread, and when it completed its last operation
+struct ThreadResult {
+  ycsbc::Measurements measurements;
+  uint64_t end = 0;
+};
+
+// Transactions replayed or recorded by a client thread (see trace.h)
+struct TraceArgs {
+  const ycsbc::TraceOp *replay = nullptr;
+  vector<ycsbc::TraceOp> *record = nullptr;
+};
+
+static ThreadResult DelegateClient(ycsbc::DB *db,
+    ycsbc::CoreWorkload *wl, const int num_ops, bool is_loading,
+    l4_umword_t cpu, l4_umword_t db_cpu, uint64_t first_key,
+    bool result_views, size_t queue_depth, StartGate *gate,
+    atomic<uint64_t> *progress, TraceArgs trace,
+    ycsbc::CoreWorkload::ThreadState state) {
   // Migrate this thread to the specified CPU.
   // std::async uses pthreads internally.
   ycsbc::migrate(cpu);
 
-  void *ctx = db->Init(db_cpu);
-  ycsbc::Client client(*db, *wl, ctx);
-  int oks = 0;
-  for (int i = 0; i < num_ops; ++i) {
-    if (is_loading) {
-      oks += client.DoInsert();
-    } else {
-      oks += client.DoTransaction();
+  void *ctx;
+  try {
+    ctx = db->Init(db_cpu);
+  } catch (...) {
+    // Do not keep the others waiting.
+    gate->Wait();
+    throw;
+  }
+  ThreadResult result;
+  ycsbc::Client client(*db, *wl, ctx, state, result_views, queue_depth,
+                       &result.measurements, progress);
+  if (trace.replay)
+    client.ReplayTrace(trace.replay, num_ops);
+  if (trace.record)
+    client.RecordTrace(trace.record);
+  gate->Wait();
+
+  if (!is_loading && queue_depth > 1) {
+    client.DoTransactionsAsync(num_ops);
+  } else {
+    for (int i = 0; i < num_ops; ++i) {
+      if (is_loading) {
+        client.DoInsert(first_key + i);
+      } else {
+        client.DoTransaction();
+      }
     }
   }
+  result.end = ycsbc::TscClock::Get().Now();
   db->Close(ctx);
-  return oks;
+  return result;
 }
 
-int main(const int argc, const char *argv[]) {
-  utils::Properties props;
-  string file_name = ParseCommandLine(argc, argv, props);
+// First of the total operations performed by thread i of num_threads. The
+// shares of the threads differ by at most one operation and add up to total.
+static int64_t FirstOp(int total, int i, int num_threads) {
+  return (int64_t)total * i / num_threads;
+}
 
-  cout << "Starting YCSB benchmark..." << endl;
-  cout << "==========================" << endl << endl;
-  cout << "Using allocator " << MALLOC_IMPL 
-       << " (info is reliable only on L4, beware of DB using another allocator)"
-       << endl;
+// Start the client threads, each performing its share of total operations,
+// or its transactions of the trace replayed. The transactions of thread i
+// are recorded into (*record)[i] if record is set.
+static vector<future<ThreadResult>> Spawn(ycsbc::DB *db,
+    ycsbc::CoreWorkload &wl, const utils::Properties &props,
+    const vector<pair<l4_umword_t, l4_umword_t>> &placement, int total,
+    bool is_loading, StartGate &gate, Progress &progress,
+    const ycsbc::TraceReader *replay = nullptr,
+    vector<vector<ycsbc::TraceOp>> *record = nullptr) {
+  bool result_views;
+  istringstream(props.GetProperty("result-views", "0")) >> result_views;
+  size_t queue_depth = stoul(props.GetProperty("queuedepth", "1"));
+  const int num_threads = placement.size();
 
-  ycsbc::DB *db = ycsbc::DBFactory::CreateDB(props);
-  if (!db) {
-    cout << "Unknown database name " << props["dbname"] << endl;
-    exit(0);
+  vector<future<ThreadResult>> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    int64_t first = FirstOp(total, i, num_threads);
+    int64_t count = FirstOp(total, i + 1, num_threads) - first;
+    TraceArgs trace;
+    if (replay) {
+      count = replay->Count(i);
+      trace.replay = replay->Ops(i);
+    }
+    if (record) {
+      (*record)[i].reserve(count);
+      trace.record = &(*record)[i];
+    }
+    threads.emplace_back(async(launch::async,
+        DelegateClient, db, &wl, count, is_loading,
+        placement[i].first, placement[i].second,
+        is_loading ? wl.insert_start() + first : 0, result_views,
+        queue_depth, &gate, progress.Counter(i), trace,
+        wl.NewThreadState(is_loading, i)));
   }
+  assert((int)threads.size() == num_threads);
+  return threads;
+}
 
-  cout << "Benchmarking DB: " << props["dbname"] << endl;
-  ycsbc::CoreWorkload wl;
-  wl.Init(props);
+// Wait for the client threads and merge their measurements into phase. The
+// phase ends with the last operation of the slowest thread.
+static void Collect(vector<future<ThreadResult>> &threads, uint64_t start,
+                    ycsbc::Results::Phase &phase) {
+  uint64_t end = start;
+  for (auto &t : threads) {
+    assert(t.valid());
+    ThreadResult result = t.get();
+    phase.measurements.Merge(result.measurements);
+    phase.threads.push_back({result.measurements.Count(),
+                             result.measurements.Errors()});
+    end = max(end, result.end);
+  }
+  phase.duration_ns = end - start;
+}
 
-  db->CreateSchema(wl.Tables());
+// Select the CPUs of the client thread and of its database thread for every
+// client thread, either by a placement policy or from the list of online
+// CPUs as selected by -migrate-rr, -avoid-boot-cpu and -disperse.
+static vector<pair<l4_umword_t, l4_umword_t>> SelectCpus(
+    const utils::Properties &props, const vector<ycsbc::CpuInfo> &topology,
+    int num_threads) {
+  bool avoid_boot_cpu;
+  istringstream(props.GetProperty("avoid-boot-cpu", "0")) >> avoid_boot_cpu;
 
-  const int num_threads = stoi(props.GetProperty("threadcount", "1"));
+  string policy = props.GetProperty("placement");
+  if (!policy.empty()) {
+    vector<ycsbc::CpuInfo> cpus;
+    for (auto &c : topology) {
+      if (!avoid_boot_cpu || c.cpu != 0)
+        cpus.push_back(c);
+    }
+    return ycsbc::place_threads(cpus.empty() ? topology : cpus, policy,
+                                num_threads);
+  }
 
   // Query online CPUs.
   std::vector<l4_umword_t> cpus = ycsbc::online_cpus();
   if (cpus.empty())
     throw std::runtime_error{"cpu list empty"};
 
-  bool avoid_boot_cpu;
-  istringstream(props.GetProperty("avoid-boot-cpu", "0")) >> avoid_boot_cpu;
   if (avoid_boot_cpu && cpus.size() > 1)
     // Remove first/boot CPU.
     cpus.erase(cpus.begin());
@@ -113,52 +319,401 @@ int main(const int argc, const char *argv[]) {
                        cpus[(2 * i + 1) % cpus.size()]);
     };
 
-  // Loads data
-  vector<future<int>> actual_ops;
-  int total_ops = stoi(props[ycsbc::CoreWorkload::RECORD_COUNT_PROPERTY]);
+  vector<pair<l4_umword_t, l4_umword_t>> placement;
   for (int i = 0; i < num_threads; ++i) {
-    auto selected_cpus = select_cpus(cpus, i);
-    actual_ops.emplace_back(async(launch::async,
-        DelegateClient, db, &wl, total_ops / num_threads, true,
-        selected_cpus.first, selected_cpus.second));
+    placement.push_back(select_cpus(cpus, i));
   }
+  return placement;
+}
+
+// Loads data. Every thread inserts its own contiguous range of keys.
+static ycsbc::Results::Phase Load(ycsbc::DB *db, ycsbc::CoreWorkload &wl,
+    const utils::Properties &props,
+    const vector<pair<l4_umword_t, l4_umword_t>> &placement) {
+  int total_ops = stoi(props[ycsbc::CoreWorkload::RECORD_COUNT_PROPERTY]);
+  ycsbc::Results::Phase phase;
+  phase.name = "load";
 
-  assert((int)actual_ops.size() == num_threads);
+  db->BeginLoad();
+  StartGate gate(placement.size());
+  Progress progress("Load", total_ops, placement.size(),
+                    stoul(props.GetProperty("progress", "0")));
+  auto threads =
+      Spawn(db, wl, props, placement, total_ops, true, gate, progress);
+  uint64_t start = gate.Open();
+  Collect(threads, start, phase);
+  // Finishing the load, e.g., building indexes, is part of it.
+  db->EndLoad();
+  phase.duration_ns = ycsbc::TscClock::Get().Now() - start;
+  return phase;
+}
+
+// Describes the properties that determine the records loaded, so that a trace
+// is only replayed on the same records.
+static string WorkloadRecords(const utils::Properties &props) {
+  using ycsbc::CoreWorkload;
+  const pair<string, string> keys[] = {
+      {CoreWorkload::RECORD_COUNT_PROPERTY, ""},
+      {CoreWorkload::FIELD_COUNT_PROPERTY, CoreWorkload::FIELD_COUNT_DEFAULT},
+      {CoreWorkload::FIELD_LENGTH_PROPERTY, CoreWorkload::FIELD_LENGTH_DEFAULT},
+      {CoreWorkload::FIELD_LENGTH_DISTRIBUTION_PROPERTY,
+       CoreWorkload::FIELD_LENGTH_DISTRIBUTION_DEFAULT},
+      {CoreWorkload::INSERT_START_PROPERTY, CoreWorkload::INSERT_START_DEFAULT},
+      {CoreWorkload::INSERT_ORDER_PROPERTY, CoreWorkload::INSERT_ORDER_DEFAULT},
+      {CoreWorkload::ZERO_PADDING_PROPERTY, CoreWorkload::ZERO_PADDING_DEFAULT}};
+  string records;
+  for (auto &key : keys) {
+    records += (records.empty() ? "" : " ") + key.first + "=" +
+               props.GetProperty(key.first, key.second);
+  }
+  return records;
+}
 
-  int sum = 0;
-  for (auto &n : actual_ops) {
-    assert(n.valid());
-    sum += n.get();
+// Describes the records loaded and their layout in the backend, so that a
+// snapshot is only restored for the same records into the same kind of
+// database.
+static string SnapshotRecords(const utils::Properties &props) {
+  string records = WorkloadRecords(props);
+  // The backend holding the records, also behind a database server
+  string db = props.GetProperty("dbname", "basic");
+  if (db == "sqlite_ipc" || db == "sqlite_shm") {
+    db = props.GetProperty("server.db", "sqlite_lib");
+  }
+  records += " db=" + db;
+  if (db == "sqlite_lib" || db == "sqlite_sharded") {
+    records += " sqlite.rowformat=" +
+               props.GetProperty("sqlite.rowformat", "columns") +
+               " sqlite.deferindex=" +
+               props.GetProperty("sqlite.deferindex", "false");
   }
-  cerr << endl;
-  cerr << "# Loading records:\t" << sum << endl;
+  if (db == "sqlite_sharded") {
+    // By default, there is one shard per thread.
+    records += " sqlite.shards=" +
+               props.GetProperty("sqlite.shards",
+                                 props.GetProperty("threadcount", "1"));
+  }
+  return records;
+}
 
-  // Peforms transactions
-  actual_ops.clear();
-  total_ops = stoi(props[ycsbc::CoreWorkload::OPERATION_COUNT_PROPERTY]);
-  utils::Timer<double> timer;
+// Restores the records from the snapshot at path instead of loading them.
+// Returns false if the backend does not support snapshots.
+static bool Restore(ycsbc::DB *db, const string &path,
+                    const utils::Properties &props,
+                    ycsbc::Results::Phase &phase) {
+  phase.name = "restore";
+  utils::Timer timer;
   timer.Start();
-  for (int i = 0; i < num_threads; ++i) {
-    auto selected_cpus = select_cpus(cpus, i);
-    actual_ops.emplace_back(async(launch::async,
-        DelegateClient, db, &wl, total_ops / num_threads, false,
-        selected_cpus.first, selected_cpus.second));
+  if (!db->Restore(path, SnapshotRecords(props)))
+    return false;
+  phase.duration_ns = timer.End();
+  return true;
+}
+
+// Peforms transactions
+static ycsbc::Results::Phase Run(ycsbc::DB *db, ycsbc::CoreWorkload &wl,
+    const utils::Properties &props,
+    const vector<pair<l4_umword_t, l4_umword_t>> &placement) {
+  int total_ops = stoi(props[ycsbc::CoreWorkload::OPERATION_COUNT_PROPERTY]);
+  ycsbc::Results::Phase phase;
+  phase.name = "run";
+
+  // Replay the transactions of a trace, each thread those recorded by the
+  // thread with the same number, or record them.
+  unique_ptr<ycsbc::TraceReader> replay;
+  string replay_file = props.GetProperty("trace.replay");
+  if (!replay_file.empty()) {
+    replay.reset(new ycsbc::TraceReader(replay_file));
+    if (replay->Threads() != placement.size()) {
+      throw utils::Exception("Trace " + replay_file + " recorded with " +
+                             to_string(replay->Threads()) + " threads");
+    }
+    if (replay->Records() != WorkloadRecords(props)) {
+      throw utils::Exception("Trace " + replay_file + " recorded for " +
+                             replay->Records());
+    }
+    total_ops = 0;
+    for (size_t i = 0; i < replay->Threads(); ++i) {
+      total_ops += replay->Count(i);
+    }
+  }
+  string record_file = props.GetProperty("trace.record");
+  vector<vector<ycsbc::TraceOp>> record(placement.size());
+
+  StartGate gate(placement.size());
+  Progress progress("Transaction", total_ops, placement.size(),
+                    stoul(props.GetProperty("progress", "0")));
+  auto threads =
+      Spawn(db, wl, props, placement, total_ops, false, gate, progress,
+            replay.get(), record_file.empty() ? nullptr : &record);
+  Collect(threads, gate.Open(), phase);
+
+  if (!record_file.empty()) {
+    ycsbc::WriteTrace(record_file, WorkloadRecords(props), record);
+    cerr << "# Recorded trace:\t" << record_file << endl;
+  }
+  return phase;
+}
+
+// Creates the database and, unless only running transactions, restores the
+// records from the snapshot at restore or loads them, saving a snapshot to
+// save if set. Sets load to the phase of restoring or loading.
+static ycsbc::DB *Prepare(utils::Properties &props, ycsbc::CoreWorkload &wl,
+    const vector<pair<l4_umword_t, l4_umword_t>> &placement,
+    const string &mode, const string &restore, const string &save,
+    ycsbc::Results::Phase &load) {
+  ycsbc::DB *db = ycsbc::DBFactory::CreateDB(props);
+  if (!db) {
+    cout << "Unknown database name " << props["dbname"] << endl;
+    exit(0);
+  }
+
+  cout << "Benchmarking DB: " << props["dbname"] << endl;
+  // A run-only client gets the database loaded into the server before.
+  db->CreateSchema(wl.Tables());
+
+  if (mode != "run" && !restore.empty() && Restore(db, restore, props, load)) {
+    cerr << endl;
+    cerr << "# Restored snapshot (ms):\t" << restore << '\t'
+         << load.duration_ns / 1000000 << endl;
+  } else if (mode != "run") {
+    if (!restore.empty()) {
+      cout << "No snapshots for " << props["dbname"] << ", loading instead"
+           << endl;
+    }
+    load = Load(db, wl, props, placement);
+    cerr << endl;
+    cerr << "# Loading records:\t"
+         << load.measurements.Count() - load.measurements.Errors() << endl;
+    if (load.measurements.Errors() > 0) {
+      cerr << "# Failed inserts:\t" << load.measurements.Errors() << endl;
+    }
+    if (!save.empty()) {
+      if (db->Snapshot(save, SnapshotRecords(props)))
+        cerr << "# Saved snapshot:\t" << save << endl;
+      else
+        cout << "No snapshots for " << props["dbname"] << endl;
+    }
+  }
+
+  // Inserts of the transactions follow the loaded records.
+  wl.SkipSequenceKeys(stoi(props[ycsbc::CoreWorkload::RECORD_COUNT_PROPERTY]));
+  return db;
+}
+
+// The properties of a point of a sweep: props overridden by those of point.
+static utils::Properties PointProperties(const utils::Properties &props,
+                                         const ycsbc::SweepPoint &point) {
+  utils::Properties point_props = props;
+  for (auto &kv : point) {
+    point_props.SetProperty(kv.first, kv.second);
+  }
+  return point_props;
+}
+
+// Name a point of a sweep by its properties.
+static string Describe(const ycsbc::SweepPoint &point) {
+  string name;
+  for (auto &p : point) {
+    name += (name.empty() ? "" : " ") + p.first + "=" + p.second;
+  }
+  return name;
+}
+
+int main(const int argc, const char *argv[]) {
+  utils::Properties props;
+  string file_name = ParseCommandLine(argc, argv, props);
+
+  cout << "Starting YCSB benchmark..." << endl;
+  cout << "==========================" << endl << endl;
+  cout << "Using allocator " << MALLOC_IMPL 
+       << " (info is reliable only on L4, beware of DB using another allocator)"
+       << endl;
+
+  // Calibrate the clock before any measurement.
+  const ycsbc::TscClock &clock = ycsbc::TscClock::Get();
+  if (clock.Fallback())
+    cout << "Timing with steady_clock (no invariant cycle counter)" << endl;
+  else
+    cout << "Timing with the cycle counter at "
+         << clock.Frequency() / 1000000 << " MHz" << endl;
+
+  const vector<ycsbc::CpuInfo> topology =
+      ycsbc::discover_topology(ycsbc::online_cpus());
+  cout << "Topology:" << endl;
+  for (auto &c : topology) {
+    cout << "  " << c << endl;
+  }
+
+  // Without a sweep, there is a single point using the properties as they
+  // are. Points sharing the properties that affect loading run on the same
+  // database, which is only loaded once.
+  vector<ycsbc::SweepPoint> points =
+      ycsbc::ParseSweep(props.GetProperty("sweep"));
+  stable_sort(points.begin(), points.end(),
+              [&](const ycsbc::SweepPoint &a, const ycsbc::SweepPoint &b) {
+                return ycsbc::LoadProperties(a, PointProperties(props, a)) <
+                       ycsbc::LoadProperties(b, PointProperties(props, b));
+              });
+  const size_t repetitions = stoul(props.GetProperty("repetitions", "1"));
+  // Load the records and run the transactions (all), only load them into a
+  // database server (load), or only run the transactions on the records
+  // loaded into the server before (run)
+  const string mode = props.GetProperty("mode", "all");
+  if (repetitions == 0) {
+    cout << "At least one repetition required" << endl;
+    exit(0);
+  }
+
+  ycsbc::DB *db = nullptr;
+  // Properties the database was loaded with, and whether it has been
+  // modified by inserts of the transaction phase since
+  ycsbc::SweepPoint loaded;
+  bool inserted = false;
+  vector<pair<string, ycsbc::Summary>> summaries;
+
+  for (size_t p = 0; p < points.size(); ++p) {
+    utils::Properties point_props = PointProperties(props, points[p]);
+    string point_name = Describe(points[p]);
+    if (points.size() > 1) {
+      cout << endl << "Sweep point " << p + 1 << "/" << points.size() << ": "
+           << point_name << endl;
+    }
+
+    unique_ptr<ycsbc::CoreWorkload> wl(new ycsbc::CoreWorkload);
+    wl->Init(point_props);
+
+    const int num_threads = stoi(point_props.GetProperty("threadcount", "1"));
+    auto placement = SelectCpus(point_props, topology, num_threads);
+    cout << "Placement ("
+         << point_props.GetProperty("placement", "-migrate-rr/-disperse")
+         << "):" << endl;
+    ycsbc::print_placement(cout, topology, placement);
+
+    bool reload = !db || inserted ||
+                  ycsbc::LoadProperties(points[p], point_props) != loaded;
+    ycsbc::Results::Phase load;
+    if (reload) {
+      delete db;
+      db = Prepare(point_props, *wl, placement, mode,
+                   point_props.GetProperty("snapshot.restore"),
+                   point_props.GetProperty("snapshot.save"), load);
+      loaded = ycsbc::LoadProperties(points[p], point_props);
+      inserted = false;
+    } else {
+      wl->SkipSequenceKeys(
+          stoi(point_props[ycsbc::CoreWorkload::RECORD_COUNT_PROPERTY]));
+    }
+    // Transactions inserting records, including those of a replayed trace,
+    // change the records the following ones run on.
+    const bool inserts =
+        stod(point_props.GetProperty(
+            ycsbc::CoreWorkload::INSERT_PROPORTION_PROPERTY, "0")) > 0 ||
+        !point_props.GetProperty("trace.replay").empty();
+
+    ycsbc::Results point_results;
+    point_results.props = &point_props;
+    point_results.workload_file = file_name;
+    point_results.allocator = MALLOC_IMPL;
+    point_results.placement = placement;
+    if (mode == "load") {
+      if (reload) {
+        point_results.phases.push_back(load);
+        ycsbc::WriteResults(point_results);
+      }
+      continue;
+    }
+
+    vector<double> throughputs;
+    for (size_t r = 0; r < repetitions; ++r) {
+      ycsbc::Results results = point_results;
+      results.repetition = r;
+      // Every repetition runs on the records as loaded, with the workload
+      // inserting the same keys again. The records are restored from the
+      // snapshot saved by the first load if possible.
+      if (r > 0) reload = false;
+      if (r > 0 && inserts && mode != "run") {
+        string snapshot = point_props.GetProperty("snapshot.restore");
+        if (snapshot.empty())
+          snapshot = point_props.GetProperty("snapshot.save");
+        delete db;
+        wl.reset(new ycsbc::CoreWorkload);
+        wl->Init(point_props);
+        db = Prepare(point_props, *wl, placement, mode, snapshot, "", load);
+        reload = true;
+      }
+      if (reload && mode != "run") {
+        results.phases.push_back(load);
+      }
+
+      ycsbc::Results::Phase run = Run(db, *wl, point_props, placement);
+      results.phases.push_back(run);
+      // Throughput of the operations actually performed, failed or not
+      double ktps = run.measurements.Count() * 1e6 / run.duration_ns;
+      throughputs.push_back(ktps);
+      cerr << "# Transaction throughput (KTPS)" << endl;
+      cerr << point_props["dbname"] << '\t' << file_name << '\t'
+           << num_threads << '\t';
+      cerr << ktps << endl;
+      if (run.measurements.Errors() > 0) {
+        cerr << "# Failed transactions:\t" << run.measurements.Errors()
+             << " of " << run.measurements.Count() << endl;
+      }
+
+      breakdown::Stages stages;
+      if (db->TakeBreakdown(stages)) {
+        cerr << "# Latency breakdown (cycles)" << endl;
+        stages.Print(cerr);
+        results.breakdown = &stages;
+      }
+      ycsbc::WriteResults(results);
+    }
+    inserted = inserts;
+
+    if (points.size() > 1 || repetitions > 1) {
+      summaries.emplace_back(
+          point_name.empty() ? point_props["dbname"] : point_name,
+          ycsbc::Summarize(throughputs));
+    }
   }
-  assert((int)actual_ops.size() == num_threads);
+  delete db;
 
-  sum = 0;
-  for (auto &n : actual_ops) {
-    assert(n.valid());
-    sum += n.get();
+  if (!summaries.empty()) {
+    cerr << endl;
+    cerr << "# Summary of the transaction throughput (KTPS) over "
+         << repetitions << " repetition(s)" << endl;
+    cerr << "point\tmean\tci95\tstddev\tmin\tmax" << endl;
+    for (auto &s : summaries) {
+      cerr << s.first << '\t' << s.second.mean << '\t' << s.second.ci95
+           << '\t' << s.second.stddev << '\t' << s.second.min << '\t'
+           << s.second.max << endl;
+    }
   }
-  double duration = timer.End();
-  cerr << "# Transaction throughput (KTPS)" << endl;
-  cerr << props["dbname"] << '\t' << file_name << '\t' << num_threads << '\t';
-  cerr << total_ops / duration / 1000 << endl;
 
   return 0;
 }
 
+// Exits if the properties select a combination of options that is not
+// supported.
+static void CheckConfiguration(const utils::Properties &props) {
+  bool disperse, migrate_rr;
+  istringstream(props.GetProperty("disperse", "0")) >> disperse;
+  istringstream(props.GetProperty("migrate-rr", "0")) >> migrate_rr;
+  string dbname = props.GetProperty("dbname", "none");
+  if (disperse &&
+      (!migrate_rr || (dbname != "sqlite_ipc" && dbname != "sqlite_shm"))) {
+    cout << "Argument -disperse not allowed" << endl;
+    exit(0);
+  }
+
+  // Only the database servers keep the records between benchmark runs.
+  string mode = props.GetProperty("mode", "all");
+  if (mode != "all" && dbname != "sqlite_ipc" && dbname != "sqlite_shm") {
+    cout << "Arguments -load and -run only allowed for sqlite_ipc and sqlite_shm"
+         << endl;
+    exit(0);
+  }
+}
+
 string ParseCommandLine(int argc, const char *argv[], utils::Properties &props) {
   int argindex = 1;
   string filename;
@@ -225,9 +780,101 @@ string ParseCommandLine(int argc, const char *argv[], utils::Properties &props)
     } else if (strcmp(argv[argindex], "-avoid-boot-cpu") == 0) {
       argindex++;
       props.SetProperty("avoid-boot-cpu", "1");
+    } else if (strcmp(argv[argindex], "-placement") == 0) {
+      argindex++;
+      if (argindex >= argc) {
+        UsageMessage(argv[0]);
+        exit(0);
+      }
+      props.SetProperty("placement", argv[argindex]);
+      argindex++;
     } else if (strcmp(argv[argindex], "-disperse") == 0) {
       argindex++;
       props.SetProperty("disperse", "1");
+    } else if (strcmp(argv[argindex], "-result-views") == 0) {
+      argindex++;
+      props.SetProperty("result-views", "1");
+    } else if (strcmp(argv[argindex], "-load") == 0) {
+      argindex++;
+      props.SetProperty("mode", "load");
+    } else if (strcmp(argv[argindex], "-run") == 0) {
+      argindex++;
+      props.SetProperty("mode", "run");
+    } else if (strcmp(argv[argindex], "-progress") == 0) {
+      argindex++;
+      if (argindex >= argc) {
+        UsageMessage(argv[0]);
+        exit(0);
+      }
+      props.SetProperty("progress", argv[argindex]);
+      argindex++;
+    } else if (strcmp(argv[argindex], "-seed") == 0) {
+      argindex++;
+      if (argindex >= argc) {
+        UsageMessage(argv[0]);
+        exit(0);
+      }
+      props.SetProperty(ycsbc::CoreWorkload::SEED_PROPERTY, argv[argindex]);
+      argindex++;
+    } else if (strcmp(argv[argindex], "-record") == 0) {
+      argindex++;
+      if (argindex >= argc) {
+        UsageMessage(argv[0]);
+        exit(0);
+      }
+      props.SetProperty("trace.record", argv[argindex]);
+      argindex++;
+    } else if (strcmp(argv[argindex], "-replay") == 0) {
+      argindex++;
+      if (argindex >= argc) {
+        UsageMessage(argv[0]);
+        exit(0);
+      }
+      props.SetProperty("trace.replay", argv[argindex]);
+      argindex++;
+    } else if (strcmp(argv[argindex], "-sweep") == 0) {
+      argindex++;
+      if (argindex >= argc) {
+        UsageMessage(argv[0]);
+        exit(0);
+      }
+      props.SetProperty("sweep", argv[argindex]);
+      argindex++;
+    } else if (strcmp(argv[argindex], "-repetitions") == 0) {
+      argindex++;
+      if (argindex >= argc) {
+        UsageMessage(argv[0]);
+        exit(0);
+      }
+      props.SetProperty("repetitions", argv[argindex]);
+      argindex++;
+    } else if (strcmp(argv[argindex], "-results") == 0) {
+      argindex++;
+      if (argindex >= argc) {
+        UsageMessage(argv[0]);
+        exit(0);
+      }
+      props.SetProperty("results.file", argv[argindex]);
+      argindex++;
+    } else if (strcmp(argv[argindex], "-results-format") == 0) {
+      argindex++;
+      if (argindex >= argc) {
+        UsageMessage(argv[0]);
+        exit(0);
+      }
+      props.SetProperty("results.format", argv[argindex]);
+      argindex++;
+    } else if (strcmp(argv[argindex], "-breakdown") == 0) {
+      argindex++;
+      props.SetProperty("breakdown", "1");
+    } else if (strcmp(argv[argindex], "-queuedepth") == 0) {
+      argindex++;
+      if (argindex >= argc) {
+        UsageMessage(argv[0]);
+        exit(0);
+      }
+      props.SetProperty("queuedepth", argv[argindex]);
+      argindex++;
     } else {
       cout << "Unknown option '" << argv[argindex] << "'" << endl;
       exit(0);
@@ -239,16 +886,25 @@ string ParseCommandLine(int argc, const char *argv[], utils::Properties &props)
     exit(0);
   }
 
-  auto const& properties = props.properties();
-  bool should_disperse = properties.find("disperse") != properties.end();
-  bool should_migrate = properties.find("migrate-rr") != properties.end();
-  string dbname = props.GetProperty("dbname", "none");
-  if (should_disperse &&
-      (!should_migrate || (dbname != "sqlite_ipc" && dbname != "sqlite_shm"))) {
-    cout << "Argument -disperse not allowed" << endl;
+  string mode = props.GetProperty("mode", "all");
+  if (mode != "all" && mode != "load" && mode != "run") {
+    cout << "Unknown mode " << mode << endl;
     exit(0);
   }
 
+  // Every point of a sweep must be a valid configuration on its own.
+  for (auto &point : ycsbc::ParseSweep(props.GetProperty("sweep"))) {
+    utils::Properties point_props = props;
+    for (auto &kv : point) {
+      if (kv.first == "mode") {
+        cout << "The mode cannot be swept" << endl;
+        exit(0);
+      }
+      point_props.SetProperty(kv.first, kv.second);
+    }
+    CheckConfiguration(point_props);
+  }
+
   return filename;
 }
 
@@ -263,6 +919,26 @@ void UsageMessage(const char *command) {
   cout << "  -avoid-boot-cpu: do not migrate threads to the boot CPU" << endl;
   cout << "  -disperse: assign communicating ycsb and db threads to different CPUs" << endl;
   cout << "              (for sqlite_ipc and sqlite_shm)" << endl;
+  cout << "  -placement policy: place the ycsb and db threads by the CPU topology," << endl;
+  cout << "                     compact, scatter, same, smt, l3 or remote" << endl;
+  cout << "  -result-views: read and scan through the zero-copy result interface" << endl;
+  cout << "  -queuedepth n: keep up to n operations per thread in flight (default: 1)" << endl;
+  cout << "  -load: only load the records into the database server" << endl;
+  cout << "  -run: only run the transactions on the records loaded into the database" << endl;
+  cout << "        server before (for sqlite_ipc and sqlite_shm)" << endl;
+  cout << "  -progress s: report the progress of the phases every s seconds" << endl;
+  cout << "  -seed n: derive all random numbers of the workload from seed n" << endl;
+  cout << "           (default: 0)" << endl;
+  cout << "  -record file: record the transactions into a trace file" << endl;
+  cout << "  -replay file: replay the transactions of a trace file instead of" << endl;
+  cout << "                generating them" << endl;
+  cout << "  -sweep spec: run every combination of the given properties, e.g.," << endl;
+  cout << "               \"threads=1,2,4;db=lock_stl,sqlite_shm\"" << endl;
+  cout << "  -repetitions n: run the transactions of every configuration n times (default: 1)" << endl;
+  cout << "  -results file: append machine-readable results to file (- for stdout)" << endl;
+  cout << "  -results-format fmt: format of the results, json or csv (default: json)" << endl;
+  cout << "  -breakdown: time the stages of every operation and print their distribution" << endl;
+  cout << "              (for sqlite_ipc and sqlite_shm)" << endl;
 }
 
 inline bool StrStartWith(const char *str, const char *pre) {